@@ -370,6 +370,10 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Data blocks cache (process-wide) */
+    int64_t i_block_cache_hits;
+    int64_t i_block_cache_misses;
 };
 
 #endif
@@ -43,6 +43,12 @@ struct vlc_http_conn
     struct vlc_tls *tls;
 };
 
+/**
+ * Opens a stream on a connection and sends a request on it.
+ *
+ * @return the stream, or NULL on error. errno is then set to EBUSY if the
+ * connection cannot take more streams for the time being, but may later.
+ */
 static inline struct vlc_http_stream *
 vlc_http_stream_open(struct vlc_http_conn *conn, const struct vlc_http_msg *m)
 {
@@ -23,8 +23,12 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vlc_common.h>
 #include <vlc_network.h>
+#include <vlc_strings.h>
 #include <vlc_tls.h>
 #include <vlc_interrupt.h>
 #include "transport.h"
@@ -158,73 +162,193 @@ static vlc_tls_t *vlc_http_connect_i11e(vlc_object_t *obj,
 }
 
 
+/** Persistent connection to one origin server */
+struct vlc_http_origin
+{
+    struct vlc_http_origin *next;
+    struct vlc_http_conn *conn;
+    unsigned refs; /**< Pool and pending requests */
+    bool secure;
+    unsigned port;
+    char host[];
+};
+
 struct vlc_http_mgr
 {
     vlc_object_t *obj;
     vlc_tls_creds_t *creds;
     struct vlc_http_cookie_jar_t *jar;
-    struct vlc_http_conn *conn;
+    struct vlc_http_origin *origins;
+    vlc_mutex_t lock;
     bool use_h2c;
 };
 
-static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
-                                               const char *host, unsigned port)
+static bool vlc_http_origin_match(const struct vlc_http_origin *o, bool secure,
+                                  const char *host, unsigned port)
+{
+    return o->secure == secure && o->port == port
+        && !vlc_ascii_strcasecmp(o->host, host);
+}
+
+/* The manager lock must be held. */
+static void vlc_http_origin_release(struct vlc_http_origin *o)
 {
-    (void) host; (void) port;
-    return mgr->conn;
+    assert(o->refs > 0);
+
+    if (--o->refs == 0)
+    {   /* Streams still open keep the connection alive until closed */
+        vlc_http_conn_release(o->conn);
+        free(o);
+    }
 }
 
-static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
-                                 struct vlc_http_conn *conn)
+/* Takes a connection out of the pool. The manager lock must be held. */
+static bool vlc_http_mgr_unlink(struct vlc_http_mgr *mgr,
+                                struct vlc_http_origin *o)
 {
-    assert(mgr->conn == conn);
-    mgr->conn = NULL;
+    for (struct vlc_http_origin **pp = &mgr->origins; *pp != NULL;
+         pp = &(*pp)->next)
+        if (*pp == o)
+        {
+            *pp = o->next;
+            return true;
+        }
+    return false;
+}
 
-    vlc_http_conn_release(conn);
+/* Adds a connection to the pool, with a reference for the caller */
+static struct vlc_http_origin *vlc_http_mgr_add(struct vlc_http_mgr *mgr,
+                                                bool secure, const char *host,
+                                                unsigned port,
+                                                struct vlc_http_conn *conn)
+{
+    size_t len = strlen(host) + 1;
+    struct vlc_http_origin *o = malloc(sizeof (*o) + len);
+    if (unlikely(o == NULL))
+        return NULL;
+
+    o->conn = conn;
+    o->refs = 2;
+    o->secure = secure;
+    o->port = port;
+    memcpy(o->host, host, len);
+
+    /* Connections created concurrently for the same origin are all kept */
+    vlc_mutex_lock(&mgr->lock);
+    o->next = mgr->origins;
+    mgr->origins = o;
+    vlc_mutex_unlock(&mgr->lock);
+    return o;
+}
+
+/* Waits for the response to a request on a connection held by the caller */
+static struct vlc_http_msg *vlc_http_mgr_wait(struct vlc_http_mgr *mgr,
+                                              struct vlc_http_origin *o,
+                                              struct vlc_http_stream *stream)
+{
+    struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+
+    vlc_mutex_lock(&mgr->lock);
+    /* NOTE: If the request were not idempotent, we would not know if it
+     * was processed by the other end. Thus POST is not used/supported so
+     * far, and CONNECT is treated as if it were idempotent (which works
+     * fine here). */
+    if (m == NULL && vlc_http_mgr_unlink(mgr, o))
+        o->refs--; /* Get rid of closing or reset connection */
+    vlc_http_origin_release(o);
+    vlc_mutex_unlock(&mgr->lock);
+    return m;
 }
 
 static
-struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
+struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr, bool secure,
                                         const char *host, unsigned port,
                                         const struct vlc_http_msg *req)
 {
-    struct vlc_http_conn *conn = vlc_http_mgr_find(mgr, host, port);
-    if (conn == NULL)
+    struct vlc_http_stream *stream = NULL;
+    struct vlc_http_origin *o, **pp = &mgr->origins;
+
+    vlc_mutex_lock(&mgr->lock);
+    while ((o = *pp) != NULL)
+    {
+        if (!vlc_http_origin_match(o, secure, host, port))
+        {
+            pp = &o->next;
+            continue;
+        }
+
+        errno = 0;
+        stream = vlc_http_stream_open(o->conn, req);
+        if (stream != NULL)
+        {   /* Holds the connection while waiting without the lock, so
+             * that other requests can be multiplexed meanwhile. */
+            o->refs++;
+            break;
+        }
+
+        if (errno == EBUSY)
+        {   /* Busy HTTP/1 connections are left alone */
+            pp = &o->next;
+            continue;
+        }
+
+        /* Get rid of closed, reset or going away connection */
+        *pp = o->next;
+        vlc_http_origin_release(o);
+    }
+    vlc_mutex_unlock(&mgr->lock);
+
+    if (stream == NULL)
         return NULL;
+    return vlc_http_mgr_wait(mgr, o, stream);
+}
 
+/* Sends the request on a new connection, then shares it */
+static struct vlc_http_msg *vlc_http_mgr_connect(struct vlc_http_mgr *mgr,
+                                                 bool secure,
+                                                 const char *host,
+                                                 unsigned port,
+                                                 struct vlc_http_conn *conn,
+                                                 const struct vlc_http_msg *req)
+{
+    /* The request is sent before the connection becomes visible to other
+     * threads, so that it cannot be found busy and dropped. */
     struct vlc_http_stream *stream = vlc_http_stream_open(conn, req);
-    if (stream != NULL)
+    if (stream == NULL)
+    {
+        vlc_http_conn_release(conn);
+        return NULL;
+    }
+
+    struct vlc_http_origin *o = vlc_http_mgr_add(mgr, secure, host, port,
+                                                 conn);
+    if (unlikely(o == NULL))
     {
-        struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
-        if (m != NULL)
-            return m;
-
-        /* NOTE: If the request were not idempotent, we would not know if it
-         * was processed by the other end. Thus POST is not used/supported so
-         * far, and CONNECT is treated as if it were idempotent (which works
-         * fine here). */
+        vlc_http_stream_close(stream, true);
+        vlc_http_conn_release(conn);
+        return NULL;
     }
-    /* Get rid of closing or reset connection */
-    vlc_http_mgr_release(mgr, conn);
-    return NULL;
+    return vlc_http_mgr_wait(mgr, o, stream);
 }
 
 static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
                                               const char *host, unsigned port,
                                               const struct vlc_http_msg *req)
 {
-    if (mgr->creds == NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTP to HTTPS not implemented */
-
+    vlc_mutex_lock(&mgr->lock);
     if (mgr->creds == NULL)
     {   /* First TLS connection: load x509 credentials */
         mgr->creds = vlc_tls_ClientCreate(mgr->obj);
         if (mgr->creds == NULL)
+        {
+            vlc_mutex_unlock(&mgr->lock);
             return NULL;
+        }
     }
+    vlc_mutex_unlock(&mgr->lock);
 
     /* TODO? non-idempotent request support */
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
+    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, true, host, port, req);
     if (resp != NULL)
         return resp; /* existing connection reused */
 
@@ -253,19 +377,15 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    mgr->conn = conn;
-
-    return vlc_http_mgr_reuse(mgr, host, port, req);
+    return vlc_http_mgr_connect(mgr, true, host, port, conn, req);
 }
 
 static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
                                              const char *host, unsigned port,
                                              const struct vlc_http_msg *req)
 {
-    if (mgr->creds != NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTPS to HTTP not implemented */
-
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
+    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, false, host, port,
+                                                   req);
     if (resp != NULL)
         return resp;
 
@@ -286,9 +406,7 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    mgr->conn = conn;
-
-    return vlc_http_mgr_reuse(mgr, host, port, req);
+    return vlc_http_mgr_connect(mgr, false, host, port, conn, req);
 }
 
 struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
@@ -314,16 +432,23 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->obj = obj;
     mgr->creds = NULL;
     mgr->jar = jar;
-    mgr->conn = NULL;
+    mgr->origins = NULL;
+    vlc_mutex_init(&mgr->lock);
     mgr->use_h2c = h2c;
     return mgr;
 }
 
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
 {
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
+    while (mgr->origins != NULL)
+    {
+        struct vlc_http_origin *o = mgr->origins;
+
+        mgr->origins = o->next;
+        vlc_http_origin_release(o);
+    }
     if (mgr->creds != NULL)
         vlc_tls_Delete(mgr->creds);
+    vlc_mutex_destroy(&mgr->lock);
     free(mgr);
 }
@@ -39,6 +39,10 @@ struct vlc_http_cookie_jar_t;
  * establishing a new one. If succesful, the initial HTTP response header is
  * returned.
  *
+ * One connection is kept per origin server (scheme, host and port). This
+ * function can be called from several threads at once: with HTTP/2, their
+ * requests are multiplexed over that same connection.
+ *
  * @param mgr HTTP connection manager
  * @param https whether to use HTTPS (true) or unencrypted HTTP (false)
  * @param host name of authoritative HTTP server to send the request to
@@ -0,0 +1,239 @@
+/*****************************************************************************
+ * connmgr_test.c: HTTP connection manager test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#ifndef SOCK_CLOEXEC
+# define SOCK_CLOEXEC 0
+# define accept4(a,b,c,d) accept(a,b,c)
+#endif
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_block.h>
+#include "connmgr.h"
+#include "message.h"
+
+#define CLIENTS  4
+#define REQUESTS 50
+
+static const char body[] = "Hello world!";
+static atomic_bool server_close = ATOMIC_VAR_INIT(false);
+
+/* Serves HTTP/1.1 requests until the client closes the connection */
+static void *server_conn_thread(void *data)
+{
+    int fd = (intptr_t)data;
+    char buf[1024];
+    size_t buflen = 0;
+
+    for (;;)
+    {
+        char *end;
+
+        while ((end = strnstr(buf, "\r\n\r\n", buflen)) == NULL)
+        {
+            ssize_t val = recv(fd, buf + buflen, sizeof (buf) - buflen - 1,
+                               0);
+            if (val <= 0)
+            {
+                assert(buflen == 0); /* No incomplete request */
+                close(fd);
+                return NULL;
+            }
+            buflen += val;
+        }
+
+        assert(!strncmp(buf, "GET / HTTP/1.1\r\n", 16));
+        end += 4;
+        buflen -= end - buf;
+        memmove(buf, end, buflen);
+
+        char resp[128];
+        int len = snprintf(resp, sizeof (resp),
+                           "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n%s"
+                           "\r\n%s", strlen(body),
+                           atomic_load(&server_close) ? "Connection: close\r\n" : "", body);
+        assert(write(fd, resp, len) == len);
+
+        if (atomic_load(&server_close))
+        {
+            close(fd);
+            return NULL;
+        }
+    }
+}
+
+static unsigned connection_count = 0;
+static vlc_thread_t conn_threads[(CLIENTS + 1) * REQUESTS];
+
+static void *server_thread(void *data)
+{
+    int lfd = (intptr_t)data;
+
+    for (;;)
+    {
+        int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd == -1)
+            continue;
+
+        int canc = vlc_savecancel();
+        assert(connection_count < ARRAY_SIZE(conn_threads));
+        if (vlc_clone(&conn_threads[connection_count], server_conn_thread,
+                      (void *)(intptr_t)cfd, VLC_THREAD_PRIORITY_LOW))
+            assert(!"Thread error");
+        connection_count++;
+        vlc_restorecancel(canc);
+    }
+    vlc_assert_unreachable();
+}
+
+static int server_socket(unsigned *port)
+{
+    int fd = socket(PF_INET6, SOCK_STREAM|SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd == -1)
+        return -1;
+
+    struct sockaddr_in6 addr = {
+        .sin6_family = AF_INET6,
+#ifdef HAVE_SA_LEN
+        .sin6_len = sizeof (addr),
+#endif
+        .sin6_addr = in6addr_loopback,
+    };
+    socklen_t addrlen = sizeof (addr);
+
+    if (bind(fd, (struct sockaddr *)&addr, addrlen)
+     || getsockname(fd, (struct sockaddr *)&addr, &addrlen))
+    {
+        close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin6_port);
+    return fd;
+}
+
+static struct vlc_http_mgr *mgr;
+static unsigned port;
+
+/* Each client keeps at most one request in flight */
+static void *client_thread(void *data)
+{
+    char authority[16];
+
+    snprintf(authority, sizeof (authority), "[::1]:%u", port);
+    (void) data;
+
+    for (unsigned i = 0; i < REQUESTS; i++)
+    {
+        struct vlc_http_msg *req = vlc_http_req_create("GET", "http",
+                                                       authority, "/");
+        assert(req != NULL);
+
+        struct vlc_http_msg *m = vlc_http_mgr_request(mgr, false, "::1", port,
+                                                      req);
+        vlc_http_msg_destroy(req);
+        assert(m != NULL);
+        m = vlc_http_msg_get_final(m);
+        assert(m != NULL);
+        assert(vlc_http_msg_get_status(m) == 200);
+
+        char buf[sizeof (body)];
+        size_t len = 0;
+        block_t *block;
+
+        while ((block = vlc_http_msg_read(m)) != NULL)
+        {
+            assert(len + block->i_buffer < sizeof (buf));
+            memcpy(buf + len, block->p_buffer, block->i_buffer);
+            len += block->i_buffer;
+            block_Release(block);
+        }
+        assert(len == strlen(body));
+        assert(!memcmp(buf, body, len));
+        vlc_http_msg_destroy(m);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    int lfd = server_socket(&port);
+    if (lfd == -1)
+        return 77;
+
+    if (listen(lfd, 255))
+    {
+        close(lfd);
+        return 77;
+    }
+
+    vlc_thread_t th;
+    if (vlc_clone(&th, server_thread, (void *)(intptr_t)lfd,
+                  VLC_THREAD_PRIORITY_LOW))
+        assert(!"Thread error");
+
+    mgr = vlc_http_mgr_create(NULL, NULL, false);
+    assert(mgr != NULL);
+
+    /* Concurrent requests to one origin share the idle connections */
+    vlc_thread_t clients[CLIENTS];
+
+    for (unsigned i = 0; i < CLIENTS; i++)
+        if (vlc_clone(&clients[i], client_thread, NULL,
+                      VLC_THREAD_PRIORITY_LOW))
+            assert(!"Thread error");
+    for (unsigned i = 0; i < CLIENTS; i++)
+        vlc_join(clients[i], NULL);
+
+    unsigned shared_count = connection_count;
+    assert(shared_count > 0);
+    assert(shared_count <= CLIENTS);
+
+    /* Connections closed by the server are dropped, and replaced */
+    atomic_store(&server_close, true);
+    client_thread(NULL);
+
+    vlc_http_mgr_destroy(mgr);
+
+    vlc_cancel(th);
+    vlc_join(th, NULL);
+    assert(connection_count >= REQUESTS);
+    assert(connection_count <= shared_count + REQUESTS);
+    for (unsigned i = 0; i < connection_count; i++)
+        vlc_join(conn_threads[i], NULL);
+    close(lfd);
+    return 0;
+}
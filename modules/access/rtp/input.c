@@ -95,6 +95,70 @@ static int rtp_timeout (mtime_t deadline)
     return t;
 }
 
+#ifdef HAVE_RECVMMSG
+/**
+ * Receives up to RTP_BATCH pending datagrams with a single system call.
+ * More pending datagrams are left to the next poll(), so that the session
+ * is dequeued between batches.
+ * @return 0 on success, -1 if batched receive is not supported.
+ */
+static int rtp_dgram_recv_batch (demux_t *demux, int fd)
+{
+    demux_sys_t *sys = demux->p_sys;
+    struct mmsghdr msgv[RTP_BATCH];
+    struct iovec iov[RTP_BATCH];
+
+    /* Refill the buffers consumed by the previous batch */
+    unsigned count = 0;
+    while (count < RTP_BATCH)
+    {
+        if (sys->ring[count] == NULL)
+            sys->ring[count] = block_Alloc (0xffff); /* TODO: p_sys->mru */
+        if (unlikely(sys->ring[count] == NULL))
+            break;
+
+        iov[count].iov_base = sys->ring[count]->p_buffer;
+        iov[count].iov_len = sys->ring[count]->i_buffer;
+        memset (&msgv[count], 0, sizeof (msgv[count]));
+        msgv[count].msg_hdr.msg_iov = &iov[count];
+        msgv[count].msg_hdr.msg_iovlen = 1;
+        count++;
+    }
+    if (unlikely(count == 0))
+    {   /* OOM - discard one datagram, so that poll() does not spin */
+        char dummy;
+        recv (fd, &dummy, 1, MSG_DONTWAIT);
+        return 0;
+    }
+
+    int n = recvmmsg (fd, msgv, count, MSG_DONTWAIT, NULL);
+    if (n == -1)
+    {
+        if (errno == ENOSYS)
+            return -1;
+        if (errno != EAGAIN)
+            msg_Warn (demux, "RTP network error: %s",
+                      vlc_strerror_c(errno));
+        return 0;
+    }
+
+    sys->calls++;
+    sys->datagrams += n;
+    var_SetInteger (demux, "rtp-batch-calls", sys->calls);
+    var_SetInteger (demux, "rtp-batch-datagrams", sys->datagrams);
+
+    for (int i = 0; i < n; i++)
+    {
+        block_t *block = sys->ring[i];
+
+        sys->ring[i] = NULL;
+        block->i_buffer = msgv[i].msg_len;
+        rtp_process (demux, block);
+    }
+    return 0;
+}
+#endif
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -104,6 +168,9 @@ void *rtp_dgram_thread (void *opaque)
     demux_sys_t *sys = demux->p_sys;
     mtime_t deadline = VLC_TS_INVALID;
     int rtp_fd = sys->fd;
+#ifdef HAVE_RECVMMSG
+    bool batch = true;
+#endif
 
     struct pollfd ufd[1];
     ufd[0].fd = rtp_fd;
@@ -125,6 +192,15 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
+#ifdef HAVE_RECVMMSG
+            if (batch)
+            {
+                if (rtp_dgram_recv_batch (demux, rtp_fd) == 0)
+                    goto dequeue;
+                msg_Dbg (demux, "batched receive not supported");
+                batch = false;
+            }
+#endif
             block_t *block = block_Alloc (0xffff); /* TODO: p_sys->mru */
             if (unlikely(block == NULL))
                 break; /* we are totallly screwed */
@@ -266,6 +266,14 @@ static int Open (vlc_object_t *obj)
     p_sys->max_misorder = var_CreateGetInteger (obj, "rtp-max-misorder");
     p_sys->thread_ready = false;
     p_sys->autodetect   = true;
+#ifdef HAVE_RECVMMSG
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        p_sys->ring[i] = NULL;
+    p_sys->calls        = 0;
+    p_sys->datagrams    = 0;
+    var_Create (demux, "rtp-batch-calls", VLC_VAR_INTEGER);
+    var_Create (demux, "rtp-batch-datagrams", VLC_VAR_INTEGER);
+#endif
 
     demux->pf_demux   = NULL;
     demux->pf_control = Control;
@@ -328,6 +336,17 @@ static void Close (vlc_object_t *obj)
         vlc_join (p_sys->thread, NULL);
     }
 
+#ifdef HAVE_RECVMMSG
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        if (p_sys->ring[i] != NULL)
+            block_Release (p_sys->ring[i]);
+    if (p_sys->calls > 0)
+        msg_Dbg (obj, "received %"PRIu64" datagrams in %"PRIu64" calls "
+                 "(%.1f per call)",
+                 p_sys->datagrams, p_sys->calls,
+                 (double)p_sys->datagrams / p_sys->calls);
+#endif
+
 #ifdef HAVE_SRTP
     if (p_sys->srtp)
         srtp_destroy (p_sys->srtp);
@@ -58,6 +58,10 @@ int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt);
 void *rtp_dgram_thread (void *data);
 void *rtp_stream_thread (void *data);
 
+#ifdef HAVE_RECVMMSG
+# define RTP_BATCH 32 /**< Max datagrams per receive call */
+#endif
+
 /* Global data */
 struct demux_sys_t
 {
@@ -76,5 +80,10 @@ struct demux_sys_t
     uint8_t       max_src; /**< Max simultaneous RTP sources */
     bool          thread_ready;
     bool          autodetect; /**< Payload type autodetection pending */
+#ifdef HAVE_RECVMMSG
+    block_t      *ring[RTP_BATCH]; /**< Receive buffers for the next batch */
+    uint64_t      calls; /**< Batched receive calls */
+    uint64_t      datagrams; /**< Datagrams received by batches */
+#endif
 };
 
@@ -49,6 +49,9 @@
 #include <fcntl.h>
 
 #define MTU 65535
+#ifdef HAVE_RECVMMSG
+# define UDP_BATCH 32 /* datagrams per receive call */
+#endif
 
 /*****************************************************************************
  * Module descriptor
@@ -85,6 +88,11 @@ struct access_sys_t
     vlc_sem_t semaphore;
     vlc_thread_t thread;
     bool timeout_reached;
+#ifdef HAVE_RECVMMSG
+    block_t *ring[UDP_BATCH]; /* receive buffers for the next batch */
+    uint64_t calls; /* batched receive calls */
+    uint64_t datagrams; /* datagrams received by batches */
+#endif
 };
 
 /*****************************************************************************
@@ -193,6 +201,15 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        sys->ring[i] = NULL;
+    sys->calls = 0;
+    sys->datagrams = 0;
+    var_Create( p_access, "udp-batch-calls", VLC_VAR_INTEGER );
+    var_Create( p_access, "udp-batch-datagrams", VLC_VAR_INTEGER );
+#endif
+
     if( vlc_clone( &sys->thread, ThreadRead, p_access,
                    VLC_THREAD_PRIORITY_INPUT ) )
     {
@@ -217,6 +234,15 @@ static void Close( vlc_object_t *p_this )
 
     vlc_cancel( sys->thread );
     vlc_join( sys->thread, NULL );
+#ifdef HAVE_RECVMMSG
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        if( sys->ring[i] != NULL )
+            block_Release( sys->ring[i] );
+    if( sys->calls > 0 )
+        msg_Dbg( p_access, "received %"PRIu64" datagrams in %"PRIu64" calls "
+                 "(%.1f per call)", sys->datagrams, sys->calls,
+                 (double)sys->datagrams / sys->calls );
+#endif
     vlc_sem_destroy( &sys->semaphore );
     block_FifoRelease( sys->fifo );
     net_Close( sys->fd );
@@ -277,6 +303,114 @@ static block_t *BlockUDP( access_t *p_access )
     return block;
 }
 
+/*****************************************************************************
+ * ThreadWait: Wait for incoming packets, or signal the timeout.
+ *****************************************************************************/
+static bool ThreadWait( access_t *access )
+{
+    access_sys_t *sys = access->p_sys;
+    int poll_return=0;
+    struct pollfd ufd[1];
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    while ((poll_return = poll(ufd, 1, sys->timeout)) < 0); /* cancellation point */
+    if (unlikely( poll_return == 0))
+    {
+        msg_Err( access, "Timeout on receiving, timeout %d seconds", sys->timeout/1000 );
+        vlc_fifo_Lock(sys->fifo);
+        sys->timeout_reached=true;
+        vlc_fifo_Unlock(sys->fifo);
+        vlc_sem_post(&sys->semaphore);
+        return false;
+    }
+    return true;
+}
+
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * ThreadReadBatch: Pull as many packets as available with each system call.
+ *****************************************************************************
+ * Returns only if batched receive is not supported by the system.
+ *****************************************************************************/
+static void ThreadReadBatch( access_t *access )
+{
+    access_sys_t *sys = access->p_sys;
+    struct mmsghdr msgv[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+
+    for(;;)
+    {
+        /* Refill the ring with the buffers consumed by the previous batch */
+        unsigned count = 0;
+        while (count < UDP_BATCH)
+        {
+            if (sys->ring[count] == NULL)
+                sys->ring[count] = block_Alloc(MTU);
+            if (unlikely(sys->ring[count] == NULL))
+                break;
+
+            iov[count].iov_base = sys->ring[count]->p_buffer;
+            iov[count].iov_len = MTU;
+            memset(&msgv[count], 0, sizeof (msgv[count]));
+            msgv[count].msg_hdr.msg_iov = &iov[count];
+            msgv[count].msg_hdr.msg_iovlen = 1;
+            count++;
+        }
+
+        if (!ThreadWait(access))
+            continue;
+
+        if (unlikely(count == 0))
+        {   /* OOM - dequeue and discard one packet */
+            char dummy;
+            recv(sys->fd, &dummy, 1, 0);
+            continue;
+        }
+
+        int n = recvmmsg(sys->fd, msgv, count, MSG_DONTWAIT, NULL);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == ENOSYS)
+            {
+                msg_Dbg(access, "batched receive not supported");
+                return;
+            }
+            continue;
+        }
+
+        int canc = vlc_savecancel();
+        block_t *chain = NULL, **pp_last = &chain;
+        size_t len = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            block_t *pkt = sys->ring[i];
+
+            sys->ring[i] = NULL;
+            pkt->i_buffer = msgv[i].msg_len;
+            len += pkt->i_buffer;
+            block_ChainLastAppend(&pp_last, pkt);
+        }
+        sys->calls++;
+        sys->datagrams += n;
+        var_SetInteger(access, "udp-batch-calls", sys->calls);
+        var_SetInteger(access, "udp-batch-datagrams", sys->datagrams);
+
+        vlc_fifo_Lock(sys->fifo);
+        /* Discard old buffers on overflow */
+        while (vlc_fifo_GetCount(sys->fifo) > 0
+            && vlc_fifo_GetBytes(sys->fifo) + len > sys->fifo_size)
+            block_Release(vlc_fifo_DequeueUnlocked(sys->fifo));
+
+        vlc_fifo_QueueUnlocked(sys->fifo, chain);
+        vlc_fifo_Unlock(sys->fifo);
+        vlc_sem_post(&sys->semaphore);
+        vlc_restorecancel(canc);
+    }
+}
+#endif
+
 /*****************************************************************************
  * ThreadRead: Pull packets from socket as soon as possible.
  *****************************************************************************/
@@ -285,6 +419,10 @@ static void* ThreadRead( void *data )
     access_t *access = data;
     access_sys_t *sys = access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    ThreadReadBatch(access);
+#endif
+
     for(;;)
     {
         block_t *pkt = block_Alloc(MTU);
@@ -300,19 +438,8 @@ static void* ThreadRead( void *data )
         block_cleanup_push(pkt);
         do
         {
-            int poll_return=0;
-            struct pollfd ufd[1];
-            ufd[0].fd = sys->fd;
-            ufd[0].events = POLLIN;
-
-            while ((poll_return = poll(ufd, 1, sys->timeout)) < 0); /* cancellation point */
-            if (unlikely( poll_return == 0))
+            if (!ThreadWait(access))
             {
-                msg_Err( access, "Timeout on receiving, timeout %d seconds", sys->timeout/1000 );
-                vlc_fifo_Lock(sys->fifo);
-                sys->timeout_reached=true;
-                vlc_fifo_Unlock(sys->fifo);
-                vlc_sem_post(&sys->semaphore);
                 len=0;
                 break;
             }
@@ -50,6 +50,7 @@
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+#define MAX_BATCH_BLOCKS 32
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +72,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batching window (ms)")
+#define BATCH_LONGTEXT N_("Packets due within this time of the first one " \
+                          "of a batch are sent along with it, with as few " \
+                          "system calls as possible. They may leave up to " \
+                          "that much early. 0 sends each packet separately." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +86,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "batch", 4, BATCH_TEXT, BATCH_LONGTEXT,
+                                 true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +101,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "batch",
     NULL
 };
 
@@ -110,6 +120,12 @@ static int Control( sout_access_out_t *, int, va_list );
 static void* ThreadWrite( void * );
 static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
 
+/* Jitter histogram bounds, in microseconds */
+static const mtime_t jitter_bounds[] = {
+    -2000, -1000, -500, -100, 0, 100, 500, 1000, 2000, 5000, 10000, 20000,
+};
+#define JITTER_BUCKETS (ARRAY_SIZE(jitter_bounds) + 1)
+
 struct sout_access_out_sys_t
 {
     mtime_t       i_caching;
@@ -121,6 +137,15 @@ struct sout_access_out_sys_t
     block_fifo_t *p_empty_blocks;
     block_t      *p_buffer;
 
+    /* Sending thread state */
+    block_t      *pp_batch[MAX_BATCH_BLOCKS]; /* packets being sent */
+    unsigned      i_batch;
+    block_t      *p_pending; /* first packet of the next batch */
+    bool          b_sendmmsg;
+    uint64_t      i_sent_packets;
+    uint64_t      i_send_calls;
+    uint64_t      jitter[JITTER_BUCKETS]; /* send time minus due time */
+
     vlc_thread_t  thread;
 };
 
@@ -210,9 +235,16 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
+    p_sys->i_batch = 0;
+    p_sys->p_pending = NULL;
+    p_sys->b_sendmmsg = true;
+    p_sys->i_sent_packets = 0;
+    p_sys->i_send_calls = 0;
+    for( unsigned i = 0; i < JITTER_BUCKETS; i++ )
+        p_sys->jitter[i] = 0;
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -242,6 +274,25 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
+
+    if( p_sys->i_sent_packets > 0 )
+    {
+        msg_Dbg( p_access, "sent %"PRIu64" packets in %"PRIu64" calls",
+                 p_sys->i_sent_packets, p_sys->i_send_calls );
+        msg_Dbg( p_access, "send jitter: below %"PRId64" us: %"PRIu64,
+                 jitter_bounds[0], p_sys->jitter[0] );
+        for( unsigned i = 1; i < JITTER_BUCKETS - 1; i++ )
+            msg_Dbg( p_access, "send jitter: %"PRId64" to %"PRId64" us: %"PRIu64,
+                     jitter_bounds[i - 1], jitter_bounds[i],
+                     p_sys->jitter[i] );
+        msg_Dbg( p_access, "send jitter: %"PRId64" us and more: %"PRIu64,
+                 jitter_bounds[JITTER_BUCKETS - 2],
+                 p_sys->jitter[JITTER_BUCKETS - 1] );
+    }
+
+    for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        block_Release( p_sys->pp_batch[i] );
+    if( p_sys->p_pending ) block_Release( p_sys->p_pending );
     block_FifoRelease( p_sys->p_fifo );
     block_FifoRelease( p_sys->p_empty_blocks );
 
@@ -392,6 +443,76 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * SendBatch: send the packets of the current batch, at once if possible.
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, mtime_t i_date )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    unsigned i_done = 0;
+
+#ifdef HAVE_SENDMMSG
+    if( p_sys->i_batch > 1 && p_sys->b_sendmmsg )
+    {
+        struct mmsghdr msgv[MAX_BATCH_BLOCKS];
+        struct iovec iov[MAX_BATCH_BLOCKS];
+
+        for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        {
+            iov[i].iov_base = p_sys->pp_batch[i]->p_buffer;
+            iov[i].iov_len = p_sys->pp_batch[i]->i_buffer;
+            memset( &msgv[i], 0, sizeof (msgv[i]) );
+            msgv[i].msg_hdr.msg_iov = &iov[i];
+            msgv[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        while( i_done < p_sys->i_batch )
+        {
+            int i_val = sendmmsg( p_sys->i_handle, msgv + i_done,
+                                  p_sys->i_batch - i_done, 0 );
+            if( i_val <= 0 )
+            {
+                if( i_val < 0 && errno == ENOSYS )
+                    p_sys->b_sendmmsg = false;
+                else
+                    msg_Warn( p_access, "send error: %s",
+                              vlc_strerror_c(errno) );
+                break;
+            }
+            i_done += i_val;
+            p_sys->i_send_calls++;
+        }
+    }
+#endif
+
+    for( unsigned i = i_done; i < p_sys->i_batch; i++ )
+    {
+        const block_t *p_pk = p_sys->pp_batch[i];
+        if( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+        p_sys->i_send_calls++;
+    }
+
+    /* Account the pacing error of each packet */
+    const mtime_t i_sent = mdate();
+    for( unsigned i = 0; i < p_sys->i_batch; i++ )
+    {
+        const mtime_t i_jitter = i_sent
+                               - (p_sys->i_caching + p_sys->pp_batch[i]->i_dts);
+        unsigned j = 0;
+        while( j < JITTER_BUCKETS - 1 && i_jitter >= jitter_bounds[j] )
+            j++;
+        p_sys->jitter[j]++;
+    }
+    p_sys->i_sent_packets += p_sys->i_batch;
+
+    if ( i_sent > i_date + 20000 )
+    {
+        msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                 i_sent - i_date );
+    }
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -402,13 +523,19 @@ static void* ThreadWrite( void *data )
     mtime_t i_date_last = -1;
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
+    const mtime_t i_window = INT64_C(1000)
+                           * var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        mtime_t       i_date, i_sent;
+        block_t *p_pk = p_sys->p_pending;
+        mtime_t       i_date;
+
+        p_sys->p_pending = NULL;
+        if( p_pk == NULL )
+            p_pk = block_FifoGet( p_sys->p_fifo );
 
         i_date = p_sys->i_caching + p_pk->i_dts;
         if( i_date_last > 0 )
@@ -433,35 +560,54 @@ static void* ThreadWrite( void *data )
             }
         }
 
-        block_cleanup_push( p_pk );
+        p_sys->pp_batch[0] = p_pk; /* released by Close() if cancelled */
+        p_sys->i_batch = 1;
         i_to_send--;
         if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
         {
             mwait( i_date );
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
 
-        if( i_dropped_packets )
+        /* Send along the packets already queued and due within the
+         * pacing window: they leave at most that much early */
+        while( p_sys->i_batch < MAX_BATCH_BLOCKS && i_window > 0 )
         {
-            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
-            i_dropped_packets = 0;
+            vlc_fifo_Lock( p_sys->p_fifo );
+            p_pk = vlc_fifo_DequeueUnlocked( p_sys->p_fifo );
+            vlc_fifo_Unlock( p_sys->p_fifo );
+            if( p_pk == NULL )
+                break;
+
+            mtime_t i_next = p_sys->i_caching + p_pk->i_dts;
+            if( i_next - i_date > i_window || i_next < i_date )
+            {
+                p_sys->p_pending = p_pk;
+                break;
+            }
+            p_sys->pp_batch[p_sys->i_batch++] = p_pk;
+            i_date_last = i_next;
+
+            i_to_send--;
+            if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+                i_to_send = i_group;
         }
 
-#if 1
-        i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
+        int canc = vlc_savecancel();
+        SendBatch( p_access, i_date );
+
+        if( i_dropped_packets )
         {
-            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_sent - i_date );
+            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
+            i_dropped_packets = 0;
         }
-#endif
-
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
 
-        i_date_last = i_date;
+        if( p_sys->i_batch == 1 )
+            i_date_last = i_date;
+        for( unsigned i = 0; i < p_sys->i_batch; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, p_sys->pp_batch[i] );
+        p_sys->i_batch = 0;
+        vlc_restorecancel( canc );
     }
     return NULL;
 }
@@ -1763,6 +1763,13 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
     msg_rc(_("| sending bitrate  :   %6.0f kb/s"),
             (float)(p_item->p_stats->f_send_bitrate*8)*1000 );
     msg_rc("|");
+    /* Blocks cache */
+    msg_rc("%s", _("+-[Data blocks cache]"));
+    msg_rc(_("| cache hits       :    %5"PRIi64),
+           p_item->p_stats->i_block_cache_hits );
+    msg_rc(_("| cache misses     :    %5"PRIi64),
+           p_item->p_stats->i_block_cache_misses );
+    msg_rc("|");
     msg_rc( "+----[ end of statistical info ]" );
     vlc_mutex_unlock( &p_item->p_stats->lock );
     vlc_mutex_unlock( &p_item->lock );
@@ -33,10 +33,13 @@
 #include "logic/AlwaysBestAdaptationLogic.h"
 #include "logic/RateBasedAdaptationLogic.h"
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
+#include "logic/BufferBasedAdaptationLogic.hpp"
 #include "tools/Debug.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
+#include <vlc_input.h>
 
+#include <algorithm>
 #include <ctime>
 
 using namespace adaptive::http;
@@ -54,8 +57,11 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
              streamFactory  ( factory ),
              p_demux        ( p_demux_ ),
              nextPlaylistupdate  ( 0 ),
-             i_nzpcr        ( 0 )
+             i_nzpcr        ( 0 ),
+             i_nzpcrorigin  ( VLC_TS_INVALID ),
+             i_nzplayed     ( 0 )
 {
+    maxBuffering = CLOCK_FREQ / 1000 * var_InheritInteger(p_demux, "adaptive-maxbuffer");
     currentPeriod = playlist->getFirstPeriod();
     failedupdates = 0;
 }
@@ -310,6 +316,64 @@ bool PlaylistManager::reactivateStream(AbstractStream *stream)
     return stream->reactivate(getPCR());
 }
 
+/* Position being played, from the output clock: its reference is the
+ * first PCR sent since the last reset, which plays once the delay elapsed.
+ * The clock moves that reference on rate changes and when resuming, so
+ * only the rate applies here, and the position holds while paused. */
+mtime_t PlaylistManager::getPlaybackPosition() const
+{
+    if(i_nzpcrorigin == VLC_TS_INVALID)
+        return i_nzpcr;
+
+    float f_rate = 1.0;
+    if(p_demux->p_input)
+    {
+        if(var_GetInteger(p_demux->p_input, "state") == PAUSE_S)
+            return i_nzplayed;
+        f_rate = var_GetFloat(p_demux->p_input, "rate");
+    }
+
+    mtime_t i_system, i_delay;
+    if(es_out_ControlGetPcrSystem(p_demux->out, &i_system, &i_delay) != VLC_SUCCESS)
+        return i_nzpcrorigin; /* still buffering */
+
+    const mtime_t i_elapsed = (mdate() - i_system - i_delay) * f_rate;
+    if(i_elapsed <= 0)
+        return i_nzpcrorigin;
+    return std::min(i_nzpcrorigin + i_elapsed, i_nzpcr);
+}
+
+/* Live streams are only demuxed as they are output, and only
+ * run ahead of playback by the caching delay */
+mtime_t PlaylistManager::getBufferingTarget() const
+{
+    if(playlist->isLive())
+        return CLOCK_FREQ / 1000 * var_InheritInteger(p_demux, "network-caching");
+    return maxBuffering;
+}
+
+/* Demuxes ahead without sending, up to the deadline or for as long as
+ * the budget allows, so that the output keeps being fed on time */
+void PlaylistManager::bufferize(mtime_t nzdeadline, mtime_t budget)
+{
+    const mtime_t i_stop = mdate() + budget;
+
+    std::vector<AbstractStream *>::iterator it;
+    for(it=streams.begin(); it!=streams.end(); ++it)
+    {
+        AbstractStream *st = *it;
+        if(st->isDisabled() || !st->isSelected() || st->isEOF())
+            continue;
+
+        mtime_t i_level;
+        do
+        {
+            i_level = st->getBufferingLevel();
+        } while(st->demux(nzdeadline, false) == AbstractStream::status_buffering &&
+                st->getBufferingLevel() != i_level && mdate() < i_stop);
+    }
+}
+
 #define DEMUX_INCREMENT (CLOCK_FREQ / 20)
 int PlaylistManager::demux_callback(demux_t *p_demux)
 {
@@ -328,8 +392,14 @@ int PlaylistManager::doDemux(int64_t increment)
         i_nzpcr = getFirstDTS();
         if(i_nzpcr == VLC_TS_INVALID)
             i_nzpcr = getPCR();
+        i_nzpcrorigin = VLC_TS_INVALID;
     }
 
+    i_nzplayed = getPlaybackPosition();
+    std::vector<AbstractStream *>::iterator it;
+    for(it=streams.begin(); it!=streams.end(); ++it)
+        (*it)->setPlaybackPosition(i_nzplayed);
+
     AbstractStream::status status = demux(i_nzpcr + increment, true);
     AdvDebug(msg_Dbg( p_demux, "doDemux() status %d dts %ld pcr %ld", status, getFirstDTS(), getPCR() ));
     switch(status)
@@ -348,8 +418,12 @@ int PlaylistManager::doDemux(int64_t increment)
         if( i_nzpcr != VLC_TS_INVALID )
         {
             i_nzpcr += increment;
+            if( i_nzpcrorigin == VLC_TS_INVALID )
+                i_nzpcrorigin = i_nzpcr;
             es_out_Control(p_demux->out, ES_OUT_SET_GROUP_PCR, 0, VLC_TS_0 + i_nzpcr);
         }
+        if(!playlist->isLive())
+            bufferize(i_nzplayed + maxBuffering, increment / 2);
         break;
     }
 
@@ -451,6 +525,16 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
             return new (std::nothrow) AlwaysLowestAdaptationLogic();
         case AbstractAdaptationLogic::AlwaysBest:
             return new (std::nothrow) AlwaysBestAdaptationLogic();
+        case AbstractAdaptationLogic::BufferBased:
+        case AbstractAdaptationLogic::BufferBasedHybrid:
+        {
+            BufferBasedAdaptationLogic *logic =
+                    new (std::nothrow) BufferBasedAdaptationLogic(VLC_OBJECT(p_demux),
+                                            type == AbstractAdaptationLogic::BufferBasedHybrid,
+                                            getBufferingTarget());
+            conn->setDownloadRateObserver(logic);
+            return logic;
+        }
         case AbstractAdaptationLogic::Default:
         case AbstractAdaptationLogic::RateBased:
         {
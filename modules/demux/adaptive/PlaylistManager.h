@@ -72,6 +72,9 @@ namespace adaptive
             /* Demux calls */
             virtual int doControl(int, va_list);
             virtual int doDemux(int64_t);
+            mtime_t getPlaybackPosition() const;
+            mtime_t getBufferingTarget() const;
+            void bufferize(mtime_t, mtime_t);
 
             void pruneLiveStream();
             virtual bool reactivateStream(AbstractStream *);
@@ -90,6 +93,9 @@ namespace adaptive
             std::vector<AbstractStream *>        streams;
             time_t                               nextPlaylistupdate;
             mtime_t                              i_nzpcr;
+            mtime_t                              i_nzpcrorigin; /* first since reset */
+            mtime_t                              i_nzplayed;
+            mtime_t                              maxBuffering;
             BasePeriod                          *currentPeriod;
             int                                  failedupdates;
     };
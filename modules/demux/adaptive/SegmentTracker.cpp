@@ -53,6 +53,13 @@ SegmentTrackerEvent::SegmentTrackerEvent(const StreamFormat *fmt)
     u.format.f = fmt;
 }
 
+SegmentTrackerEvent::SegmentTrackerEvent(const BaseAdaptationSet *set, mtime_t current)
+{
+    type = BUFFERING_LEVEL_CHANGE;
+    u.buffering.set = set;
+    u.buffering.current = current;
+}
+
 SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
 {
     first = true;
@@ -147,7 +154,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed, HTTPConnectionM
     bool b_updated = false;
     /* Ensure ephemere content is updated/loaded */
     if(rep->needsUpdate())
-        b_updated = rep->runLocalUpdates(getPlaybackTime(), curNumber, false);
+        b_updated = rep->runLocalUpdates(getPlaybackTime(), curNumber, false, connManager);
 
     if(prevRep && !rep->consistentSegmentNumber())
     {
@@ -273,15 +280,20 @@ void SegmentTracker::registerListener(SegmentTrackerListenerInterface *listener)
     listeners.push_back(listener);
 }
 
-void SegmentTracker::updateSelected()
+void SegmentTracker::updateSelected(HTTPConnectionManager *connManager)
 {
     if(curRepresentation && curRepresentation->needsUpdate())
     {
-        curRepresentation->runLocalUpdates(getPlaybackTime(), curNumber, true);
+        curRepresentation->runLocalUpdates(getPlaybackTime(), curNumber, true, connManager);
         curRepresentation->scheduleNextUpdate(curNumber);
     }
 }
 
+void SegmentTracker::notifyBufferingLevel(mtime_t current)
+{
+    notify(SegmentTrackerEvent(adaptationSet, current));
+}
+
 void SegmentTracker::notify(const SegmentTrackerEvent &event)
 {
     std::list<SegmentTrackerListenerInterface *>::const_iterator it;
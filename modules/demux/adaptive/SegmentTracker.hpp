@@ -54,11 +54,13 @@ namespace adaptive
             SegmentTrackerEvent(SegmentChunk *);
             SegmentTrackerEvent(BaseRepresentation *, BaseRepresentation *);
             SegmentTrackerEvent(const StreamFormat *);
+            SegmentTrackerEvent(const BaseAdaptationSet *, mtime_t);
             enum
             {
                 DISCONTINUITY,
                 SWITCHING,
                 FORMATCHANGE,
+                BUFFERING_LEVEL_CHANGE,
             } type;
             union
             {
@@ -75,6 +77,11 @@ namespace adaptive
                {
                     const StreamFormat *f;
                } format;
+               struct
+               {
+                    const BaseAdaptationSet *set;
+                    mtime_t current;
+               } buffering;
             } u;
     };
 
@@ -100,7 +107,8 @@ namespace adaptive
             mtime_t getPlaybackTime() const; /* Current segment start time if selected */
             mtime_t getMinAheadTime() const;
             void registerListener(SegmentTrackerListenerInterface *);
-            void updateSelected();
+            void updateSelected(HTTPConnectionManager *);
+            void notifyBufferingLevel(mtime_t);
 
         private:
             void notify(const SegmentTrackerEvent &);
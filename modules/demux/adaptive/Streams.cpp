@@ -47,6 +47,7 @@ AbstractStream::AbstractStream(demux_t * demux_, const StreamFormat &format_)
     discontinuity = false;
     segmentTracker = NULL;
     pcr = VLC_TS_INVALID;
+    nz_played = 0;
 
     demuxer = NULL;
     fakeesout = NULL;
@@ -298,7 +299,14 @@ AbstractStream::status AbstractStream::demux(mtime_t nz_deadline, bool send)
 block_t * AbstractStream::readNextBlock()
 {
     if (currentChunk == NULL && !eof)
+    {
+        /* Previous chunks are read: the buffering level is all
+         * that is downloaded and not played yet */
+        const mtime_t i_level = getBufferingLevel();
+        segmentTracker->notifyBufferingLevel((i_level > VLC_TS_0 + nz_played) ?
+                                             i_level - VLC_TS_0 - nz_played : 0);
         currentChunk = segmentTracker->getNextChunk(!fakeesout->restarting(), connManager);
+    }
 
     if(discontinuity)
     {
@@ -313,6 +321,9 @@ block_t * AbstractStream::readNextBlock()
         return NULL;
     }
 
+    /* Least buffered streams get their data downloaded first */
+    currentChunk->setDownloadPriority(getBufferingLevel());
+
     const bool b_segment_head_chunk = (currentChunk->getBytesRead() == 0);
 
     block_t *block = currentChunk->readBlock();
@@ -368,10 +379,15 @@ mtime_t AbstractStream::getPlaybackTime() const
     return segmentTracker->getPlaybackTime();
 }
 
+void AbstractStream::setPlaybackPosition(mtime_t nz_position)
+{
+    nz_played = nz_position;
+}
+
 void AbstractStream::runUpdates()
 {
     if(!isDisabled())
-        segmentTracker->updateSelected();
+        segmentTracker->updateSelected(connManager);
 }
 
 void AbstractStream::fillExtraFMTInfo( es_format_t *p_fmt ) const
@@ -78,6 +78,7 @@ namespace adaptive
         status demux(mtime_t, bool);
         virtual bool setPosition(mtime_t, bool);
         mtime_t getPlaybackTime() const;
+        void setPlaybackPosition(mtime_t);
         void runUpdates();
 
         virtual block_t *readNextBlock(); /* impl */
@@ -107,6 +108,7 @@ namespace adaptive
         bool dead;
         bool flushing;
         mtime_t pcr;
+        mtime_t nz_played; /* output clock position */
         std::string language;
         std::string description;
 
@@ -75,15 +75,37 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_SHARED_HTTP_TEXT N_("Share HTTP connections")
+#define ADAPT_SHARED_HTTP_LONGTEXT N_("Fetch playlists and segments through the http access " \
+    "connection manager, keeping one persistent connection per server, " \
+    "multiplexed when HTTP/2 is available")
+
+#define ADAPT_BUFFER_TEXT N_("Maximum buffering (ms)")
+#define ADAPT_BUFFER_LONGTEXT N_("Download and demux non live streams up to " \
+    "this far ahead of playback. The buffer based logics scale their " \
+    "thresholds to it.")
+
+#define ADAPT_CACHE_SIZE_TEXT N_("Segment cache size (MiB)")
+#define ADAPT_CACHE_SIZE_LONGTEXT N_("Keep up to this amount of downloaded " \
+    "segments, so that seeking back within already played parts does not " \
+    "download them again. 0 disables the cache.")
+#define ADAPT_CACHE_PATH_TEXT N_("Segment cache directory")
+#define ADAPT_CACHE_PATH_LONGTEXT N_("Store cached segments as files in this " \
+    "directory instead of memory. Files are removed when playback ends.")
+
 static const int pi_logics[] = {AbstractAdaptationLogic::RateBased,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
-                                AbstractAdaptationLogic::AlwaysBest};
+                                AbstractAdaptationLogic::AlwaysBest,
+                                AbstractAdaptationLogic::BufferBased,
+                                AbstractAdaptationLogic::BufferBasedHybrid};
 
 static const char *const ppsz_logics[] = { N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
-                                           N_("Highest Bandwidth/Quality")};
+                                           N_("Highest Bandwidth/Quality"),
+                                           N_("Buffer Based"),
+                                           N_("Buffer Based with Bandwidth")};
 
 vlc_module_begin ()
         set_shortname( N_("Adaptative"))
@@ -98,6 +120,12 @@ vlc_module_begin ()
         add_integer( "adaptive-height", 360, ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, true )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_bool   ( "adaptive-shared-http", false, ADAPT_SHARED_HTTP_TEXT, ADAPT_SHARED_HTTP_LONGTEXT, true );
+        add_integer( "adaptive-maxbuffer", 30000, ADAPT_BUFFER_TEXT, ADAPT_BUFFER_LONGTEXT, true )
+            change_integer_range( 1000, 600000 )
+        add_integer( "adaptive-cache-size", 0, ADAPT_CACHE_SIZE_TEXT, ADAPT_CACHE_SIZE_LONGTEXT, true )
+            change_integer_range( 0, 4095 )
+        add_directory( "adaptive-cache-path", NULL, ADAPT_CACHE_PATH_TEXT, ADAPT_CACHE_PATH_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -29,6 +29,7 @@
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -98,6 +99,11 @@ bool AbstractChunk::isEmpty() const
     return !source->hasMoreData();
 }
 
+void AbstractChunk::setDownloadPriority(mtime_t priority)
+{
+    source->setPriority(priority);
+}
+
 block_t * AbstractChunk::readBlock()
 {
     return doRead(0, true);
@@ -123,7 +129,7 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, HTTPConnectionManager *
 HTTPChunkSource::~HTTPChunkSource()
 {
     if(connection)
-        connection->setUsed(false);
+        connManager->releaseConnection(connection);
 }
 
 bool HTTPChunkSource::init(const std::string &url)
@@ -227,13 +233,17 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, HTTPCon
     HTTPChunkSource(url, manager),
     p_head     (NULL),
     pp_tail    (&p_head),
-    buffered     (0)
+    buffered     (0),
+    p_store    (NULL),
+    pp_storetail (&p_store),
+    shared     (false)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&avail);
     done = false;
     eof = false;
     downloadstart = 0;
+    priority = 0;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -251,6 +261,9 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
 
     connManager->downloader->cancel(this);
 
+    if(p_store)
+        block_ChainRelease(p_store);
+
     vlc_cond_destroy(&avail);
     vlc_mutex_destroy(&lock);
 }
@@ -275,6 +288,13 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         return;
     }
 
+    if(done) /* served by the segment cache */
+    {
+        vlc_cond_signal(&avail);
+        vlc_mutex_unlock(&lock);
+        return;
+    }
+
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
@@ -293,12 +313,17 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         mtime_t time;
     } rate = {0,0};
 
+    SegmentCache *cache = connManager->getCache();
+    block_t *p_complete = NULL;
+
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
         block_Release(p_block);
         vlc_mutex_lock(&lock);
         done = true;
+        if(ret == 0)
+            p_complete = storeComplete();
         rate.size = buffered + consumed;
         rate.time = mdate() - downloadstart;
         downloadstart = 0;
@@ -309,10 +334,25 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         p_block->i_buffer = (size_t) ret;
         vlc_mutex_lock(&lock);
         buffered += p_block->i_buffer;
+        if(cache && contentLength)
+        {
+            /* The data is shared with the segment cache.
+             * A missing block fails the size check on completion */
+            block_t *p_view = SegmentCache::share(p_block);
+            if(p_view)
+            {
+                block_t *p_ref = SegmentCache::reference(p_view);
+                if(p_ref)
+                    block_ChainLastAppend(&pp_storetail, p_ref);
+                p_block = p_view;
+                shared = true;
+            }
+        }
         block_ChainLastAppend(&pp_tail, p_block);
         if((size_t) ret < readsize)
         {
             done = true;
+            p_complete = storeComplete();
             rate.size = buffered + consumed;
             rate.time = mdate() - downloadstart;
             downloadstart = 0;
@@ -325,19 +365,67 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         connManager->updateDownloadRate(rate.size, rate.time);
     }
 
+    if(p_complete)
+        cache->put(params.getUrl(), bytesRange, p_complete);
+
     vlc_cond_signal(&avail);
 }
 
+mtime_t HTTPChunkBufferedSource::getPriority() const
+{
+    mtime_t i_priority;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    i_priority = priority;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return i_priority;
+}
+
+void HTTPChunkBufferedSource::setPriority(mtime_t i_priority)
+{
+    vlc_mutex_lock(&lock);
+    priority = i_priority;
+    vlc_mutex_unlock(&lock);
+}
+
 bool HTTPChunkBufferedSource::prepare()
 {
     if(!prepared)
     {
+        SegmentCache *cache = (connManager) ? connManager->getCache() : NULL;
+        block_t *p_block = (cache) ? cache->get(params.getUrl(), bytesRange) : NULL;
+        if(p_block)
+        {
+            block_ChainProperties(p_block, NULL, &contentLength, NULL);
+            buffered += contentLength;
+            block_ChainLastAppend(&pp_tail, p_block);
+            shared = true;
+            done = true;
+            prepared = true;
+            return true;
+        }
         downloadstart = mdate();
         return HTTPChunkSource::prepare();
     }
     return true;
 }
 
+/* Hands over the stored views once the whole segment got through */
+block_t * HTTPChunkBufferedSource::storeComplete()
+{
+    block_t *p_complete = p_store;
+    p_store = NULL;
+    pp_storetail = &p_store;
+
+    size_t size;
+    block_ChainProperties(p_complete, NULL, &size, NULL);
+    if(p_complete && size != contentLength)
+    {
+        block_ChainRelease(p_complete);
+        p_complete = NULL;
+    }
+    return p_complete;
+}
+
 bool HTTPChunkBufferedSource::hasMoreData() const
 {
     bool b_hasdata;
@@ -378,9 +466,21 @@ block_t * HTTPChunkBufferedSource::readBlock()
 
     consumed += p_block->i_buffer;
     buffered -= p_block->i_buffer;
+    const bool b_copy = shared;
 
     vlc_mutex_unlock(&lock);
 
+    /* The cached data must stay intact, while ours can be altered
+     * (decrypted for instance) */
+    if(b_copy)
+    {
+        block_t *p_copy = block_Alloc(p_block->i_buffer);
+        if(p_copy)
+            memcpy(p_copy->p_buffer, p_block->p_buffer, p_block->i_buffer);
+        block_Release(p_block);
+        p_block = p_copy;
+    }
+
     return p_block;
 }
 
@@ -51,6 +51,7 @@ namespace adaptive
                 virtual bool        hasMoreData     () const = 0;
                 void                setBytesRange   (const BytesRange &);
                 const BytesRange &  getBytesRange   () const;
+                virtual void        setPriority     (mtime_t) {}
 
             protected:
                 size_t              contentLength;
@@ -64,6 +65,7 @@ namespace adaptive
 
                 size_t              getBytesRead            () const;
                 bool                isEmpty                 () const;
+                void                setDownloadPriority     (mtime_t);
 
                 virtual block_t *   readBlock       ();
                 virtual block_t *   read            (size_t);
@@ -97,10 +99,10 @@ namespace adaptive
                 size_t              consumed; /* read pointer */
                 bool                prepared;
                 bool                eof;
+                ConnectionParams    params;
 
             private:
                 bool init(const std::string &);
-                ConnectionParams    params;
         };
 
         class HTTPChunkBufferedSource : public HTTPChunkSource
@@ -113,19 +115,26 @@ namespace adaptive
                 virtual block_t *  readBlock       (); /* reimpl */
                 virtual block_t *  read            (size_t); /* reimpl */
                 virtual bool       hasMoreData     () const; /* impl */
+                virtual void       setPriority     (mtime_t); /* reimpl */
 
             protected:
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                block_t *          storeComplete();
+                mtime_t            getPriority() const;
 
             private:
                 block_t            *p_head; /* read cache buffer */
                 block_t           **pp_tail;
                 size_t              buffered; /* read cache size */
+                block_t            *p_store; /* views for the segment cache */
+                block_t           **pp_storetail;
+                bool                shared; /* p_head holds read-only views */
                 bool                done;
                 bool                eof;
                 mtime_t             downloadstart;
+                mtime_t             priority; /* lowest goes first */
                 vlc_mutex_t         lock;
                 vlc_cond_t          avail;
         };
@@ -26,50 +26,59 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
 Downloader::Downloader()
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle = { 0 };
-    thread_handle_valid = false;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(thread_handles.size() < MAX_TRANSFERS)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        thread_handles.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !thread_handles.empty();
 }
 
 Downloader::~Downloader()
 {
+    vlc_mutex_lock(&lock);
     killed = true;
-    vlc_cond_signal(&waitcond);
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    vlc_cond_broadcast(&waitcond);
+    vlc_mutex_unlock(&lock);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = thread_handles.begin(); it != thread_handles.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     chunks.push_back(source);
-    vlc_mutex_unlock(&lock);
     vlc_cond_signal(&waitcond);
+    vlc_mutex_unlock(&lock);
 }
 
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     chunks.remove(source);
+    /* wait for the transfer to release the source */
+    while(std::find(transfers.begin(), transfers.end(), source) != transfers.end())
+        vlc_cond_wait(&updatedcond, &lock);
     vlc_mutex_unlock(&lock);
 }
 
@@ -88,31 +97,65 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
-void Downloader::Run()
+/* Selects the source of the least buffered stream, whose host
+ * has a free transfer slot */
+HTTPChunkBufferedSource * Downloader::nextSource() const
 {
-    while(1)
+    HTTPChunkBufferedSource *next = NULL;
+    mtime_t nextpriority = 0;
+
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
     {
-        vlc_mutex_lock(&lock);
-        if(killed)
-            break;
+        HTTPChunkBufferedSource *source = *it;
+        const mtime_t priority = source->getPriority();
+        if(next && priority >= nextpriority)
+            continue;
 
-        while(chunks.empty() && !killed)
+        unsigned hosttransfers = 0;
+        std::list<HTTPChunkBufferedSource *>::const_iterator it2;
+        for(it2 = transfers.begin(); it2 != transfers.end(); ++it2)
         {
-            vlc_cond_wait(&waitcond, &lock);
+            if((*it2)->params.getHostname() == source->params.getHostname())
+                hosttransfers++;
         }
+        if(hosttransfers >= MAX_HOST_TRANSFERS)
+            continue;
 
-        if(killed)
-            break;
+        next = source;
+        nextpriority = priority;
+    }
+    return next;
+}
 
-        if(!chunks.empty())
+void Downloader::Run()
+{
+    vlc_mutex_lock(&lock);
+    while(!killed)
+    {
+        HTTPChunkBufferedSource *source = nextSource();
+        if(source == NULL)
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-                chunks.pop_front();
+            vlc_cond_wait(&waitcond, &lock);
+            continue;
         }
 
+        chunks.remove(source);
+        transfers.push_back(source);
         vlc_mutex_unlock(&lock);
+
+        /* I/O without the lock, so that other transfers
+         * and scheduling go on meanwhile */
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        transfers.remove(source);
+        /* Back in line, after the sources of same priority */
+        if(!source->isDone())
+            chunks.push_back(source);
+        vlc_cond_broadcast(&updatedcond);
+        /* a host slot is free again */
+        vlc_cond_signal(&waitcond);
     }
     vlc_mutex_unlock(&lock);
 }
@@ -28,6 +28,14 @@
 
 #include <sstream>
 #include <vlc_stream.h>
+#include <vlc_block.h>
+
+extern "C"
+{
+    #include "../../../access/http/message.h"
+    #include "../../../access/http/resource.h"
+    #include "../../../access/http/connmgr.h"
+}
 
 using namespace adaptive::http;
 
@@ -393,6 +401,176 @@ void StreamUrlConnection::setUsed( bool b )
        reset();
 }
 
+static int LibVLCHTTPRequest(struct vlc_http_msg *req,
+                             const struct vlc_http_resource *, void *opaque)
+{
+    const BytesRange *range = static_cast<const BytesRange *>(opaque);
+
+    vlc_http_msg_add_header(req, "Cache-Control", "no-cache");
+    if(range->isValid())
+    {
+        if(range->getEndByte())
+            vlc_http_msg_add_header(req, "Range", "bytes=%zu-%zu",
+                                    range->getStartByte(), range->getEndByte());
+        else
+            vlc_http_msg_add_header(req, "Range", "bytes=%zu-",
+                                    range->getStartByte());
+    }
+    return 0;
+}
+
+LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object, struct vlc_http_mgr *mgr)
+    : AbstractConnection(p_object)
+{
+    http_mgr = mgr;
+    resource = NULL;
+    response = NULL;
+    p_pending = NULL;
+    psz_useragent = var_InheritString(p_object, "http-user-agent");
+}
+
+LibVLCHTTPConnection::~LibVLCHTTPConnection()
+{
+    reset();
+    free(psz_useragent);
+}
+
+void LibVLCHTTPConnection::reset()
+{
+    if(p_pending)
+        block_Release(p_pending);
+    p_pending = NULL;
+    if(response)
+        vlc_http_msg_destroy(response);
+    response = NULL;
+    if(resource)
+    {
+        vlc_http_res_deinit(resource);
+        delete resource;
+    }
+    resource = NULL;
+    bytesRead = 0;
+    contentLength = 0;
+    bytesRange = BytesRange();
+}
+
+bool LibVLCHTTPConnection::canReuse(const ConnectionParams &) const
+{
+    /* Underlying connections are shared by the manager */
+    return available;
+}
+
+int LibVLCHTTPConnection::request(const std::string &path, const BytesRange &range)
+{
+    reset();
+
+    /* Set new path for this query */
+    params.setPath(path);
+
+    msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
+                      range.isValid() ? range.getStartByte() : 0);
+
+    std::string url = params.getUrl();
+    for(int i = 0; i < redirectCount; i++)
+    {
+        resource = new (std::nothrow) struct vlc_http_resource;
+        if(!resource)
+            return VLC_ENOMEM;
+        if(vlc_http_res_init(resource, http_mgr, url.c_str(), psz_useragent, NULL))
+        {
+            delete resource;
+            resource = NULL;
+            return VLC_EGENERIC;
+        }
+
+        response = vlc_http_res_open(resource, LibVLCHTTPRequest,
+                                     const_cast<BytesRange *>(&range));
+        if(!response)
+        {
+            reset();
+            return VLC_EGENERIC;
+        }
+
+        char *psz_redirect = vlc_http_res_get_redirect(resource, response);
+        if(psz_redirect)
+        {
+            url = std::string(psz_redirect);
+            free(psz_redirect);
+            reset();
+            continue;
+        }
+
+        const int status = vlc_http_msg_get_status(response);
+        if((status != 200 && status != 206) ||
+           /* server ignored our range request */
+           (status != 206 && range.isValid() && range.getStartByte() > 0))
+        {
+            reset();
+            return VLC_ENOOBJ;
+        }
+
+        bytesRange = range;
+        const uintmax_t i_size = vlc_http_msg_get_size(response);
+        if(i_size != UINTMAX_MAX)
+            contentLength = i_size;
+        else if(range.isValid() && range.getEndByte() > 0)
+            contentLength = range.getEndByte() - range.getStartByte() + 1;
+        return VLC_SUCCESS;
+    }
+
+    return VLC_EGENERIC;
+}
+
+ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
+{
+    if(!response)
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
+    if (toRead == 0)
+        return VLC_SUCCESS;
+
+    if(len > toRead)
+        len = toRead;
+
+    /* Data arrives as frames, of unrelated size */
+    size_t ret = 0;
+    while(ret < len)
+    {
+        if(!p_pending && !(p_pending = vlc_http_res_read(response)))
+            break;
+
+        size_t copy = __MIN(len - ret, p_pending->i_buffer);
+        memcpy(static_cast<uint8_t *>(p_buffer) + ret, p_pending->p_buffer, copy);
+        p_pending->p_buffer += copy;
+        p_pending->i_buffer -= copy;
+        ret += copy;
+        if(p_pending->i_buffer == 0)
+        {
+            block_Release(p_pending);
+            p_pending = NULL;
+        }
+    }
+    bytesRead += ret;
+
+    if(ret < len || /* set EOF */
+       contentLength == bytesRead )
+        reset();
+
+    return ret;
+}
+
+void LibVLCHTTPConnection::setUsed( bool b )
+{
+    available = !b;
+    /* Ends the stream, but not the shared connection */
+    if(available)
+        reset();
+}
+
 ConnectionFactory::ConnectionFactory()
 {
 }
@@ -430,3 +608,29 @@ AbstractConnection * StreamUrlConnectionFactory::createConnection(vlc_object_t *
 {
     return new (std::nothrow) StreamUrlConnection(p_object);
 }
+
+LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory(vlc_object_t *p_object)
+    : ConnectionFactory()
+{
+    void *jar = NULL;
+    if(var_InheritBool(p_object, "http-forward-cookies"))
+        jar = var_InheritAddress(p_object, "http-cookies");
+    http_mgr = vlc_http_mgr_create(p_object, static_cast<struct vlc_http_cookie_jar_t *>(jar),
+                                   var_InheritBool(p_object, "http2"));
+}
+
+LibVLCHTTPConnectionFactory::~LibVLCHTTPConnectionFactory()
+{
+    if(http_mgr)
+        vlc_http_mgr_destroy(http_mgr);
+}
+
+AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t *p_object,
+                                                                   const ConnectionParams &params)
+{
+    if((params.getScheme() != "http" && params.getScheme() != "https") ||
+        params.getHostname().empty() || !http_mgr)
+        return NULL;
+
+    return new (std::nothrow) LibVLCHTTPConnection(p_object, http_mgr);
+}
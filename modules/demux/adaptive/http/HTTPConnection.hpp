@@ -30,6 +30,10 @@
 #include <vlc_common.h>
 #include <string>
 
+struct vlc_http_mgr;
+struct vlc_http_msg;
+struct vlc_http_resource;
+
 namespace adaptive
 {
     namespace http
@@ -115,6 +119,31 @@ namespace adaptive
                 stream_t *p_streamurl;
        };
 
+       /* Goes through the http access connection manager, so that requests
+        * to the same server share one persistent (HTTP/2) connection */
+       class LibVLCHTTPConnection : public AbstractConnection
+       {
+            public:
+                LibVLCHTTPConnection(vlc_object_t *, struct vlc_http_mgr *);
+                virtual ~LibVLCHTTPConnection();
+
+                virtual bool    canReuse     (const ConnectionParams &) const;
+
+                virtual int     request     (const std::string& path, const BytesRange & = BytesRange());
+                virtual ssize_t read        (void *p_buffer, size_t len);
+
+                virtual void    setUsed( bool );
+
+            protected:
+                void reset();
+                struct vlc_http_mgr      *http_mgr;
+                struct vlc_http_resource *resource;
+                struct vlc_http_msg      *response;
+                block_t                  *p_pending; /* partially read data */
+                char                     *psz_useragent;
+                static const int          redirectCount = 5;
+       };
+
        class ConnectionFactory
        {
            public:
@@ -128,6 +157,17 @@ namespace adaptive
            public:
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
        };
+
+       class LibVLCHTTPConnectionFactory : public ConnectionFactory
+       {
+           public:
+               LibVLCHTTPConnectionFactory(vlc_object_t *);
+               virtual ~LibVLCHTTPConnectionFactory();
+               virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
+
+           private:
+               struct vlc_http_mgr *http_mgr;
+       };
     }
 }
 
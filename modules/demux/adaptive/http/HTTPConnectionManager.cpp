@@ -30,6 +30,7 @@
 #include "ConnectionParams.hpp"
 #include "Sockets.hpp"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 #include <vlc_url.h>
 
 using namespace adaptive::http;
@@ -45,17 +46,30 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
             factory = new (std::nothrow) StreamUrlConnectionFactory();
+        else if(var_InheritBool(p_object, "adaptive-shared-http"))
+            factory = new (std::nothrow) LibVLCHTTPConnectionFactory(p_object);
         else
             factory = new (std::nothrow) ConnectionFactory();
     }
     else
         factory = factory_;
+
+    cache = NULL;
+    const int64_t i_cachesize = var_InheritInteger(p_object, "adaptive-cache-size");
+    if(i_cachesize > 0)
+    {
+        char *psz_dir = var_InheritString(p_object, "adaptive-cache-path");
+        cache = new (std::nothrow) SegmentCache(p_object, (size_t)i_cachesize << 20,
+                                                psz_dir ? psz_dir : "");
+        free(psz_dir);
+    }
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     delete downloader;
-    delete factory;
     this->closeAllConnections();
+    delete factory;
+    delete cache;
     vlc_mutex_destroy(&lock);
 }
 
@@ -111,13 +125,29 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
     return conn;
 }
 
+void HTTPConnectionManager::releaseConnection(AbstractConnection *conn)
+{
+    /* Pool lookups check the flag under the lock */
+    vlc_mutex_lock(&lock);
+    conn->setUsed(false);
+    vlc_mutex_unlock(&lock);
+}
+
 void HTTPConnectionManager::updateDownloadRate(size_t size, mtime_t time)
 {
+    /* Reported by concurrent transfers */
+    vlc_mutex_lock(&lock);
     if(rateObserver)
         rateObserver->updateDownloadRate(size, time);
+    vlc_mutex_unlock(&lock);
 }
 
 void HTTPConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
 {
     rateObserver = obs;
 }
+
+SegmentCache * HTTPConnectionManager::getCache() const
+{
+    return cache;
+}
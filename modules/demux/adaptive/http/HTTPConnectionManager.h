@@ -39,6 +39,7 @@ namespace adaptive
         class ConnectionFactory;
         class AbstractConnection;
         class Downloader;
+        class SegmentCache;
 
         class HTTPConnectionManager : public IDownloadRateObserver
         {
@@ -48,9 +49,11 @@ namespace adaptive
 
                 void    closeAllConnections ();
                 AbstractConnection * getConnection(ConnectionParams &);
+                void    releaseConnection   (AbstractConnection *);
 
                 virtual void updateDownloadRate(size_t, mtime_t); /* reimpl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                SegmentCache * getCache() const;
                 Downloader *downloader;
 
             private:
@@ -60,6 +63,7 @@ namespace adaptive
                 vlc_object_t                                       *p_object;
                 IDownloadRateObserver                              *rateObserver;
                 ConnectionFactory                                  *factory;
+                SegmentCache                                       *cache;
                 AbstractConnection * reuseConnection(ConnectionParams &);
         };
     }
@@ -0,0 +1,301 @@
+/*
+ * SegmentCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SegmentCache.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_atomic.h>
+
+#include <new>
+#include <sstream>
+
+using namespace adaptive::http;
+
+namespace
+{
+    struct SharedData
+    {
+        block_t              *p_block;
+        std::atomic<unsigned> refs;
+    };
+
+    struct SharedView
+    {
+        block_t     self;
+        SharedData *p_data;
+    };
+}
+
+static void SharedViewRelease(block_t *p_block)
+{
+    SharedView *p_view = reinterpret_cast<SharedView *>(p_block);
+    if(--p_view->p_data->refs == 0)
+    {
+        block_Release(p_view->p_data->p_block);
+        delete p_view->p_data;
+    }
+    delete p_view;
+}
+
+static block_t * SharedViewNew(SharedData *p_data, uint8_t *p_buffer, size_t i_buffer)
+{
+    SharedView *p_view = new (std::nothrow) SharedView;
+    if(!p_view)
+        return NULL;
+    p_view->p_data = p_data;
+    p_data->refs++;
+    block_Init(&p_view->self, p_buffer, i_buffer);
+    p_view->self.pf_release = SharedViewRelease;
+    return &p_view->self;
+}
+
+block_t * SegmentCache::share(block_t *p_block)
+{
+    SharedData *p_data = new (std::nothrow) SharedData;
+    if(!p_data)
+        return NULL;
+    p_data->p_block = p_block;
+    p_data->refs = 0;
+
+    block_t *p_view = SharedViewNew(p_data, p_block->p_buffer, p_block->i_buffer);
+    if(!p_view)
+        delete p_data;
+    return p_view;
+}
+
+block_t * SegmentCache::reference(const block_t *p_block)
+{
+    const SharedView *p_view = reinterpret_cast<const SharedView *>(p_block);
+    return SharedViewNew(p_view->p_data, p_block->p_buffer, p_block->i_buffer);
+}
+
+SegmentCache::SegmentCache(vlc_object_t *p_obj_, size_t maxsize_, const std::string &dir_)
+{
+    p_obj = p_obj_;
+    maxsize = maxsize_;
+    dir = dir_;
+    totalsize = 0;
+    serial = 0;
+    vlc_mutex_init(&lock);
+}
+
+SegmentCache::~SegmentCache()
+{
+    std::list<std::string> unlinks;
+    while(!entries.empty())
+        evict(--entries.end(), unlinks);
+    unlinkFiles(unlinks);
+    vlc_mutex_destroy(&lock);
+}
+
+std::string SegmentCache::makeKey(const std::string &url, const BytesRange &range)
+{
+    std::stringstream ss;
+    ss << url;
+    if(range.isValid())
+        ss << "@" << range.getStartByte() << "-" << range.getEndByte();
+    return ss.str();
+}
+
+/* Files are only unlinked once the lock is released */
+void SegmentCache::evict(std::list<Entry>::iterator it, std::list<std::string> &unlinks)
+{
+    if(it->p_chain)
+        block_ChainRelease(it->p_chain);
+    else if(!it->path.empty())
+        unlinks.push_back(it->path);
+    totalsize -= it->size;
+    index.erase(it->key);
+    entries.erase(it);
+}
+
+void SegmentCache::unlinkFiles(const std::list<std::string> &paths)
+{
+    std::list<std::string>::const_iterator it;
+    for(it = paths.begin(); it != paths.end(); ++it)
+        vlc_unlink((*it).c_str());
+}
+
+bool SegmentCache::writeFile(const std::string &path, const block_t *p_chain)
+{
+    FILE *stream = vlc_fopen(path.c_str(), "wb");
+    if(!stream)
+        return false;
+
+    bool b_ret = true;
+    for(const block_t *p_block = p_chain; p_block && b_ret; p_block = p_block->p_next)
+        b_ret = fwrite(p_block->p_buffer, 1, p_block->i_buffer, stream) == p_block->i_buffer;
+    if(fclose(stream) != 0)
+        b_ret = false;
+    if(!b_ret)
+        vlc_unlink(path.c_str());
+    return b_ret;
+}
+
+block_t * SegmentCache::readFile(const std::string &path, size_t size)
+{
+    FILE *stream = vlc_fopen(path.c_str(), "rb");
+    if(!stream)
+        return NULL;
+
+    block_t *p_block = block_Alloc(size);
+    if(p_block && fread(p_block->p_buffer, 1, size, stream) != size)
+    {
+        block_Release(p_block);
+        p_block = NULL;
+    }
+    fclose(stream);
+
+    if(p_block)
+    {
+        block_t *p_view = share(p_block);
+        if(!p_view)
+            block_Release(p_block);
+        p_block = p_view;
+    }
+    return p_block;
+}
+
+block_t * SegmentCache::get(const std::string &url, const BytesRange &range)
+{
+    block_t *p_chain = NULL;
+    block_t **pp_tail = &p_chain;
+    const std::string key = makeKey(url, range);
+    std::string path;
+    size_t size = 0;
+
+    vlc_mutex_lock(&lock);
+    std::map<std::string, std::list<Entry>::iterator>::iterator it = index.find(key);
+    if(it != index.end())
+    {
+        std::list<Entry>::iterator entry = it->second;
+        /* Most recently used goes first */
+        entries.splice(entries.begin(), entries, entry);
+
+        for(const block_t *p_block = entry->p_chain; p_block; p_block = p_block->p_next)
+        {
+            block_t *p_ref = reference(p_block);
+            if(!p_ref)
+            {
+                block_ChainRelease(p_chain);
+                p_chain = NULL;
+                break;
+            }
+            block_ChainLastAppend(&pp_tail, p_ref);
+        }
+        path = entry->path;
+        size = entry->size;
+    }
+    vlc_mutex_unlock(&lock);
+
+    if(path.empty())
+        return p_chain;
+
+    p_chain = readFile(path, size);
+    if(!p_chain)
+    {
+        /* Lost or truncated behind our back */
+        std::list<std::string> unlinks;
+        vlc_mutex_lock(&lock);
+        it = index.find(key);
+        if(it != index.end() && it->second->path == path)
+            evict(it->second, unlinks);
+        vlc_mutex_unlock(&lock);
+        unlinkFiles(unlinks);
+    }
+    return p_chain;
+}
+
+void SegmentCache::put(const std::string &url, const BytesRange &range, block_t *p_chain)
+{
+    size_t size;
+    block_ChainProperties(p_chain, NULL, &size, NULL);
+    if(size == 0 || size > maxsize)
+    {
+        block_ChainRelease(p_chain);
+        return;
+    }
+
+    Entry entry;
+    entry.key = makeKey(url, range);
+    entry.size = size;
+    entry.p_chain = NULL;
+
+    vlc_mutex_lock(&lock);
+    const bool b_known = index.find(entry.key) != index.end();
+    const unsigned i_serial = serial++;
+    vlc_mutex_unlock(&lock);
+
+    if(b_known)
+    {
+        block_ChainRelease(p_chain);
+        return;
+    }
+
+    if(dir.empty())
+    {
+        entry.p_chain = p_chain;
+    }
+    else
+    {
+        char *psz_path;
+        if(asprintf(&psz_path, "%s" DIR_SEP "vlc-adaptive-%p-%u.seg",
+                    dir.c_str(), (void *)this, i_serial) == -1)
+        {
+            block_ChainRelease(p_chain);
+            return;
+        }
+        entry.path = psz_path;
+        free(psz_path);
+
+        const bool b_written = writeFile(entry.path, p_chain);
+        block_ChainRelease(p_chain);
+        if(!b_written)
+        {
+            msg_Warn(p_obj, "cannot write cache file %s", entry.path.c_str());
+            return;
+        }
+    }
+
+    std::list<std::string> unlinks;
+    vlc_mutex_lock(&lock);
+    /* Stored by another chunk meanwhile */
+    if(index.find(entry.key) != index.end())
+    {
+        if(entry.p_chain)
+            block_ChainRelease(entry.p_chain);
+        else
+            unlinks.push_back(entry.path);
+    }
+    else
+    {
+        while(totalsize + size > maxsize)
+            evict(--entries.end(), unlinks);
+        entries.push_front(entry);
+        index[entry.key] = entries.begin();
+        totalsize += size;
+    }
+    vlc_mutex_unlock(&lock);
+    unlinkFiles(unlinks);
+}
@@ -0,0 +1,84 @@
+/*
+ * SegmentCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEGMENTCACHE_HPP
+#define SEGMENTCACHE_HPP
+
+#include "BytesRange.hpp"
+
+#include <vlc_common.h>
+#include <list>
+#include <map>
+#include <string>
+
+namespace adaptive
+{
+
+    namespace http
+    {
+
+        /* Bounded LRU store of downloaded segments, keyed by url and
+         * byte range. Data is kept in memory, or in files under a
+         * directory when one is given.
+         * Segments go in and out as chains of read-only views, so that
+         * the memory is shared with the chunks instead of copied. */
+        class SegmentCache
+        {
+            public:
+                SegmentCache(vlc_object_t *, size_t, const std::string &);
+                ~SegmentCache();
+                block_t * get(const std::string &, const BytesRange &);
+                void      put(const std::string &, const BytesRange &, block_t *);
+
+                /* Turns a block into a read-only view of its data, which
+                 * is released along with the last view */
+                static block_t * share(block_t *);
+                /* Another view of the data of a view */
+                static block_t * reference(const block_t *);
+
+            private:
+                class Entry
+                {
+                    public:
+                        std::string key;
+                        size_t      size;
+                        block_t    *p_chain; /* in memory storage, views */
+                        std::string path;    /* on disk storage */
+                };
+                static std::string makeKey(const std::string &, const BytesRange &);
+                static bool writeFile(const std::string &, const block_t *);
+                static block_t * readFile(const std::string &, size_t);
+                void evict(std::list<Entry>::iterator, std::list<std::string> &);
+                static void unlinkFiles(const std::list<std::string> &);
+
+                vlc_object_t *p_obj;
+                vlc_mutex_t   lock;
+                std::list<Entry> entries; /* most recently used first */
+                std::map<std::string, std::list<Entry>::iterator> index;
+                size_t        totalsize;
+                size_t        maxsize;
+                std::string   dir;
+                unsigned      serial;
+        };
+
+    }
+
+}
+
+#endif // SEGMENTCACHE_HPP
@@ -57,7 +57,9 @@ namespace adaptive
                     AlwaysBest,
                     AlwaysLowest,
                     RateBased,
-                    FixedRate
+                    FixedRate,
+                    BufferBased,
+                    BufferBasedHybrid
                 };
         };
     }
@@ -0,0 +1,130 @@
+/*
+ * BolaRule.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BolaRule.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace adaptive::logic;
+
+BolaRule::BolaRule(mtime_t maxbuffer)
+{
+    /* Below the minimum, only the lowest bitrate is safe.
+     * The highest one is picked from the target on. */
+    minimumBuffer = std::max(maxbuffer / 4, (mtime_t) CLOCK_FREQ / 10);
+    targetBuffer = std::max(maxbuffer * 3 / 4, minimumBuffer * 2);
+    bpsAvg = 0;
+    dlsize = 0;
+    dllength = 0;
+}
+
+void BolaRule::addSample(size_t size, mtime_t time)
+{
+    /* Accumulate up to observation window */
+    dlsize += size;
+    dllength += time;
+    if(dllength < CLOCK_FREQ / 4)
+        return;
+
+    const uint64_t bps = CLOCK_FREQ * dlsize * 8 / dllength;
+    if(bpsAvg == 0)
+        bpsAvg = bps;
+    else
+        bpsAvg = (bpsAvg * 3 + bps) / 4;
+    dlsize = dllength = 0;
+}
+
+uint64_t BolaRule::getThroughput() const
+{
+    return bpsAvg;
+}
+
+unsigned BolaRule::bolaIndex(const std::vector<uint64_t> &bitrates, mtime_t level) const
+{
+    if(bitrates.size() < 2)
+        return 0;
+
+    /* Utility is the log of the bitrate ratio, lowest being 1 */
+    std::vector<double> utilities;
+    for(size_t i=0; i<bitrates.size(); i++)
+        utilities.push_back(log((double)bitrates[i] / bitrates[0]) + 1.0);
+
+    const double gp = (utilities.back() - 1.0) /
+                      ((double)targetBuffer / minimumBuffer - 1.0);
+    const double Vp = (double)minimumBuffer / CLOCK_FREQ / gp;
+    const double Q = (double)level / CLOCK_FREQ;
+
+    unsigned best = 0;
+    double bestscore = 0.0;
+    for(size_t i=0; i<bitrates.size(); i++)
+    {
+        const double score = (Vp * (utilities[i] + gp) - Q) / bitrates[i];
+        if(i == 0 || score >= bestscore)
+        {
+            bestscore = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+unsigned BolaRule::safeIndex(const std::vector<uint64_t> &bitrates, uint64_t bps)
+{
+    /* Highest sustainable bitrate, with a safety margin */
+    unsigned safe = 0;
+    for(size_t i=1; i<bitrates.size(); i++)
+    {
+        if(bitrates[i] <= bps * 9 / 10)
+            safe = i;
+    }
+    return safe;
+}
+
+unsigned BolaRule::select(const std::vector<uint64_t> &bitrates, mtime_t level,
+                          unsigned current, uint64_t bps) const
+{
+    const unsigned index = bolaIndex(bitrates, level);
+    if(index <= current)
+        return index;
+
+    /* The buffer fills up as soon as downloads keep up, and BOLA alone
+     * then overshoots and oscillates. As dash.js BOLA-O, only switch up
+     * as far as the throughput allows. */
+    return std::max(current, std::min(index, safeIndex(bitrates, bps)));
+}
+
+unsigned BolaRule::selectHybrid(const std::vector<uint64_t> &bitrates, mtime_t level,
+                                unsigned current, uint64_t bps) const
+{
+    const unsigned safe = safeIndex(bitrates, bps);
+
+    /* Startup or draining: the buffer says nothing yet, trust the network */
+    if(level < minimumBuffer)
+        return safe;
+
+    /* Climb as the network allows, but let the buffer
+     * absorb throughput drops instead of switching down */
+    const unsigned index = std::min(bolaIndex(bitrates, level), current);
+    return std::max(index, safe);
+}
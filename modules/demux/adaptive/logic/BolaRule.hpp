@@ -0,0 +1,63 @@
+/*
+ * BolaRule.hpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef BOLARULE_HPP
+#define BOLARULE_HPP
+
+#include <vector>
+#include <vlc_common.h>
+
+namespace adaptive
+{
+    namespace logic
+    {
+        /* Buffer Occupancy based Lyapunov Algorithm (Spiteri, Urgaonkar,
+         * Sitaraman), with the parameters and throughput fallback of the
+         * dash.js implementation.
+         * Works on bitrates only, so it can be replayed offline.
+         * Thresholds are scaled to how far ahead the player buffers. */
+        class BolaRule
+        {
+            public:
+                BolaRule(mtime_t);
+
+                void        addSample   (size_t, mtime_t);
+                uint64_t    getThroughput() const;
+
+                /* Both return an index into the ascending bitrates list,
+                 * from the level, current index and throughput */
+                unsigned    select      (const std::vector<uint64_t> &, mtime_t,
+                                         unsigned, uint64_t) const;
+                unsigned    selectHybrid(const std::vector<uint64_t> &, mtime_t,
+                                         unsigned, uint64_t) const;
+
+            private:
+                unsigned    bolaIndex   (const std::vector<uint64_t> &, mtime_t) const;
+                static unsigned safeIndex(const std::vector<uint64_t> &, uint64_t);
+
+                mtime_t     minimumBuffer;
+                mtime_t     targetBuffer;
+                uint64_t    bpsAvg;
+                size_t      dlsize;
+                mtime_t     dllength;
+        };
+    }
+}
+
+#endif // BOLARULE_HPP
@@ -0,0 +1,128 @@
+/*
+ * BufferBasedAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BufferBasedAdaptationLogic.hpp"
+
+#include "../playlist/BaseRepresentation.h"
+#include "../playlist/BaseAdaptationSet.h"
+#include "../tools/Debug.hpp"
+
+#include <algorithm>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+static bool bandwidthLess(const BaseRepresentation *a, const BaseRepresentation *b)
+{
+    return a->getBandwidth() < b->getBandwidth();
+}
+
+BufferBasedAdaptationLogic::BufferBasedAdaptationLogic(vlc_object_t *p_obj_, bool b_hybrid_,
+                                                       mtime_t maxbuffer) :
+                            AbstractAdaptationLogic(),
+                            rule(maxbuffer)
+{
+    p_obj = p_obj_;
+    b_hybrid = b_hybrid_;
+    usedBps = 0;
+    vlc_mutex_init(&lock);
+}
+
+BufferBasedAdaptationLogic::~BufferBasedAdaptationLogic()
+{
+    vlc_mutex_destroy(&lock);
+}
+
+BaseRepresentation *BufferBasedAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet,
+                                                                      BaseRepresentation *currep) const
+{
+    if(adaptSet == NULL)
+        return NULL;
+
+    std::vector<BaseRepresentation *> reps = adaptSet->getRepresentations();
+    if(reps.empty())
+        return NULL;
+    std::stable_sort(reps.begin(), reps.end(), bandwidthLess);
+
+    std::vector<uint64_t> bitrates;
+    unsigned current = 0;
+    for(size_t i=0; i<reps.size(); i++)
+    {
+        bitrates.push_back(reps[i]->getBandwidth());
+        if(reps[i] == currep)
+            current = i;
+    }
+
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+
+    std::map<const BaseAdaptationSet *, mtime_t>::const_iterator it = levels.find(adaptSet);
+    const mtime_t level = (it != levels.end()) ? it->second : 0;
+
+    /* Share the bandwidth with the other streams, as the rate based logic */
+    size_t availBps = rule.getThroughput() + ((currep) ? currep->getBandwidth() : 0);
+    if(availBps > usedBps)
+        availBps -= usedBps;
+    else
+        availBps = 0;
+
+    const unsigned index = (b_hybrid) ? rule.selectHybrid(bitrates, level, current, availBps)
+                                      : rule.select(bitrates, level, current, availBps);
+
+    BwDebug(msg_Dbg(p_obj, "buffer level %" PRId64 " ms, selecting %" PRIu64 " bps",
+                    level / 1000, bitrates[index]));
+
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+
+    return reps[index];
+}
+
+void BufferBasedAdaptationLogic::updateDownloadRate(size_t size, mtime_t time)
+{
+    if(unlikely(time == 0))
+        return;
+    vlc_mutex_lock(&lock);
+    rule.addSample(size, time);
+    vlc_mutex_unlock(&lock);
+}
+
+void BufferBasedAdaptationLogic::trackerEvent(const SegmentTrackerEvent &event)
+{
+    vlc_mutex_lock(&lock);
+    switch(event.type)
+    {
+        case SegmentTrackerEvent::SWITCHING:
+            if(event.u.switching.prev)
+                usedBps -= event.u.switching.prev->getBandwidth();
+            if(event.u.switching.next)
+                usedBps += event.u.switching.next->getBandwidth();
+            break;
+
+        case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+            levels[event.u.buffering.set] = event.u.buffering.current;
+            break;
+
+        default:
+            break;
+    }
+    vlc_mutex_unlock(&lock);
+}
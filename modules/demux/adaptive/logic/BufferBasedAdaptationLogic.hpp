@@ -0,0 +1,53 @@
+/*
+ * BufferBasedAdaptationLogic.hpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef BUFFERBASEDADAPTATIONLOGIC_HPP
+#define BUFFERBASEDADAPTATIONLOGIC_HPP
+
+#include "AbstractAdaptationLogic.h"
+#include "BolaRule.hpp"
+
+#include <map>
+
+namespace adaptive
+{
+    namespace logic
+    {
+        class BufferBasedAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                BufferBasedAdaptationLogic          (vlc_object_t *, bool, mtime_t);
+                virtual ~BufferBasedAdaptationLogic ();
+
+                BaseRepresentation *getNextRepresentation(BaseAdaptationSet *, BaseRepresentation *) const;
+                virtual void updateDownloadRate(size_t, mtime_t); /* reimpl */
+                virtual void trackerEvent(const SegmentTrackerEvent &); /* reimpl */
+
+            private:
+                vlc_object_t *          p_obj;
+                bool                    b_hybrid; /* throughput assisted */
+                BolaRule                rule;
+                std::map<const BaseAdaptationSet *, mtime_t> levels;
+                size_t                  usedBps;
+                vlc_mutex_t             lock;
+        };
+    }
+}
+
+#endif // BUFFERBASEDADAPTATIONLOGIC_HPP
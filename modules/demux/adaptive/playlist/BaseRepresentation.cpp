@@ -35,6 +35,7 @@
 
 using namespace adaptive;
 using namespace adaptive::playlist;
+using namespace adaptive::http;
 
 BaseRepresentation::BaseRepresentation( BaseAdaptationSet *set ) :
                 SegmentInformation( set ),
@@ -78,7 +79,7 @@ bool BaseRepresentation::needsUpdate() const
     return false;
 }
 
-bool BaseRepresentation::runLocalUpdates(mtime_t, uint64_t, bool)
+bool BaseRepresentation::runLocalUpdates(mtime_t, uint64_t, bool, HTTPConnectionManager *)
 {
     return false;
 }
@@ -34,6 +34,11 @@
 
 namespace adaptive
 {
+    namespace http
+    {
+        class HTTPConnectionManager;
+    }
+
     namespace playlist
     {
         class BaseAdaptationSet;
@@ -63,7 +68,8 @@ namespace adaptive
 
                 virtual mtime_t     getMinAheadTime         (uint64_t) const;
                 virtual bool        needsUpdate             () const;
-                virtual bool        runLocalUpdates         (mtime_t, uint64_t, bool);
+                virtual bool        runLocalUpdates         (mtime_t, uint64_t, bool,
+                                                             http::HTTPConnectionManager *);
                 virtual void        scheduleNextUpdate      (uint64_t);
 
                 virtual void        debug                   (vlc_object_t *,int = 0) const;
@@ -34,10 +34,20 @@ using namespace adaptive::http;
 block_t * Retrieve::HTTP(vlc_object_t *obj, const std::string &uri)
 {
     HTTPConnectionManager connManager(obj);
+    return HTTP(obj, &connManager, uri);
+}
+
+/* Reuses the connections of the running session, when there is one */
+block_t * Retrieve::HTTP(vlc_object_t *obj, HTTPConnectionManager *connManager,
+                         const std::string &uri)
+{
+    if(!connManager)
+        return HTTP(obj, uri);
+
     HTTPChunk *datachunk;
     try
     {
-        datachunk = new HTTPChunk(uri, &connManager);
+        datachunk = new HTTPChunk(uri, connManager);
     } catch (int) {
         return NULL;
     }
@@ -25,10 +25,17 @@
 
 namespace adaptive
 {
+    namespace http
+    {
+        class HTTPConnectionManager;
+    }
+
     class Retrieve
     {
         public:
             static block_t * HTTP(vlc_object_t *, const std::string &uri);
+            static block_t * HTTP(vlc_object_t *, http::HTTPConnectionManager *,
+                                  const std::string &uri);
     };
 }
 
@@ -45,6 +45,7 @@
 
 #include "libavi.h"
 #include "../rawdv.h"
+#include "../index_cache.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -57,6 +58,11 @@
     "Recreate a index for the AVI file. Use this if your AVI file is damaged "\
     "or incomplete (not seekable)." )
 
+#define INDEX_CACHE_TEXT N_("Cache rebuilt indexes")
+#define INDEX_CACHE_LONGTEXT N_( \
+    "Save the indexes rebuilt for damaged AVI files to the user cache " \
+    "directory, so that they do not need to be rebuilt the next time.")
+
 #define BI_RAWRGB 0x00
 #define BI_RGBBITFIELDS 0x03
 
@@ -82,6 +88,8 @@ vlc_module_begin ()
     add_integer( "avi-index", 0,
               INDEX_TEXT, INDEX_LONGTEXT, false )
         change_integer_list( pi_index, ppsz_indexes )
+    add_bool( "avi-index-cache", true,
+              INDEX_CACHE_TEXT, INDEX_CACHE_LONGTEXT, true )
 
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -140,6 +148,24 @@ static void avi_index_Init( avi_index_t * );
 static void avi_index_Clean( avi_index_t * );
 static void avi_index_Append( avi_index_t *, off_t *, avi_entry_t * );
 
+/* Background index creation, for files with a broken or missing index */
+typedef struct
+{
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait;       /* signaled once the found chunks are merged */
+    bool            b_quit;
+    bool            b_done;
+    bool            b_complete; /* the whole file was walked */
+
+    stream_t        *s;         /* our own stream, the demuxer keeps reading */
+
+    /* One index per track, holding the chunks found since the last merge
+     * into the tracks by the demuxer thread */
+    avi_index_t     *p_idx;
+    off_t           i_last_pos;
+} avi_indexer_t;
+
 typedef struct
 {
     bool            b_activated;
@@ -181,6 +207,10 @@ struct demux_sys_t
     bool  b_seekable;
     bool  b_fastseekable;
     bool  b_indexloaded; /* if we read indexes from end of file before starting */
+    avi_indexer_t *p_indexer; /* index being created in the background */
+    char  *psz_index_cache;  /* rebuilt index cache file, or NULL */
+    bool  b_index_cache_save; /* the background index is to be saved */
+    uint8_t index_key[INDEX_CACHE_KEY_SIZE]; /* identity of the cached file */
     mtime_t i_read_increment;
     uint32_t i_avih_flags;
     avi_chunk_t ck_root;
@@ -221,13 +251,18 @@ static int AVI_StreamBytesSet ( demux_t *,
 vlc_fourcc_t AVI_FourccGetCodec( unsigned int i_cat, vlc_fourcc_t );
 static int   AVI_GetKeyFlag    ( vlc_fourcc_t , uint8_t * );
 
-static int AVI_PacketGetHeader( demux_t *, avi_packet_t *p_pk );
-static int AVI_PacketNext     ( demux_t * );
+static int AVI_PacketGetHeader( stream_t *, avi_packet_t *p_pk );
+static int AVI_PacketNext     ( stream_t * );
 static int AVI_PacketRead     ( demux_t *, avi_packet_t *, block_t **);
-static int AVI_PacketSearch   ( demux_t * );
+static int AVI_PacketSearch   ( demux_t *, stream_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
-static void AVI_IndexCreate  ( demux_t * );
+static bool AVI_IndexCreate  ( demux_t * );
+static void AVI_IndexFix     ( demux_t * );
+static int  AVI_IndexCacheLoad( demux_t * );
+static void AVI_IndexCacheSave( demux_t * );
+static void AVI_IndexerMerge ( demux_t * );
+static void AVI_IndexerStop  ( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -711,7 +746,7 @@ static int Open( vlc_object_t * p_this )
 aviindex:
         if( p_sys->b_fastseekable )
         {
-            AVI_IndexCreate( p_demux );
+            AVI_IndexFix( p_demux );
         }
         else if( p_sys->b_seekable )
         {
@@ -727,8 +762,13 @@ aviindex:
         AVI_IndexLoad( p_demux );
     }
 
+indexloaded:
     /* *** movie length in sec *** */
     p_sys->i_length = AVI_MovieGetLength( p_demux );
+    /* until the background indexer is done, trust the header */
+    if( p_sys->p_indexer && !p_sys->i_length )
+        p_sys->i_length = (mtime_t)p_avih->i_totalframes *
+                          (mtime_t)p_avih->i_microsecperframe / CLOCK_FREQ;
 
     /* Check the index completeness */
     unsigned int i_idx_totalframes = 0;
@@ -751,6 +791,11 @@ aviindex:
                 b_index = true;
                 goto aviindex;
             }
+            if( AVI_IndexCacheLoad( p_demux ) == VLC_SUCCESS )
+            {
+                b_index = true;
+                goto indexloaded;
+            }
             if( i_do_index == 0 )
             {
                 const char *psz_msg = _(
@@ -845,6 +890,8 @@ error:
     if( p_sys->meta )
         vlc_meta_Delete( p_sys->meta );
 
+    AVI_IndexerStop( p_demux );
+    free( p_sys->psz_index_cache );
     AVI_ChunkFreeRoot( p_demux->s, &p_sys->ck_root );
     free( p_sys );
     return b_aborted ? VLC_ETIMEOUT : VLC_EGENERIC;
@@ -858,6 +905,11 @@ static void Close ( vlc_object_t * p_this )
     demux_t *    p_demux = (demux_t *)p_this;
     demux_sys_t *p_sys = p_demux->p_sys  ;
 
+    AVI_IndexerStop( p_demux );
+    if( p_sys->b_index_cache_save )
+        AVI_IndexCacheSave( p_demux );
+    free( p_sys->psz_index_cache );
+
     for( unsigned int i = 0; i < p_sys->i_track; i++ )
     {
         if( p_sys->track[i] )
@@ -981,6 +1033,9 @@ static int Demux_Seekable( demux_t *p_demux )
     /* cannot be more than 100 stream (dcXX or wbXX) */
     avi_track_toread_t toread[100];
 
+    /* pick up what the background indexer found so far */
+    if( p_sys->p_indexer )
+        AVI_IndexerMerge( p_demux );
 
     /* detect new selected/unselected streams */
     for( i_track = 0; i_track < p_sys->i_track; i_track++ )
@@ -1118,7 +1173,7 @@ static int Demux_Seekable( demux_t *p_demux )
             if( p_sys->b_seekable && p_sys->i_movi_lastchunk_pos >= p_sys->i_movi_begin + 12 )
             {
                 stream_Seek( p_demux->s, p_sys->i_movi_lastchunk_pos );
-                if( AVI_PacketNext( p_demux ) )
+                if( AVI_PacketNext( p_demux->s ) )
                 {
                     return( AVI_TrackStopFinishedStreams( p_demux ) ? 0 : 1 );
                 }
@@ -1132,7 +1187,7 @@ static int Demux_Seekable( demux_t *p_demux )
             {
                 avi_packet_t avi_pk;
 
-                if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+                if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
                 {
                     msg_Warn( p_demux,
                              "cannot get packet header, track disabled" );
@@ -1141,7 +1196,7 @@ static int Demux_Seekable( demux_t *p_demux )
                 if( avi_pk.i_stream >= p_sys->i_track ||
                     ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
                 {
-                    if( AVI_PacketNext( p_demux ) )
+                    if( AVI_PacketNext( p_demux->s ) )
                     {
                         msg_Warn( p_demux,
                                   "cannot skip packet, track disabled" );
@@ -1182,7 +1237,7 @@ static int Demux_Seekable( demux_t *p_demux )
                     }
                     else
                     {
-                        if( AVI_PacketNext( p_demux ) )
+                        if( AVI_PacketNext( p_demux->s ) )
                         {
                             msg_Warn( p_demux,
                                       "cannot skip packet, track disabled" );
@@ -1380,7 +1435,7 @@ static int Demux_UnSeekable( demux_t *p_demux )
 
         avi_packet_t    avi_pk;
 
-        if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+        if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
         {
             return VLC_DEMUXER_EOF;
         }
@@ -1397,17 +1452,17 @@ static int Demux_UnSeekable( demux_t *p_demux )
                 case AVIFOURCC_JUNK:
                 case AVIFOURCC_LIST:
                 case AVIFOURCC_RIFF:
-                    return( !AVI_PacketNext( p_demux ) ? 1 : 0 );
+                    return( !AVI_PacketNext( p_demux->s ) ? 1 : 0 );
                 case AVIFOURCC_idx1:
                     if( p_sys->b_odml )
                     {
-                        return( !AVI_PacketNext( p_demux ) ? 1 : 0 );
+                        return( !AVI_PacketNext( p_demux->s ) ? 1 : 0 );
                     }
                     return VLC_DEMUXER_EOF;
                 default:
                     msg_Warn( p_demux,
                               "seems to have lost position @%ld, resync", stream_Tell(p_demux->s) );
-                    if( AVI_PacketSearch( p_demux ) )
+                    if( AVI_PacketSearch( p_demux, p_demux->s ) )
                     {
                         msg_Err( p_demux, "resync failed" );
                         return VLC_DEMUXER_EGENERIC;
@@ -1443,7 +1498,7 @@ static int Demux_UnSeekable( demux_t *p_demux )
             }
             else
             {
-                if( AVI_PacketNext( p_demux ) )
+                if( AVI_PacketNext( p_demux->s ) )
                 {
                     return VLC_DEMUXER_EOF;
                 }
@@ -1483,6 +1538,10 @@ static int Seek( demux_t *p_demux, mtime_t i_date, int i_percent )
     {
         int64_t i_pos_backup = stream_Tell( p_demux->s );
 
+        /* Seeking into the part indexed in the background is immediate */
+        if( p_sys->p_indexer )
+            AVI_IndexerMerge( p_demux );
+
         /* Check and lazy load indexes if it was not done (not fastseekable) */
         if ( !p_sys->b_indexloaded && ( p_sys->i_avih_flags & AVIF_HASINDEX ) )
         {
@@ -1810,7 +1869,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
     if( p_sys->i_movi_lastchunk_pos >= p_sys->i_movi_begin + 12 )
     {
         stream_Seek( p_demux->s, p_sys->i_movi_lastchunk_pos );
-        if( AVI_PacketNext( p_demux ) )
+        if( AVI_PacketNext( p_demux->s ) )
         {
             return VLC_EGENERIC;
         }
@@ -1822,7 +1881,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
 
     for( ;; )
     {
-        if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+        if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
         {
             msg_Warn( p_demux, "cannot get packet header" );
             return VLC_EGENERIC;
@@ -1830,7 +1889,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
         if( avi_pk.i_stream >= p_sys->i_track ||
             ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
         {
-            if( AVI_PacketNext( p_demux ) )
+            if( AVI_PacketNext( p_demux->s ) )
             {
                 return VLC_EGENERIC;
             }
@@ -1864,7 +1923,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
                 return VLC_SUCCESS;
             }
 
-            if( AVI_PacketNext( p_demux ) )
+            if( AVI_PacketNext( p_demux->s ) )
             {
                 return VLC_EGENERIC;
             }
@@ -2162,17 +2221,17 @@ static void AVI_ParseStreamHeader( vlc_fourcc_t i_id,
 /****************************************************************************
  *
  ****************************************************************************/
-static int AVI_PacketGetHeader( demux_t *p_demux, avi_packet_t *p_pk )
+static int AVI_PacketGetHeader( stream_t *s, avi_packet_t *p_pk )
 {
     const uint8_t *p_peek;
 
-    if( stream_Peek( p_demux->s, &p_peek, 16 ) < 16 )
+    if( stream_Peek( s, &p_peek, 16 ) < 16 )
     {
         return VLC_EGENERIC;
     }
     p_pk->i_fourcc  = VLC_FOURCC( p_peek[0], p_peek[1], p_peek[2], p_peek[3] );
     p_pk->i_size    = GetDWLE( p_peek + 4 );
-    p_pk->i_pos     = stream_Tell( p_demux->s );
+    p_pk->i_pos     = stream_Tell( s );
     if( p_pk->i_fourcc == AVIFOURCC_LIST || p_pk->i_fourcc == AVIFOURCC_RIFF )
     {
         p_pk->i_type = VLC_FOURCC( p_peek[8],  p_peek[9],
@@ -2189,12 +2248,12 @@ static int AVI_PacketGetHeader( demux_t *p_demux, avi_packet_t *p_pk )
     return VLC_SUCCESS;
 }
 
-static int AVI_PacketNext( demux_t *p_demux )
+static int AVI_PacketNext( stream_t *s )
 {
     avi_packet_t    avi_ck;
     int             i_skip = 0;
 
-    if( AVI_PacketGetHeader( p_demux, &avi_ck ) )
+    if( AVI_PacketGetHeader( s, &avi_ck ) )
     {
         return VLC_EGENERIC;
     }
@@ -2214,7 +2273,7 @@ static int AVI_PacketNext( demux_t *p_demux )
         i_skip = __EVEN( avi_ck.i_size ) + 8;
     }
 
-    if( stream_Read( p_demux->s, NULL, i_skip ) != i_skip )
+    if( stream_Read( s, NULL, i_skip ) != i_skip )
     {
         return VLC_EGENERIC;
     }
@@ -2244,7 +2303,7 @@ static int AVI_PacketRead( demux_t   *p_demux,
     return VLC_SUCCESS;
 }
 
-static int AVI_PacketSearch( demux_t *p_demux )
+static int AVI_PacketSearch( demux_t *p_demux, stream_t *s )
 {
     demux_sys_t     *p_sys = p_demux->p_sys;
     avi_packet_t    avi_pk;
@@ -2252,11 +2311,11 @@ static int AVI_PacketSearch( demux_t *p_demux )
 
     for( ;; )
     {
-        if( stream_Read( p_demux->s, NULL, 1 ) != 1 )
+        if( stream_Read( s, NULL, 1 ) != 1 )
         {
             return VLC_EGENERIC;
         }
-        AVI_PacketGetHeader( p_demux, &avi_pk );
+        AVI_PacketGetHeader( s, &avi_pk );
         if( avi_pk.i_stream < p_sys->i_track &&
             ( avi_pk.i_cat == AUDIO_ES || avi_pk.i_cat == VIDEO_ES ) )
         {
@@ -2604,67 +2663,49 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
-static void AVI_IndexCreate( demux_t *p_demux )
+/* Returns false to abort the index creation */
+typedef bool (*avi_index_progress_cb)( demux_t *, stream_t *, void * );
+
+/**
+ * Walks the LIST-movi chunks of s, appending every stream chunk to p_idx
+ * (one index per track). The appends are done with p_lock held, if any.
+ *
+ * \return false if pf_progress aborted the walk, true once it is over
+ */
+static bool AVI_IndexWalk( demux_t *p_demux, stream_t *s,
+                           avi_index_t *p_idx, off_t *pi_last_pos,
+                           vlc_mutex_t *p_lock,
+                           avi_index_progress_cb pf_progress, void *p_data )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     avi_chunk_list_t *p_riff;
     avi_chunk_list_t *p_movi;
 
-    unsigned int i_stream;
     off_t i_movi_end;
 
-    mtime_t i_dialog_update;
-    vlc_dialog_id *p_dialog_id = NULL;
-
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
 
     if( !p_movi )
     {
         msg_Err( p_demux, "cannot find p_movi" );
-        return;
+        return true;
     }
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
-        avi_index_Init( &p_sys->track[i_stream]->idx );
-
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
-                        stream_Size( p_demux->s ) );
-
-    stream_Seek( p_demux->s, p_movi->i_chunk_pos + 12 );
-    msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+                        stream_Size( s ) );
 
-
-    /* Only show dialog if AVI is > 10MB */
-    i_dialog_update = mdate();
-    if( stream_Size( p_demux->s ) > 10000000 )
-    {
-        p_dialog_id =
-            vlc_dialog_display_progress( p_demux, false, 0.0, _("Cancel"),
-                                         _("Broken or missing AVI Index"),
-                                         _("Fixing AVI Index...") );
-    }
+    stream_Seek( s, p_movi->i_chunk_pos + 12 );
 
     for( ;; )
     {
         avi_packet_t pk;
 
-        /* Don't update/check dialog too often */
-        if( p_dialog_id != NULL && mdate() - i_dialog_update > 100000 )
-        {
-            if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
-                break;
-
-            double f_current = stream_Tell( p_demux->s );
-            double f_size    = stream_Size( p_demux->s );
-            double f_pos     = f_current / f_size;
-            vlc_dialog_update_progress( p_demux, p_dialog_id, f_pos );
-
-            i_dialog_update = mdate();
-        }
+        if( !pf_progress( p_demux, s, p_data ) )
+            return false;
 
-        if( AVI_PacketGetHeader( p_demux, &pk ) )
+        if( AVI_PacketGetHeader( s, &pk ) )
             break;
 
         if( pk.i_stream < p_sys->i_track &&
@@ -2678,7 +2719,12 @@ static void AVI_IndexCreate( demux_t *p_demux )
             index.i_pos     = pk.i_pos;
             index.i_length  = pk.i_size;
             index.i_lengthtotal = pk.i_size;
-            avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+
+            if( p_lock )
+                vlc_mutex_lock( p_lock );
+            avi_index_Append( &p_idx[pk.i_stream], pi_last_pos, &index );
+            if( p_lock )
+                vlc_mutex_unlock( p_lock );
         }
         else
         {
@@ -2692,11 +2738,11 @@ static void AVI_IndexCreate( demux_t *p_demux )
                                             AVIFOURCC_RIFF, 1 );
 
                     msg_Dbg( p_demux, "looking for new RIFF chunk" );
-                    if( stream_Seek( p_demux->s, p_sysx->i_chunk_pos + 24 ) )
-                        goto print_stat;
+                    if( stream_Seek( s, p_sysx->i_chunk_pos + 24 ) )
+                        return true;
                     break;
                 }
-                goto print_stat;
+                return true;
 
             case AVIFOURCC_RIFF:
                     msg_Dbg( p_demux, "new RIFF chunk found" );
@@ -2708,30 +2754,446 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
             default:
                 msg_Warn( p_demux, "need resync, probably broken avi" );
-                if( AVI_PacketSearch( p_demux ) )
+                if( AVI_PacketSearch( p_demux, s ) )
                 {
                     msg_Warn( p_demux, "lost sync, abord index creation" );
-                    goto print_stat;
+                    return true;
                 }
             }
         }
 
         if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end ) ||
-            AVI_PacketNext( p_demux ) )
+            AVI_PacketNext( s ) )
         {
             break;
         }
     }
+    return true;
+}
 
-print_stat:
-    if( p_dialog_id != NULL )
-        vlc_dialog_release( p_demux, p_dialog_id );
+typedef struct
+{
+    vlc_dialog_id *p_dialog_id;
+    mtime_t       i_dialog_update;
+} avi_index_dialog_t;
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+static bool AVI_IndexDialogProgress( demux_t *p_demux, stream_t *s,
+                                     void *p_data )
+{
+    avi_index_dialog_t *p_dialog = p_data;
+
+    /* Don't update/check dialog too often */
+    if( p_dialog->p_dialog_id != NULL &&
+        mdate() - p_dialog->i_dialog_update > 100000 )
+    {
+        if( vlc_dialog_is_cancelled( p_demux, p_dialog->p_dialog_id ) )
+            return false;
+
+        double f_current = stream_Tell( s );
+        double f_size    = stream_Size( s );
+        double f_pos     = f_current / f_size;
+        vlc_dialog_update_progress( p_demux, p_dialog->p_dialog_id, f_pos );
+
+        p_dialog->i_dialog_update = mdate();
+    }
+    return true;
+}
+
+static void AVI_IndexReset( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_Clean( &p_sys->track[i]->idx );
+        avi_index_Init( &p_sys->track[i]->idx );
+    }
+    p_sys->i_movi_lastchunk_pos = 0;
+}
+
+/* Returns true if the whole file was indexed */
+static bool AVI_IndexCreate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    assert( p_sys->i_track <= 100 );
+    avi_index_t p_idx[p_sys->i_track];
+    avi_index_dialog_t dialog;
+
+    AVI_IndexReset( p_demux );
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Init( &p_idx[i] );
+
+    msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+
+    /* Only show dialog if AVI is > 10MB */
+    dialog.p_dialog_id = NULL;
+    dialog.i_dialog_update = mdate();
+    if( stream_Size( p_demux->s ) > 10000000 )
     {
+        dialog.p_dialog_id =
+            vlc_dialog_display_progress( p_demux, false, 0.0, _("Cancel"),
+                                         _("Broken or missing AVI Index"),
+                                         _("Fixing AVI Index...") );
+    }
+
+    bool b_complete = AVI_IndexWalk( p_demux, p_demux->s, p_idx,
+                                     &p_sys->i_movi_lastchunk_pos, NULL,
+                                     AVI_IndexDialogProgress, &dialog );
+
+    if( dialog.p_dialog_id != NULL )
+        vlc_dialog_release( p_demux, dialog.p_dialog_id );
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        p_sys->track[i]->idx = p_idx[i];
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
-                i_stream, p_sys->track[i_stream]->idx.i_size );
+                i, p_idx[i].i_size );
     }
+    return b_complete;
+}
+
+/*****************************************************************************
+ * Rebuilt index cache
+ *****************************************************************************
+ * Indexes rebuilt from LIST-movi are saved in the user cache directory, in
+ * a file named after the URL and identity key of the AVI file.
+ *****************************************************************************/
+#define AVI_INDEX_CACHE_MAGIC   "VLCAVIDX"
+#define AVI_INDEX_CACHE_VERSION 2
+#define AVI_INDEX_CACHE_ENTRY   20
+
+static char *AVI_IndexCacheGetPath( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !var_InheritBool( p_demux, "avi-index-cache" ) ||
+        index_cache_GetKey( p_demux->s, p_sys->index_key ) )
+        return NULL;
+
+    return index_cache_GetPath( p_demux->s, "avi-index", p_sys->index_key );
+}
+
+/* Loads the indexes of the tracks from the cache */
+static int AVI_IndexCacheLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->psz_index_cache )
+        p_sys->psz_index_cache = AVI_IndexCacheGetPath( p_demux );
+    if( !p_sys->psz_index_cache )
+        return VLC_EGENERIC;
+
+    FILE *f = index_cache_Open( VLC_OBJECT(p_demux), p_sys->psz_index_cache,
+                                AVI_INDEX_CACHE_MAGIC, AVI_INDEX_CACHE_VERSION,
+                                p_sys->index_key );
+    if( !f )
+        return VLC_EGENERIC;
+
+    assert( p_sys->i_track <= 100 );
+    avi_index_t p_idx[p_sys->i_track];
+    off_t i_last_pos = 0;
+    const uint64_t i_size = stream_Size( p_demux->s );
+    uint8_t p_buf[AVI_INDEX_CACHE_ENTRY];
+    unsigned i_track;
+
+    for( i_track = 0; i_track < p_sys->i_track; i_track++ )
+        avi_index_Init( &p_idx[i_track] );
+
+    if( fread( p_buf, 4, 1, f ) != 1 ||
+        GetDWLE( &p_buf[0] ) != p_sys->i_track )
+        goto error;
+
+    for( i_track = 0; i_track < p_sys->i_track; i_track++ )
+    {
+        if( fread( p_buf, 8, 1, f ) != 1 ||
+            GetDWLE( &p_buf[0] ) != p_sys->track[i_track]->i_codec )
+            goto error;
+
+        for( uint32_t i_count = GetDWLE( &p_buf[4] ); i_count > 0; i_count-- )
+        {
+            avi_entry_t index;
+
+            if( fread( p_buf, AVI_INDEX_CACHE_ENTRY, 1, f ) != 1 )
+                goto error;
+            index.i_id      = GetDWLE( &p_buf[0] );
+            index.i_flags   = GetDWLE( &p_buf[4] );
+            index.i_pos     = GetQWLE( &p_buf[8] );
+            index.i_length  = GetDWLE( &p_buf[16] );
+            if( (uint64_t)index.i_pos >= i_size )
+                goto error;
+
+            avi_index_Append( &p_idx[i_track], &i_last_pos, &index );
+            if( !p_idx[i_track].p_entry )
+                goto error;
+        }
+    }
+    fclose( f );
+
+    AVI_IndexReset( p_demux );
+    for( i_track = 0; i_track < p_sys->i_track; i_track++ )
+    {
+        p_sys->track[i_track]->idx = p_idx[i_track];
+        msg_Dbg( p_demux, "stream[%u] loaded %u cached index entries",
+                 i_track, p_idx[i_track].i_size );
+    }
+    p_sys->i_movi_lastchunk_pos = i_last_pos;
+    return VLC_SUCCESS;
+
+error:
+    msg_Warn( p_demux, "ignoring invalid index cache %s",
+              p_sys->psz_index_cache );
+    fclose( f );
+    for( i_track = 0; i_track < p_sys->i_track; i_track++ )
+        avi_index_Clean( &p_idx[i_track] );
+    return VLC_EGENERIC;
+}
+
+/* Saves the track indexes */
+static void AVI_IndexCacheSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const char *psz_path = p_sys->psz_index_cache;
+
+    FILE *f = index_cache_Create( VLC_OBJECT(p_demux), psz_path,
+                                  AVI_INDEX_CACHE_MAGIC,
+                                  AVI_INDEX_CACHE_VERSION, p_sys->index_key );
+    if( !f )
+        return;
+
+    uint8_t p_buf[AVI_INDEX_CACHE_ENTRY];
+    bool b_error = false;
+
+    SetDWLE( &p_buf[0], p_sys->i_track );
+    b_error |= fwrite( p_buf, 4, 1, f ) != 1;
+
+    for( unsigned i = 0; i < p_sys->i_track && !b_error; i++ )
+    {
+        SetDWLE( &p_buf[0], p_sys->track[i]->i_codec );
+        const avi_index_t *p_idx = &p_sys->track[i]->idx;
+        SetDWLE( &p_buf[4], p_idx->i_size );
+        b_error |= fwrite( p_buf, 8, 1, f ) != 1;
+
+        for( unsigned j = 0; j < p_idx->i_size && !b_error; j++ )
+        {
+            const avi_entry_t *p_entry = &p_idx->p_entry[j];
+
+            SetDWLE( &p_buf[0], p_entry->i_id );
+            SetDWLE( &p_buf[4], p_entry->i_flags );
+            SetQWLE( &p_buf[8], p_entry->i_pos );
+            SetDWLE( &p_buf[16], p_entry->i_length );
+            b_error |= fwrite( p_buf, AVI_INDEX_CACHE_ENTRY, 1, f ) != 1;
+        }
+    }
+
+    index_cache_Commit( VLC_OBJECT(p_demux), f, psz_path, b_error );
+}
+
+/*****************************************************************************
+ * Background index creation
+ *****************************************************************************
+ * The indexer walks the file with its own stream while the demuxer starts
+ * playing. The demuxer merges what was found so far into the track indexes
+ * before demuxing and seeking, so the already indexed part is seekable.
+ *****************************************************************************/
+#define AVI_INDEXER_PENDING_MAX 16384
+
+static bool AVI_IndexerProgress( demux_t *p_demux, stream_t *s, void *p_data )
+{
+    avi_indexer_t *p_indexer = p_data;
+    const unsigned i_track = p_demux->p_sys->i_track;
+    VLC_UNUSED(s);
+
+    vlc_mutex_lock( &p_indexer->lock );
+    /* Do not run too far ahead of the demuxer (while paused for instance),
+     * so that the found chunks never add up to a second copy of the index */
+    for( ;; )
+    {
+        unsigned i_pending = 0;
+        for( unsigned i = 0; i < i_track; i++ )
+            i_pending += p_indexer->p_idx[i].i_size;
+        if( p_indexer->b_quit || i_pending < AVI_INDEXER_PENDING_MAX )
+            break;
+        vlc_cond_wait( &p_indexer->wait, &p_indexer->lock );
+    }
+    bool b_quit = p_indexer->b_quit;
+    vlc_mutex_unlock( &p_indexer->lock );
+
+    return !b_quit;
+}
+
+static void *AVI_IndexerThread( void *p_data )
+{
+    demux_t *p_demux = p_data;
+    avi_indexer_t *p_indexer = p_demux->p_sys->p_indexer;
+    mtime_t i_start = mdate();
+
+    bool b_complete = AVI_IndexWalk( p_demux, p_indexer->s, p_indexer->p_idx,
+                                     &p_indexer->i_last_pos, &p_indexer->lock,
+                                     AVI_IndexerProgress, p_indexer );
+    if( b_complete )
+        msg_Dbg( p_demux, "index created in %"PRId64" ms",
+                 ( mdate() - i_start ) / 1000 );
+
+    vlc_mutex_lock( &p_indexer->lock );
+    p_indexer->b_done = true;
+    p_indexer->b_complete = b_complete;
+    vlc_mutex_unlock( &p_indexer->lock );
+    return NULL;
+}
+
+static int AVI_IndexerStart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_demux->s->psz_url )
+        return VLC_EGENERIC;
+
+    avi_indexer_t *p_indexer = malloc( sizeof( *p_indexer ) );
+    if( unlikely( !p_indexer ) )
+        return VLC_ENOMEM;
+
+    p_indexer->p_idx = calloc( p_sys->i_track, sizeof( *p_indexer->p_idx ) );
+    p_indexer->s = stream_UrlNew( p_demux, p_demux->s->psz_url );
+    /* The offsets must match the ones of our stream */
+    if( !p_indexer->p_idx || !p_indexer->s ||
+        stream_Size( p_indexer->s ) != stream_Size( p_demux->s ) )
+        goto error;
+
+    vlc_mutex_init( &p_indexer->lock );
+    vlc_cond_init( &p_indexer->wait );
+    p_indexer->b_quit = false;
+    p_indexer->b_done = false;
+    p_indexer->b_complete = false;
+    p_indexer->i_last_pos = 0;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Init( &p_indexer->p_idx[i] );
+
+    AVI_IndexReset( p_demux );
+    p_sys->p_indexer = p_indexer;
+
+    if( vlc_clone( &p_indexer->thread, AVI_IndexerThread, p_demux,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        p_sys->p_indexer = NULL;
+        vlc_cond_destroy( &p_indexer->wait );
+        vlc_mutex_destroy( &p_indexer->lock );
+        goto error;
+    }
+
+    msg_Dbg( p_demux, "creating index from LIST-movi in the background" );
+    return VLC_SUCCESS;
+
+error:
+    if( p_indexer->s )
+        stream_Delete( p_indexer->s );
+    free( p_indexer->p_idx );
+    free( p_indexer );
+    return VLC_EGENERIC;
+}
+
+static void AVI_IndexerStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_indexer_t *p_indexer = p_sys->p_indexer;
+
+    if( !p_indexer )
+        return;
+
+    vlc_mutex_lock( &p_indexer->lock );
+    p_indexer->b_quit = true;
+    vlc_cond_signal( &p_indexer->wait );
+    vlc_mutex_unlock( &p_indexer->lock );
+    vlc_join( p_indexer->thread, NULL );
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Clean( &p_indexer->p_idx[i] );
+    free( p_indexer->p_idx );
+    stream_Delete( p_indexer->s );
+    vlc_cond_destroy( &p_indexer->wait );
+    vlc_mutex_destroy( &p_indexer->lock );
+    free( p_indexer );
+    p_sys->p_indexer = NULL;
+}
+
+/* Moves the chunks found by the indexer past the end of the track indexes,
+ * which may have grown meanwhile while demuxing without index. */
+static void AVI_IndexerMerge( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_indexer_t *p_indexer = p_sys->p_indexer;
+
+    vlc_mutex_lock( &p_indexer->lock );
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_t *p_index = &p_sys->track[i]->idx;
+        avi_index_t *p_found = &p_indexer->p_idx[i];
+
+        if( !p_found->p_entry )
+            continue;
+
+        /* first entry past the last indexed chunk */
+        unsigned i_first = 0;
+        if( p_index->i_size > 0 && p_index->p_entry )
+        {
+            const off_t i_last = p_index->p_entry[p_index->i_size - 1].i_pos;
+            unsigned i_end = p_found->i_size;
+            while( i_first < i_end )
+            {
+                unsigned i_mid = i_first + ( i_end - i_first ) / 2;
+                if( p_found->p_entry[i_mid].i_pos <= i_last )
+                    i_first = i_mid + 1;
+                else
+                    i_end = i_mid;
+            }
+        }
+
+        for( unsigned j = i_first; j < p_found->i_size; j++ )
+        {
+            avi_entry_t index = p_found->p_entry[j];
+            avi_index_Append( p_index, &p_sys->i_movi_lastchunk_pos, &index );
+        }
+
+        /* Only keep a buffer the size of one allocation step around */
+        if( p_found->i_max > AVI_INDEXER_PENDING_MAX )
+        {
+            avi_index_Clean( p_found );
+            avi_index_Init( p_found );
+        }
+        else
+            p_found->i_size = 0;
+    }
+    const bool b_done = p_indexer->b_done;
+    if( b_done )
+        p_sys->b_index_cache_save = p_indexer->b_complete &&
+                                    p_sys->psz_index_cache != NULL;
+    vlc_cond_signal( &p_indexer->wait );
+    vlc_mutex_unlock( &p_indexer->lock );
+
+    if( b_done )
+    {
+        AVI_IndexerStop( p_demux );
+        p_sys->i_length = AVI_MovieGetLength( p_demux );
+        for( unsigned i = 0; i < p_sys->i_track; i++ )
+            msg_Dbg( p_demux, "stream[%u] created %u index entries",
+                     i, p_sys->track[i]->idx.i_size );
+    }
+}
+
+/* Rebuilds the index of a fast seekable file: from the cache if possible,
+ * in the background if possible, or right now */
+static void AVI_IndexFix( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( AVI_IndexCacheLoad( p_demux ) == VLC_SUCCESS )
+        return;
+
+    if( AVI_IndexerStart( p_demux ) == VLC_SUCCESS )
+        return;
+
+    if( AVI_IndexCreate( p_demux ) && p_sys->psz_index_cache )
+        AVI_IndexCacheSave( p_demux );
 }
 
 /* */
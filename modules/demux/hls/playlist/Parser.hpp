@@ -29,6 +29,11 @@
 
 namespace adaptive
 {
+    namespace http
+    {
+        class HTTPConnectionManager;
+    }
+
     namespace playlist
     {
         class SegmentInformation;
@@ -56,7 +61,8 @@ namespace hls
                 virtual ~M3U8Parser    ();
 
                 M3U8 *             parse  (vlc_object_t *p_obj, stream_t *p_stream, const std::string &);
-                bool appendSegmentsFromPlaylistURI(vlc_object_t *, Representation *);
+                bool appendSegmentsFromPlaylistURI(vlc_object_t *, Representation *,
+                                                   adaptive::http::HTTPConnectionManager *);
 
             private:
                 Representation * createRepresentation(BaseAdaptationSet *, const AttributesTag *);
@@ -36,6 +36,7 @@
 
 using namespace hls;
 using namespace hls::playlist;
+using namespace adaptive::http;
 
 Representation::Representation  ( BaseAdaptationSet *set ) :
                 BaseRepresentation( set )
@@ -137,14 +138,15 @@ bool Representation::needsUpdate() const
     return !b_loaded || (isLive() && nextUpdateTime < time(NULL));
 }
 
-bool Representation::runLocalUpdates(mtime_t, uint64_t number, bool prune)
+bool Representation::runLocalUpdates(mtime_t, uint64_t number, bool prune,
+                                     HTTPConnectionManager *connManager)
 {
     const time_t now = time(NULL);
     const AbstractPlaylist *playlist = getPlaylist();
     if(!b_loaded || (isLive() && nextUpdateTime < now))
     {
         M3U8Parser parser;
-        parser.appendSegmentsFromPlaylistURI(playlist->getVLCObject(), this);
+        parser.appendSegmentsFromPlaylistURI(playlist->getVLCObject(), this, connManager);
         b_loaded = true;
 
         if(prune)
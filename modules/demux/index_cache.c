@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * index_cache.c: persistent demuxer index storage
+ *****************************************************************************
+ * Copyright © 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_url.h>
+#include <vlc_configuration.h>
+
+#include "index_cache.h"
+
+#define INDEX_CACHE_PROBE 4096
+
+int index_cache_GetKey( stream_t *s, uint8_t p_key[INDEX_CACHE_KEY_SIZE] )
+{
+    uint64_t i_size;
+    if( stream_GetSize( s, &i_size ) || i_size == 0 )
+        return VLC_EGENERIC;
+
+    int64_t i_mtime = 0;
+    char *psz_path = s->psz_url ? vlc_uri2path( s->psz_url ) : NULL;
+    if( psz_path )
+    {
+        struct stat st;
+        if( !vlc_stat( psz_path, &st ) )
+            i_mtime = st.st_mtime;
+        free( psz_path );
+    }
+
+    struct md5_s md5;
+    uint8_t p_probe[INDEX_CACHE_PROBE];
+
+    InitMD5( &md5 );
+    SetQWLE( &p_probe[0], i_size );
+    SetQWLE( &p_probe[8], i_mtime );
+    AddMD5( &md5, p_probe, 16 );
+
+    /* Tell apart files rewritten with the same size and time */
+    const uint64_t i_pos = stream_Tell( s );
+    const uint64_t pi_probe[2] = {
+        0, i_size > sizeof(p_probe) ? i_size - sizeof(p_probe) : 0 };
+    int i_ret = VLC_SUCCESS;
+    for( unsigned i = 0; i < 2 && i_ret == VLC_SUCCESS; i++ )
+    {
+        ssize_t i_read;
+        if( stream_Seek( s, pi_probe[i] ) ||
+            (i_read = stream_Read( s, p_probe, sizeof(p_probe) )) <= 0 )
+            i_ret = VLC_EGENERIC;
+        else
+            AddMD5( &md5, p_probe, i_read );
+    }
+    if( stream_Seek( s, i_pos ) )
+        i_ret = VLC_EGENERIC;
+    EndMD5( &md5 );
+
+    memcpy( p_key, md5.buf, INDEX_CACHE_KEY_SIZE );
+    return i_ret;
+}
+
+char *index_cache_GetPath( stream_t *s, const char *psz_name,
+                           const uint8_t p_key[INDEX_CACHE_KEY_SIZE] )
+{
+    if( !s->psz_url )
+        return NULL;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, s->psz_url, strlen( s->psz_url ) );
+    AddMD5( &md5, p_key, INDEX_CACHE_KEY_SIZE );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_path = NULL;
+    if( psz_hash && psz_dir &&
+        asprintf( &psz_path, "%s" DIR_SEP "%s" DIR_SEP "%s.idx",
+                  psz_dir, psz_name, psz_hash ) < 0 )
+        psz_path = NULL;
+    free( psz_dir );
+    free( psz_hash );
+    return psz_path;
+}
+
+FILE *index_cache_Open( vlc_object_t *p_obj, const char *psz_path,
+                        const char *psz_magic, uint32_t i_version,
+                        const uint8_t p_key[INDEX_CACHE_KEY_SIZE] )
+{
+    uint8_t header[INDEX_CACHE_HEADER_SIZE];
+
+    FILE *f = vlc_fopen( psz_path, "rb" );
+    if( !f )
+        return NULL;
+
+    if( fread( header, INDEX_CACHE_HEADER_SIZE, 1, f ) != 1 ||
+        memcmp( header, psz_magic, 8 ) ||
+        GetDWLE( &header[8] ) != i_version ||
+        memcmp( &header[12], p_key, INDEX_CACHE_KEY_SIZE ) )
+    {
+        msg_Dbg( p_obj, "ignoring outdated index %s", psz_path );
+        fclose( f );
+        return NULL;
+    }
+    return f;
+}
+
+/* Creates the missing parent directories of a path */
+static void MakeParentDirs( const char *psz_path )
+{
+    char *psz_dir = strdup( psz_path );
+    if( !psz_dir )
+        return;
+
+    for( char *p = strchr( psz_dir + 1, DIR_SEP_CHAR ); p != NULL;
+         p = strchr( p + 1, DIR_SEP_CHAR ) )
+    {
+        *p = '\0';
+        vlc_mkdir( psz_dir, 0700 );
+        *p = DIR_SEP_CHAR;
+    }
+    free( psz_dir );
+}
+
+FILE *index_cache_Create( vlc_object_t *p_obj, const char *psz_path,
+                          const char *psz_magic, uint32_t i_version,
+                          const uint8_t p_key[INDEX_CACHE_KEY_SIZE] )
+{
+    /* Write to a temporary file, so that readers never see a partial one */
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", psz_path ) < 0 )
+        return NULL;
+
+    FILE *f = vlc_fopen( psz_tmp, "wb" );
+    if( !f && errno == ENOENT )
+    {
+        MakeParentDirs( psz_tmp );
+        f = vlc_fopen( psz_tmp, "wb" );
+    }
+    if( !f )
+    {
+        msg_Warn( p_obj, "cannot create index %s: %s", psz_tmp,
+                  vlc_strerror_c( errno ) );
+        free( psz_tmp );
+        return NULL;
+    }
+    free( psz_tmp );
+
+    uint8_t header[INDEX_CACHE_HEADER_SIZE];
+    memcpy( header, psz_magic, 8 );
+    SetDWLE( &header[8], i_version );
+    memcpy( &header[12], p_key, INDEX_CACHE_KEY_SIZE );
+    if( fwrite( header, INDEX_CACHE_HEADER_SIZE, 1, f ) != 1 )
+    {
+        index_cache_Commit( p_obj, f, psz_path, true );
+        return NULL;
+    }
+    return f;
+}
+
+int index_cache_Commit( vlc_object_t *p_obj, FILE *f, const char *psz_path,
+                        bool b_error )
+{
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", psz_path ) < 0 )
+    {
+        fclose( f );
+        return VLC_ENOMEM;
+    }
+
+    b_error |= fclose( f ) != 0;
+    if( b_error || vlc_rename( psz_tmp, psz_path ) )
+    {
+        msg_Warn( p_obj, "cannot write index %s", psz_path );
+        vlc_unlink( psz_tmp );
+        free( psz_tmp );
+        return VLC_EGENERIC;
+    }
+    msg_Dbg( p_obj, "index saved to %s", psz_path );
+    free( psz_tmp );
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************
+ * index_cache.h: persistent demuxer index storage
+ *****************************************************************************
+ * Copyright © 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_DEMUX_INDEX_CACHE_H
+#define VLC_DEMUX_INDEX_CACHE_H
+
+/* Index files start with a common header: the 8 bytes magic of the format,
+ * its version (32 bits little endian) and the identity key of the indexed
+ * stream. The demuxer specific data follows. */
+#define INDEX_CACHE_KEY_SIZE    16
+#define INDEX_CACHE_HEADER_SIZE (8 + 4 + INDEX_CACHE_KEY_SIZE)
+
+/**
+ * Computes the identity key of a stream: a digest of its size, modification
+ * time (local files only), first and last bytes.
+ * The stream position is preserved.
+ */
+int index_cache_GetKey( stream_t *, uint8_t p_key[INDEX_CACHE_KEY_SIZE] );
+
+/**
+ * Gets the path of the index of a stream in the user cache directory:
+ * <cache>/<psz_name>/<digest of the URL and key>.idx
+ */
+char *index_cache_GetPath( stream_t *, const char *psz_name,
+                           const uint8_t p_key[INDEX_CACHE_KEY_SIZE] );
+
+/**
+ * Opens an index file for reading.
+ * @return the file positioned after the common header, or NULL if missing,
+ * of another format or version, or about another stream
+ */
+FILE *index_cache_Open( vlc_object_t *, const char *psz_path,
+                        const char *psz_magic, uint32_t i_version,
+                        const uint8_t p_key[INDEX_CACHE_KEY_SIZE] );
+
+/**
+ * Creates a temporary index file, and writes the common header.
+ * The index only replaces the existing file in index_cache_Commit().
+ */
+FILE *index_cache_Create( vlc_object_t *, const char *psz_path,
+                          const char *psz_magic, uint32_t i_version,
+                          const uint8_t p_key[INDEX_CACHE_KEY_SIZE] );
+
+/**
+ * Closes a file from index_cache_Create() and moves it in place, unless
+ * b_error is set or the file cannot be written.
+ */
+int index_cache_Commit( vlc_object_t *, FILE *, const char *psz_path,
+                        bool b_error );
+
+#endif
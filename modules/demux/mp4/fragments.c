@@ -55,6 +55,7 @@ void MP4_Fragments_Clean( mp4_fragments_t *p_frags )
         p_frags->moov.p_next = p_fragment;
     }
     MP4_Fragment_Clean( &p_frags->moov );
+    free( p_frags->index.p_entries );
 }
 
 void MP4_Fragments_Insert( mp4_fragments_t *p_frags, mp4_fragment_t *p_new )
@@ -94,9 +95,75 @@ void MP4_Fragments_Insert( mp4_fragments_t *p_frags, mp4_fragment_t *p_new )
 bool MP4_Fragments_Init( mp4_fragments_t *p_frags )
 {
     memset( &p_frags->moov, 0, sizeof(mp4_fragment_t) );
+    memset( &p_frags->index, 0, sizeof(mp4_fragments_index_t) );
     return true;
 }
 
+/* returns the index of the first entry at or past i_pos */
+static unsigned int IndexFindPos( const mp4_fragments_index_t *p_index, uint64_t i_pos )
+{
+    unsigned int i_low = 0, i_high = p_index->i_entries;
+    while( i_low < i_high )
+    {
+        unsigned int i_mid = (i_low + i_high) / 2;
+        if( p_index->p_entries[i_mid].i_pos < i_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+bool MP4_Fragments_Index_Add( mp4_fragments_index_t *p_index, uint64_t i_pos,
+                              uint64_t i_end_pos, stime_t i_time )
+{
+    unsigned int i = IndexFindPos( p_index, i_pos );
+    if( i < p_index->i_entries && p_index->p_entries[i].i_pos == i_pos )
+    {
+        if( i_end_pos )
+            p_index->p_entries[i].i_end_pos = i_end_pos;
+        return true;
+    }
+
+    if( p_index->i_entries == p_index->i_alloc )
+    {
+        unsigned int i_alloc = p_index->i_alloc ? p_index->i_alloc * 2 : 64;
+        mp4_fragment_index_entry_t *p_entries =
+                realloc( p_index->p_entries, i_alloc * sizeof(*p_entries) );
+        if( !p_entries )
+            return false;
+        p_index->p_entries = p_entries;
+        p_index->i_alloc = i_alloc;
+    }
+
+    memmove( &p_index->p_entries[i + 1], &p_index->p_entries[i],
+             (p_index->i_entries - i) * sizeof(*p_index->p_entries) );
+    p_index->p_entries[i].i_pos = i_pos;
+    p_index->p_entries[i].i_end_pos = i_end_pos;
+    p_index->p_entries[i].i_time = i_time;
+    p_index->i_entries++;
+    return true;
+}
+
+const mp4_fragment_index_entry_t *
+     MP4_Fragments_Index_Lookup( const mp4_fragments_index_t *p_index, stime_t i_time )
+{
+    if( !p_index->i_entries )
+        return NULL;
+
+    /* times grow with positions */
+    unsigned int i_low = 0, i_high = p_index->i_entries;
+    while( i_high - i_low > 1 )
+    {
+        unsigned int i_mid = (i_low + i_high) / 2;
+        if( p_index->p_entries[i_mid].i_time <= i_time )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
+    }
+    return &p_index->p_entries[i_low];
+}
+
 static stime_t GetTrackDurationInFragment( const mp4_fragment_t *p_fragment,
                                            unsigned int i_track_ID )
 {
@@ -42,10 +42,29 @@ struct mp4_fragment_t
     mp4_fragment_t *p_next;
 };
 
+typedef struct
+{
+    uint64_t i_pos;     /* moof, or segment from sidx, position */
+    uint64_t i_end_pos; /* end of the fragment mdat, 0 if unknown */
+    stime_t  i_time;    /* movie scaled, relative to the first fragment */
+} mp4_fragment_index_entry_t;
+
+/* Sparse time to position index of the fragments, sorted by position.
+ * It is either filled once from sidx, or with moofs as we meet them. */
+typedef struct
+{
+    mp4_fragment_index_entry_t *p_entries;
+    unsigned int i_entries;
+    unsigned int i_alloc;
+    stime_t  i_time_base; /* movie scaled time of the first fragment */
+    bool     b_sidx;      /* complete, built from sidx */
+} mp4_fragments_index_t;
+
 typedef struct
 {
     mp4_fragment_t moov; /* known fragments (moof following moov) */
     mp4_fragment_t *p_last;
+    mp4_fragments_index_t index;
 } mp4_fragments_t;
 
 static inline mp4_fragment_t * MP4_Fragment_Moov(mp4_fragments_t *p_fragments)
@@ -66,6 +85,11 @@ bool MP4_Fragments_Init(mp4_fragments_t *);
 void MP4_Fragments_Clean(mp4_fragments_t *);
 void MP4_Fragments_Insert(mp4_fragments_t *, mp4_fragment_t *);
 
+bool MP4_Fragments_Index_Add( mp4_fragments_index_t *, uint64_t i_pos,
+                              uint64_t i_end_pos, stime_t i_time );
+const mp4_fragment_index_entry_t *
+     MP4_Fragments_Index_Lookup( const mp4_fragments_index_t *, stime_t i_time );
+
 stime_t GetTrackTotalDuration( mp4_fragments_t *p_frags, unsigned int i_track_ID );
 mp4_fragment_t * GetFragmentByAtomPos( mp4_fragments_t *p_frags, uint64_t i_pos );
 mp4_fragment_t * GetFragmentByPos( mp4_fragments_t *p_frags, uint64_t i_pos, bool b_exact );
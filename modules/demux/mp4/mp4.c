@@ -43,6 +43,17 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define LAZY_TABLES_TEXT N_("Lazy sample tables")
+#define LAZY_TABLES_LONGTEXT N_( \
+    "Look the sample timestamps up in the sample tables when needed, " \
+    "instead of expanding the tables for every chunk at opening. This " \
+    "saves time and memory with long files." )
+
+#define FRAGMENTS_INDEX_TEXT N_("Fragments time index")
+#define FRAGMENTS_INDEX_LONGTEXT N_( \
+    "Seek in fragmented files using their sidx index, or moofs found as " \
+    "needed, instead of reading all the moofs at opening." )
+
 vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
@@ -50,6 +61,11 @@ vlc_module_begin ()
     set_shortname( N_("MP4") )
     set_capability( "demux", 240 )
     set_callbacks( Open, Close )
+
+    add_bool( "mp4-lazy-tables", true, LAZY_TABLES_TEXT,
+              LAZY_TABLES_LONGTEXT, true )
+    add_bool( "mp4-fragments-index", true, FRAGMENTS_INDEX_TEXT,
+              FRAGMENTS_INDEX_LONGTEXT, true )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -62,6 +78,10 @@ static int   DemuxAsLeaf( demux_t * );
 static int   Seek    ( demux_t *, mtime_t );
 static int   Control ( demux_t *, int, va_list );
 
+#define MP4_RESYNC_SIZE      (1 << 16) /* moof header scan step */
+#define MP4_INDEX_MAX_PROBES 32        /* moofs read for a single seek */
+#define MP4_TAIL_PROBE_MAX   (1 << 26) /* tail size searched for the last moof */
+
 struct demux_sys_t
 {
     MP4_Box_t    *p_root;      /* container for the whole file */
@@ -140,6 +160,8 @@ static int  ProbeIndex( demux_t *p_demux );
 
 static int LeafIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
                                       uint64_t *pi_pos, mtime_t *pi_mooftime );
+static int LeafIndexFindMoof( demux_t *p_demux, const mtime_t i_target_time,
+                              uint64_t *pi_pos, mtime_t *pi_mooftime );
 static int LeafGetTrackAndChunkByMOOVPos( demux_t *p_demux, uint64_t *pi_pos,
                                       mp4_track_t **pp_tk, unsigned int *pi_chunk );
 static int LeafMapTrafTrunContextes( demux_t *p_demux, MP4_Box_t *p_moof );
@@ -198,40 +220,217 @@ static MP4_Box_t * MP4_GetTrakByTrackID( MP4_Box_t *p_moov, const uint32_t i_id
     return p_trak;
 }
 
+/* Return the dts of a sample of a track with lazy sample tables,
+ * in the track time scale */
+static int64_t TrackLazyGetDTS( const MP4_Box_data_stts_t *stts,
+                                mp4_tts_cursor_t *p_cur, uint32_t i_sample )
+{
+    /* The cursor only moves forward */
+    if( i_sample < p_cur->i_first_sample )
+        memset( p_cur, 0, sizeof( *p_cur ) );
+
+    while( p_cur->i_index < stts->i_entry_count &&
+           i_sample - p_cur->i_first_sample >=
+               stts->pi_sample_count[p_cur->i_index] )
+    {
+        p_cur->i_first_dts += (uint64_t) stts->pi_sample_count[p_cur->i_index] *
+                              (uint32_t) stts->pi_sample_delta[p_cur->i_index];
+        p_cur->i_first_sample += stts->pi_sample_count[p_cur->i_index];
+        p_cur->i_index++;
+    }
+
+    if( p_cur->i_index >= stts->i_entry_count )
+        return p_cur->i_first_dts;
+
+    return p_cur->i_first_dts + (uint64_t)( i_sample - p_cur->i_first_sample ) *
+                                (uint32_t) stts->pi_sample_delta[p_cur->i_index];
+}
+
+/* Same for the pts - dts offset, in the track time scale */
+static bool TrackLazyGetPTSDelta( mp4_track_t *p_track, uint32_t i_sample,
+                                  int64_t *pi_delta )
+{
+    const MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
+    mp4_tts_cursor_t *p_cur = &p_track->pts_cursor;
+
+    if( ctts == NULL )
+        return false;
+
+    if( i_sample < p_cur->i_first_sample )
+        memset( p_cur, 0, sizeof( *p_cur ) );
+
+    while( p_cur->i_index < ctts->i_entry_count &&
+           i_sample - p_cur->i_first_sample >=
+               ctts->pi_sample_count[p_cur->i_index] )
+    {
+        p_cur->i_first_sample += ctts->pi_sample_count[p_cur->i_index];
+        p_cur->i_index++;
+    }
+
+    if( p_cur->i_index >= ctts->i_entry_count )
+        return false;
+
+    *pi_delta = ctts->pi_sample_offset[p_cur->i_index];
+    return true;
+}
+
+/* Return the sample being decoded at i_dts (track time scale),
+ * or the last one if the track is over by then */
+static uint32_t TrackLazyGetSample( mp4_track_t *p_track, int64_t i_dts )
+{
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
+    mp4_tts_cursor_t *p_cur = &p_track->dts_cursor;
+
+    if( i_dts < p_cur->i_first_dts )
+        memset( p_cur, 0, sizeof( *p_cur ) );
+
+    while( p_cur->i_index < stts->i_entry_count )
+    {
+        const uint64_t i_length = (uint64_t) stts->pi_sample_count[p_cur->i_index] *
+                                  (uint32_t) stts->pi_sample_delta[p_cur->i_index];
+        if( i_dts < p_cur->i_first_dts + (int64_t) i_length )
+            break;
+        p_cur->i_first_dts += i_length;
+        p_cur->i_first_sample += stts->pi_sample_count[p_cur->i_index];
+        p_cur->i_index++;
+    }
+
+    if( p_cur->i_index >= stts->i_entry_count )
+        return p_cur->i_first_sample;
+
+    const uint32_t i_delta = stts->pi_sample_delta[p_cur->i_index];
+    if( i_delta == 0 || i_dts <= p_cur->i_first_dts )
+        return p_cur->i_first_sample;
+    return p_cur->i_first_sample + ( i_dts - p_cur->i_first_dts ) / i_delta;
+}
+
+/* Move a stsc cursor to the next table entry */
+static void TrackLazyNextChunkEntry( const MP4_Box_data_stsc_t *stsc,
+                                     mp4_stsc_cursor_t *p_cur )
+{
+    const uint32_t i_next_chunk = stsc->i_first_chunk[p_cur->i_index + 1] - 1;
+
+    p_cur->i_first_sample += ( i_next_chunk - p_cur->i_first_chunk ) *
+                             stsc->i_samples_per_chunk[p_cur->i_index];
+    p_cur->i_first_chunk = i_next_chunk;
+    p_cur->i_index++;
+}
+
+/* Return the chunk holding a sample of a track with lazy sample tables */
+static uint32_t TrackLazyGetChunk( mp4_track_t *p_track, uint32_t i_sample )
+{
+    const MP4_Box_data_stsc_t *stsc = p_track->p_stsc;
+    mp4_stsc_cursor_t *p_cur = &p_track->stsc_cursor;
+
+    if( i_sample < p_cur->i_first_sample )
+        memset( p_cur, 0, sizeof( *p_cur ) );
+
+    while( p_cur->i_index + 1 < stsc->i_entry_count )
+    {
+        mp4_stsc_cursor_t next = *p_cur;
+        TrackLazyNextChunkEntry( stsc, &next );
+        if( i_sample < next.i_first_sample )
+            break;
+        *p_cur = next;
+    }
+
+    uint32_t i_chunk = p_cur->i_first_chunk;
+    if( stsc->i_samples_per_chunk[p_cur->i_index] > 0 )
+        i_chunk += ( i_sample - p_cur->i_first_sample ) /
+                   stsc->i_samples_per_chunk[p_cur->i_index];
+    return __MIN( i_chunk, p_track->i_chunk_count - 1 );
+}
+
+/* Decode a chunk of a track with lazy sample tables from stco/co64 and stsc */
+static void TrackLazyFillChunk( mp4_track_t *p_track, uint32_t i_chunk,
+                                mp4_chunk_t *ck )
+{
+    const MP4_Box_data_stsc_t *stsc = p_track->p_stsc;
+    mp4_stsc_cursor_t *p_cur = &p_track->stsc_cursor;
+
+    if( i_chunk < p_cur->i_first_chunk )
+        memset( p_cur, 0, sizeof( *p_cur ) );
+
+    while( p_cur->i_index + 1 < stsc->i_entry_count &&
+           i_chunk >= stsc->i_first_chunk[p_cur->i_index + 1] - 1 )
+        TrackLazyNextChunkEntry( stsc, p_cur );
+
+    ck->i_offset = p_track->p_co64->i_chunk_offset[i_chunk];
+    ck->i_sample_description_index =
+            stsc->i_sample_description_index[p_cur->i_index];
+    ck->i_sample_count = stsc->i_samples_per_chunk[p_cur->i_index];
+    ck->i_sample_first = p_cur->i_first_sample +
+                         ( i_chunk - p_cur->i_first_chunk ) * ck->i_sample_count;
+}
+
+#define MP4_CHUNK_PAGE 1024
+
+/* Return a chunk of a track. With lazy sample tables, its page of the
+ * chunk table is decoded when first needed, and NULL is returned if that
+ * fails. Pages are kept until the track is destroyed, and the current
+ * chunk is loaded when entered, so getting it never fails. */
+static mp4_chunk_t * MP4_TrackGetChunk( mp4_track_t *p_track, uint32_t i_chunk )
+{
+    if( !p_track->b_lazy_tables )
+        return &p_track->chunk[i_chunk];
+
+    mp4_chunk_t **pp_page = &p_track->pp_chunk_pages[i_chunk / MP4_CHUNK_PAGE];
+    if( *pp_page == NULL )
+    {
+        const uint32_t i_first = i_chunk - i_chunk % MP4_CHUNK_PAGE;
+        const uint32_t i_count = __MIN( MP4_CHUNK_PAGE,
+                                        p_track->i_chunk_count - i_first );
+        mp4_chunk_t *p_page = calloc( i_count, sizeof( *p_page ) );
+        if( p_page == NULL )
+            return NULL;
+        for( uint32_t i = 0; i < i_count; i++ )
+            TrackLazyFillChunk( p_track, i_first + i, &p_page[i] );
+        *pp_page = p_page;
+    }
+    return &(*pp_page)[i_chunk % MP4_CHUNK_PAGE];
+}
+
 /* Return time in microsecond of a track */
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const mp4_chunk_t *p_chunk;
-    if( p_sys->b_fragmented )
-        p_chunk = p_track->cchunk;
-    else
-        p_chunk = &p_track->chunk[p_track->i_chunk];
-
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
-    int64_t i_dts = p_chunk->i_first_dts;
+    int64_t i_dts;
 
-    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
+    if( p_track->b_lazy_tables )
+        i_dts = TrackLazyGetDTS( p_track->p_stts, &p_track->dts_cursor,
+                                 p_track->i_sample );
+    else
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
-        {
-            i_dts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
+        const mp4_chunk_t *p_chunk;
+        if( p_sys->b_fragmented )
+            p_chunk = p_track->cchunk;
         else
+            p_chunk = &p_track->chunk[p_track->i_chunk];
+
+        unsigned int i_index = 0;
+        unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
+        i_dts = p_chunk->i_first_dts;
+
+        while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
         {
-            i_dts += i_sample * p_chunk->p_sample_delta_dts[i_index];
-            break;
+            if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+            {
+                i_dts += p_chunk->p_sample_count_dts[i_index] *
+                    p_chunk->p_sample_delta_dts[i_index];
+                i_sample -= p_chunk->p_sample_count_dts[i_index];
+                i_index++;
+            }
+            else
+            {
+                i_dts += i_sample * p_chunk->p_sample_delta_dts[i_index];
+                break;
+            }
         }
     }
 
     /* now handle elst */
     if( p_track->p_elst )
     {
-        demux_sys_t         *p_sys = p_demux->p_sys;
         MP4_Box_data_elst_t *elst = p_track->BOXDATA(p_elst);
 
         /* convert to offset */
@@ -256,6 +455,16 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
                                          int64_t *pi_delta )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_track->b_lazy_tables )
+    {
+        int64_t i_delta;
+        if( !TrackLazyGetPTSDelta( p_track, p_track->i_sample, &i_delta ) )
+            return false;
+        *pi_delta = i_delta * CLOCK_FREQ / (int64_t)p_track->i_timescale;
+        return true;
+    }
+
     mp4_chunk_t *ck;
     if( p_sys->b_fragmented )
         ck = p_track->cchunk;
@@ -1187,8 +1396,11 @@ static int LeafSeekToTime( demux_t *p_demux, mtime_t i_nztime )
     if ( !p_fragment )
     {
         mtime_t i_mooftime;
+        const bool b_sidx = p_sys->fragments.index.b_sidx;
         msg_Dbg( p_demux, "seek can't find matching fragment for %"PRId64", trying index", i_nztime );
-        if ( LeafIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS )
+        if ( ( b_sidx && LeafIndexFindMoof( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS ) ||
+             LeafIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS ||
+             ( !b_sidx && LeafIndexFindMoof( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS ) )
         {
             msg_Dbg( p_demux, "seek trying to go to unknown but indexed fragment at %"PRId64, i64 );
             if( stream_Seek( p_demux->s, i64 ) )
@@ -1201,9 +1413,9 @@ static int LeafSeekToTime( demux_t *p_demux, mtime_t i_nztime )
             p_sys->context.p_fragment = NULL;
             for( unsigned int i_track = 0; i_track < p_sys->i_tracks; i_track++ )
             {
-                p_sys->track[i_track].i_time = i_mooftime / CLOCK_FREQ * p_sys->track[i_track].i_timescale;
+                p_sys->track[i_track].i_time = i_mooftime * p_sys->track[i_track].i_timescale / CLOCK_FREQ;
             }
-            p_sys->i_time = i_mooftime / CLOCK_FREQ * p_sys->i_timescale;
+            p_sys->i_time = i_mooftime * p_sys->i_timescale / CLOCK_FREQ;
             p_sys->i_pcr  = VLC_TS_INVALID;
         }
         else
@@ -1670,6 +1882,10 @@ static void LoadChapterApple( demux_t  *p_demux, mp4_track_t *tk )
 
     for( tk->i_sample = 0; tk->i_sample < tk->i_sample_count; tk->i_sample++ )
     {
+        const mp4_chunk_t *p_chunk = MP4_TrackGetChunk( tk, tk->i_chunk );
+        if( p_chunk == NULL )
+            break;
+
         const int64_t i_dts = MP4_TrackGetDTS( p_demux, tk );
         int64_t i_pts_delta;
         if ( !MP4_TrackGetPTSDelta( p_demux, tk, &i_pts_delta ) )
@@ -1698,8 +1914,7 @@ static void LoadChapterApple( demux_t  *p_demux, mp4_track_t *tk )
                 TAB_APPEND( p_sys->p_title->i_seekpoint, p_sys->p_title->seekpoint, s );
             }
         }
-        if( tk->i_sample+1 >= tk->chunk[tk->i_chunk].i_sample_first +
-                              tk->chunk[tk->i_chunk].i_sample_count )
+        if( tk->i_sample+1 >= p_chunk->i_sample_first + p_chunk->i_sample_count )
             tk->i_chunk++;
     }
 }
@@ -1760,6 +1975,29 @@ static bool MP4_TrackIsInterleaved( const mp4_track_t *p_track )
 }
 
 /* now create basic chunk data, the rest will be filled by MP4_CreateSamplesIndex */
+/* Return whether the chunks can be decoded from the sample to chunk table
+ * on demand, which needs runs starting at the first chunk, in order */
+static bool TrackLazyCanIndexChunks( const MP4_Box_data_stsc_t *stsc,
+                                     uint32_t i_chunk_count )
+{
+    uint64_t i_samples = 0;
+
+    if( i_chunk_count == 0 || stsc->i_entry_count == 0 ||
+        stsc->i_first_chunk[0] != 1 )
+        return false;
+
+    for( uint32_t i = 0; i < stsc->i_entry_count; i++ )
+    {
+        const uint32_t i_last = i + 1 < stsc->i_entry_count ?
+                                stsc->i_first_chunk[i + 1] - 1 : i_chunk_count;
+        if( i_last < stsc->i_first_chunk[i] || i_last > i_chunk_count )
+            return false;
+        i_samples += (uint64_t)( i_last - stsc->i_first_chunk[i] + 1 ) *
+                     stsc->i_samples_per_chunk[i];
+    }
+    return i_samples <= UINT32_MAX;
+}
+
 static int TrackCreateChunksIndex( demux_t *p_demux,
                                    mp4_track_t *p_demux_track )
 {
@@ -1783,6 +2021,35 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     {
         msg_Warn( p_demux, "no chunk defined" );
     }
+
+    /* The moov of fragmented files is handled with the fragments */
+    p_demux_track->b_lazy_tables = !p_sys->b_fragmented &&
+                                   var_InheritBool( p_demux, "mp4-lazy-tables" ) &&
+                                   TrackLazyCanIndexChunks( BOXDATA(p_stsc),
+                                                p_demux_track->i_chunk_count );
+    if( p_demux_track->b_lazy_tables )
+    {
+        p_demux_track->p_co64 = BOXDATA(p_co64);
+        p_demux_track->p_stsc = BOXDATA(p_stsc);
+        p_demux_track->pp_chunk_pages =
+            calloc( ( p_demux_track->i_chunk_count + MP4_CHUNK_PAGE - 1 ) /
+                    MP4_CHUNK_PAGE, sizeof( *p_demux_track->pp_chunk_pages ) );
+        /* the current chunk is always decoded */
+        if( p_demux_track->pp_chunk_pages == NULL ||
+            MP4_TrackGetChunk( p_demux_track, 0 ) == NULL )
+            return VLC_ENOMEM;
+
+        msg_Dbg( p_demux, "track[Id 0x%x] %d chunk decoded on demand",
+                 p_demux_track->i_track_ID, p_demux_track->i_chunk_count );
+
+        mp4_fragment_t *p_moovfragment = MP4_Fragment_Moov( &p_sys->fragments );
+        if ( p_moovfragment->i_chunk_range_min_offset == 0 ||
+             p_moovfragment->i_chunk_range_min_offset > BOXDATA(p_co64)->i_chunk_offset[0] )
+            p_moovfragment->i_chunk_range_min_offset = BOXDATA(p_co64)->i_chunk_offset[0];
+
+        return VLC_SUCCESS;
+    }
+
     p_demux_track->chunk = calloc( p_demux_track->i_chunk_count,
                                    sizeof( mp4_chunk_t ) );
     if( p_demux_track->chunk == NULL )
@@ -1903,6 +2170,26 @@ static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
     return VLC_SUCCESS;
 }
 
+/* The timestamps of the samples are looked up in the tables when needed */
+static int TrackCreateLazySamplesIndex( demux_t *p_demux,
+                                        mp4_track_t *p_demux_track,
+                                        const MP4_Box_data_stts_t *stts )
+{
+    const MP4_Box_t *p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
+
+    p_demux_track->p_stts = stts;
+    p_demux_track->p_ctts = p_box ? p_box->data.p_ctts : NULL;
+
+    msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
+             p_demux_track->i_track_ID, p_demux_track->i_sample_count,
+             TrackLazyGetDTS( stts, &p_demux_track->dts_cursor,
+                              p_demux_track->i_sample_count ) /
+             p_demux_track->i_timescale );
+
+    memset( &p_demux_track->dts_cursor, 0, sizeof( p_demux_track->dts_cursor ) );
+    return VLC_SUCCESS;
+}
+
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -1933,6 +2220,12 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         p_demux_track->i_sample_size = stsz->i_sample_size;
         p_demux_track->p_sample_size = NULL;
     }
+    else if( p_demux_track->b_lazy_tables )
+    {
+        /* 2: each sample can have a different size, use the box table */
+        p_demux_track->i_sample_size = 0;
+        p_demux_track->p_sample_size = stsz->i_entry_size;
+    }
     else
     {
         /* 2: each sample can have a different size */
@@ -1951,7 +2244,10 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     if ( p_demux_track->i_chunk_count )
     {
-        mp4_chunk_t *lastchunk = &p_demux_track->chunk[p_demux_track->i_chunk_count - 1];
+        const mp4_chunk_t *lastchunk =
+            MP4_TrackGetChunk( p_demux_track, p_demux_track->i_chunk_count - 1 );
+        if( lastchunk == NULL )
+            return VLC_ENOMEM;
         uint64_t i_total_size = lastchunk->i_offset;
 
         if ( p_demux_track->i_sample_size != 0 ) /* all samples have same size */
@@ -2002,6 +2298,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
+        if( p_demux_track->b_lazy_tables )
+            return TrackCreateLazySamplesIndex( p_demux, p_demux_track, stts );
+
         /* Create sample -> dts table per chunk */
         uint32_t i_index = 0;
         uint32_t i_current_index_samples_left = 0;
@@ -2225,25 +2524,67 @@ static void TrackGetESSampleRate( demux_t *p_demux,
     if( p_track->i_chunk_count == 0 )
         return;
 
-    /* */
-    const mp4_chunk_t *p_chunk = &p_track->chunk[i_chunk];
-    while( p_chunk > &p_track->chunk[0] &&
-           p_chunk[-1].i_sample_description_index == i_sd_index )
-    {
-        p_chunk--;
-    }
-
     uint64_t i_sample = 0;
-    uint64_t i_first_dts = p_chunk->i_first_dts;
+    uint64_t i_first_dts;
     uint64_t i_last_dts;
-    do
+
+    if( p_track->b_lazy_tables )
+    {
+        /* Same over the runs of the sample to chunk table */
+        const MP4_Box_data_stsc_t *stsc = p_track->p_stsc;
+        uint64_t i_first = 0;
+        bool b_run = false;
+
+        for( uint32_t i = 0; i < stsc->i_entry_count; i++ )
+        {
+            const uint32_t i_first_chunk = stsc->i_first_chunk[i] - 1;
+            const uint32_t i_next_chunk = i + 1 < stsc->i_entry_count ?
+                stsc->i_first_chunk[i + 1] - 1 : p_track->i_chunk_count;
+
+            if( stsc->i_sample_description_index[i] != i_sd_index )
+            {
+                if( i_first_chunk > i_chunk )
+                    break;
+                b_run = false;
+            }
+            else if( !b_run )
+            {
+                b_run = true;
+                i_first = i_sample;
+            }
+            i_sample += (uint64_t)( i_next_chunk - i_first_chunk ) *
+                        stsc->i_samples_per_chunk[i];
+        }
+        if( !b_run )
+            return;
+        i_sample -= i_first;
+
+        mp4_tts_cursor_t cursor = { 0 };
+        i_first_dts = TrackLazyGetDTS( p_track->p_stts, &cursor, i_first );
+        i_last_dts = i_first_dts;
+        if( i_sample > 0 )
+            i_last_dts = TrackLazyGetDTS( p_track->p_stts, &cursor,
+                                          i_first + i_sample - 1 );
+    }
+    else
     {
-        i_sample += p_chunk->i_sample_count;
-        i_last_dts = p_chunk->i_last_dts;
-        p_chunk++;
+        const mp4_chunk_t *p_chunk = &p_track->chunk[i_chunk];
+        while( p_chunk > &p_track->chunk[0] &&
+               p_chunk[-1].i_sample_description_index == i_sd_index )
+        {
+            p_chunk--;
+        }
+
+        i_first_dts = p_chunk->i_first_dts;
+        do
+        {
+            i_sample += p_chunk->i_sample_count;
+            i_last_dts = p_chunk->i_last_dts;
+            p_chunk++;
+        }
+        while( p_chunk < &p_track->chunk[p_track->i_chunk_count] &&
+               p_chunk->i_sample_description_index == i_sd_index );
     }
-    while( p_chunk < &p_track->chunk[p_track->i_chunk_count] &&
-           p_chunk->i_sample_description_index == i_sd_index );
 
     if( i_sample > 1 && i_first_dts < i_last_dts )
         vlc_ureduce( pi_num, pi_den,
@@ -2265,8 +2606,12 @@ static int TrackCreateES( demux_t *p_demux, mp4_track_t *p_track,
     if( p_sys->b_fragmented || p_track->i_chunk_count == 0 )
         i_sample_description_index = 1; /* XXX */
     else
-        i_sample_description_index =
-                p_track->chunk[i_chunk].i_sample_description_index;
+    {
+        const mp4_chunk_t *p_chunk = MP4_TrackGetChunk( p_track, i_chunk );
+        if( p_chunk == NULL )
+            return VLC_EGENERIC;
+        i_sample_description_index = p_chunk->i_sample_description_index;
+    }
 
     if( pp_es )
         *pp_es = NULL;
@@ -2469,50 +2814,58 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / CLOCK_FREQ;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    if( p_track->b_lazy_tables )
+    {
+        i_sample = TrackLazyGetSample( p_track, i_start );
+        i_chunk = TrackLazyGetChunk( p_track, i_sample );
+    }
+    else
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
+        /* we start from sample 0/chunk 0, hope it won't take too much time */
+        /* *** find good chunk *** */
+        for( i_chunk = 0; ; i_chunk++ )
         {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
+            if( i_chunk + 1 >= p_track->i_chunk_count )
+            {
+                /* at the end and can't check if i_start in this chunk,
+                   it will be check while searching i_sample */
+                i_chunk = p_track->i_chunk_count - 1;
+                break;
+            }
 
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
+            if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
+                (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
+            {
+                break;
+            }
         }
-    }
 
-    /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
-    {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
+        /* *** find sample in the chunk *** */
+        i_sample = p_track->chunk[i_chunk].i_sample_first;
+        i_dts    = p_track->chunk[i_chunk].i_first_dts;
+        for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
         {
-            i_dts    +=
+            if( i_dts +
                 p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+                p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
+            {
+                i_dts    +=
+                    p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
+                    p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
-        {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
+                i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
+                i_index++;
+            }
+            else
             {
+                if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
+                {
+                    break;
+                }
+                i_sample += ( i_start - i_dts ) /
+                    p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
                 break;
             }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-            break;
         }
     }
 
@@ -2531,7 +2884,9 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         TrackGetNearestSeekPoint( p_demux, p_track, i_sample, &i_sync_sample ) )
     {
         /* Go to chunk */
-        if( i_sync_sample <= i_sample )
+        if( p_track->b_lazy_tables )
+            i_chunk = TrackLazyGetChunk( p_track, i_sync_sample );
+        else if( i_sync_sample <= i_sample )
         {
             while( i_chunk > 0 &&
                    i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
@@ -2558,10 +2913,14 @@ static int TrackGotoChunkSample( demux_t *p_demux, mp4_track_t *p_track,
 {
     bool b_reselect = false;
 
+    mp4_chunk_t *p_chunk = MP4_TrackGetChunk( p_track, i_chunk );
+    if( p_chunk == NULL )
+        return VLC_EGENERIC;
+
     /* now see if actual es is ok */
     if( p_track->i_chunk >= p_track->i_chunk_count ||
-        p_track->chunk[p_track->i_chunk].i_sample_description_index !=
-            p_track->chunk[i_chunk].i_sample_description_index )
+        MP4_TrackGetChunk( p_track, p_track->i_chunk )->i_sample_description_index !=
+            p_chunk->i_sample_description_index )
     {
         msg_Warn( p_demux, "recreate ES for track[Id 0x%x]",
                   p_track->i_track_ID );
@@ -2591,7 +2950,7 @@ static int TrackGotoChunkSample( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     p_track->i_chunk    = i_chunk;
-    p_track->chunk[i_chunk].i_sample = i_sample - p_track->chunk[i_chunk].i_sample_first;
+    p_chunk->i_sample = i_sample - p_chunk->i_sample_first;
     p_track->i_sample   = i_sample;
 
     return p_track->b_selected ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2940,6 +3299,13 @@ static void MP4_TrackDestroy( demux_t *p_demux, mp4_track_t *p_track )
     }
     free( p_track->chunk );
 
+    if( p_track->pp_chunk_pages )
+    {
+        for( uint32_t i = 0; i * MP4_CHUNK_PAGE < p_track->i_chunk_count; i++ )
+            free( p_track->pp_chunk_pages[i] );
+    }
+    free( p_track->pp_chunk_pages );
+
     if( p_track->cchunk )
     {
         assert( p_demux->p_sys->b_fragmented );
@@ -2947,7 +3313,7 @@ static void MP4_TrackDestroy( demux_t *p_demux, mp4_track_t *p_track )
         free( p_track->cchunk );
     }
 
-    if( !p_track->i_sample_size )
+    if( !p_track->i_sample_size && !p_track->b_lazy_tables )
         free( p_track->p_sample_size );
 
     if ( p_track->asfinfo.p_frame )
@@ -3079,7 +3445,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
     else
     {
         const MP4_Box_data_sample_soun_t *p_soun = p_track->p_sample->data.p_sample_soun;
-        const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+        const mp4_chunk_t *p_chunk = MP4_TrackGetChunk( p_track, p_track->i_chunk );
         uint32_t i_max_samples = p_chunk->i_sample_count - p_chunk->i_sample;
 
         /* Group audio packets so we don't call demux for single sample unit */
@@ -3203,10 +3569,11 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
 
 static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
 {
+    const mp4_chunk_t *p_chunk = MP4_TrackGetChunk( p_track, p_track->i_chunk );
     unsigned int i_sample;
     uint64_t i_pos;
 
-    i_pos = p_track->chunk[p_track->i_chunk].i_offset;
+    i_pos = p_chunk->i_offset;
 
     if( p_track->i_sample_size )
     {
@@ -3220,8 +3587,7 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
             switch( p_track->fmt.i_codec )
             {
             case VLC_CODEC_GSM: /* # Samples > data size */
-                i_pos += ( p_track->i_sample -
-                           p_track->chunk[p_track->i_chunk].i_sample_first ) / 160 * 33;
+                i_pos += ( p_track->i_sample - p_chunk->i_sample_first ) / 160 * 33;
                 return i_pos;
             default:
                 break;
@@ -3232,20 +3598,19 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
             p_track->fmt.audio.i_blockalign <= 1 ||
             p_soun->i_sample_per_packet * p_soun->i_bytes_per_frame == 0 )
         {
-            i_pos += ( p_track->i_sample -
-                       p_track->chunk[p_track->i_chunk].i_sample_first ) *
+            i_pos += ( p_track->i_sample - p_chunk->i_sample_first ) *
                      MP4_GetFixedSampleSize( p_track, p_soun );
         }
         else
         {
             /* we read chunk by chunk unless a blockalign is requested */
-            i_pos += ( p_track->i_sample - p_track->chunk[p_track->i_chunk].i_sample_first ) /
+            i_pos += ( p_track->i_sample - p_chunk->i_sample_first ) /
                         p_soun->i_sample_per_packet * p_soun->i_bytes_per_frame;
         }
     }
     else
     {
-        for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
+        for( i_sample = p_chunk->i_sample_first;
              i_sample < p_track->i_sample; i_sample++ )
         {
             i_pos += p_track->p_sample_size[i_sample];
@@ -3269,9 +3634,8 @@ static int MP4_TrackNextSample( demux_t *p_demux, mp4_track_t *p_track, uint32_t
         return VLC_EGENERIC;
 
     /* Have we changed chunk ? */
-    if( p_track->i_sample >=
-            p_track->chunk[p_track->i_chunk].i_sample_first +
-            p_track->chunk[p_track->i_chunk].i_sample_count )
+    const mp4_chunk_t *p_chunk = MP4_TrackGetChunk( p_track, p_track->i_chunk );
+    if( p_track->i_sample >= p_chunk->i_sample_first + p_chunk->i_sample_count )
     {
         if( TrackGotoChunkSample( p_demux, p_track, p_track->i_chunk + 1,
                                   p_track->i_sample ) )
@@ -4077,6 +4441,408 @@ static bool AddFragment( demux_t *p_demux, MP4_Box_t *p_moox )
     return true;
 }
 
+/* Gets the decoding time range covered by a moof, using its tfdt boxes,
+ * as movie scaled absolute times. Only audio and video tracks count. */
+static bool LeafGetMoofTimes( demux_t *p_demux, const MP4_Box_t *p_moof,
+                              stime_t *pi_start, stime_t *pi_end )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    MP4_Box_t *p_moov = MP4_Fragment_Moov( &p_sys->fragments )->p_moox;
+    bool b_found = false;
+
+    for( const MP4_Box_t *p_traf = MP4_BoxGet( p_moof, "traf" );
+         p_traf; p_traf = p_traf->p_next )
+    {
+        if( p_traf->i_type != ATOM_traf )
+            continue;
+
+        const MP4_Box_t *p_tfhd = MP4_BoxGet( p_traf, "tfhd" );
+        const MP4_Box_t *p_tfdt = MP4_BoxGet( p_traf, "tfdt" );
+        if( !p_tfhd || !BOXDATA(p_tfhd) || !p_tfdt || !BOXDATA(p_tfdt) )
+            continue;
+
+        const MP4_Box_t *p_trak = MP4_GetTrakByTrackID( p_moov, BOXDATA(p_tfhd)->i_track_ID );
+        const MP4_Box_t *p_mdhd = MP4_BoxGet( p_trak, "mdia/mdhd" );
+        const MP4_Box_t *p_hdlr = MP4_BoxGet( p_trak, "mdia/hdlr" );
+        if( !p_mdhd || !BOXDATA(p_mdhd) || !BOXDATA(p_mdhd)->i_timescale ||
+            !p_hdlr || !BOXDATA(p_hdlr) ||
+            ( BOXDATA(p_hdlr)->i_handler_type != ATOM_vide &&
+              BOXDATA(p_hdlr)->i_handler_type != ATOM_soun ) )
+            continue;
+        const uint32_t i_track_timescale = BOXDATA(p_mdhd)->i_timescale;
+
+        uint32_t i_default_size = 0, i_default_duration = 0;
+        MP4_GetDefaultSizeAndDuration( p_demux, BOXDATA(p_tfhd),
+                                       &i_default_size, &i_default_duration );
+
+        stime_t i_duration = 0;
+        for( const MP4_Box_t *p_trun = MP4_BoxGet( p_traf, "trun" );
+             p_trun; p_trun = p_trun->p_next )
+        {
+            if( p_trun->i_type != ATOM_trun || !BOXDATA(p_trun) )
+                continue;
+            const MP4_Box_data_trun_t *p_trundata = BOXDATA(p_trun);
+            if ( p_trundata->i_flags & MP4_TRUN_SAMPLE_DURATION )
+            {
+                for( uint32_t i=0; i< p_trundata->i_sample_count; i++ )
+                    i_duration += p_trundata->p_samples[i].i_duration;
+            }
+            else
+                i_duration += (stime_t) p_trundata->i_sample_count * i_default_duration;
+        }
+
+        stime_t i_start = BOXDATA(p_tfdt)->i_base_media_decode_time *
+                          p_sys->i_timescale / i_track_timescale;
+        stime_t i_end = i_start + i_duration * p_sys->i_timescale / i_track_timescale;
+        if( !b_found || i_start < *pi_start )
+            *pi_start = i_start;
+        if( !b_found || i_end > *pi_end )
+            *pi_end = i_end;
+        b_found = true;
+    }
+
+    return b_found;
+}
+
+/* Returns the end position of the mdat starting at i_pos, or i_pos */
+static uint64_t LeafGetMdatEnd( demux_t *p_demux, uint64_t i_pos )
+{
+    const uint8_t *p_peek;
+    if( stream_Tell( p_demux->s ) != i_pos && stream_Seek( p_demux->s, i_pos ) )
+        return i_pos;
+    if( stream_Peek( p_demux->s, &p_peek, 16 ) < 16 ||
+        VLC_FOURCC( p_peek[4], p_peek[5], p_peek[6], p_peek[7] ) != ATOM_mdat )
+        return i_pos;
+    if( GetDWBE( p_peek ) == 1 )
+        return i_pos + GetQWBE( &p_peek[8] );
+    return i_pos + GetDWBE( p_peek );
+}
+
+/* Records a moof read while playing in the fragments time index */
+static void LeafIndexAddMoof( demux_t *p_demux, const MP4_Box_t *p_moof )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragments_index_t *p_index = &p_sys->fragments.index;
+    stime_t i_start, i_end;
+
+    /* not probed, or sidx based */
+    if( !p_index->i_entries || p_index->b_sidx )
+        return;
+
+    if( !LeafGetMoofTimes( p_demux, p_moof, &i_start, &i_end ) )
+        return;
+
+    /* we're right after the moof, and only peek the mdat */
+    MP4_Fragments_Index_Add( p_index, p_moof->i_pos,
+                             LeafGetMdatEnd( p_demux, p_moof->i_pos + p_moof->i_size ),
+                             i_start - p_index->i_time_base );
+}
+
+/* Reads the moof at i_pos and adds it to the fragments time index */
+static bool LeafIndexReadMoof( demux_t *p_demux, uint64_t i_pos,
+                               mp4_fragment_index_entry_t *p_entry, stime_t *pi_end )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragments_index_t *p_index = &p_sys->fragments.index;
+    bool b_ret = false;
+
+    if( stream_Seek( p_demux->s, i_pos ) )
+        return false;
+
+    MP4_Box_t *p_vroot = MP4_BoxGetNextChunk( p_demux->s );
+    if( !p_vroot )
+        return false;
+
+    MP4_Box_t *p_moof = MP4_BoxGet( p_vroot, "moof" );
+    stime_t i_start, i_end;
+    if( p_moof && p_moof->i_pos == i_pos &&
+        LeafGetMoofTimes( p_demux, p_moof, &i_start, &i_end ) )
+    {
+        p_entry->i_pos = i_pos;
+        p_entry->i_end_pos = LeafGetMdatEnd( p_demux, i_pos + p_moof->i_size );
+        p_entry->i_time = i_start - p_index->i_time_base;
+        if( pi_end )
+            *pi_end = i_end - p_index->i_time_base;
+        b_ret = MP4_Fragments_Index_Add( p_index, p_entry->i_pos,
+                                         p_entry->i_end_pos, p_entry->i_time );
+    }
+
+    MP4_BoxFree( p_vroot );
+    return b_ret;
+}
+
+/* Finds the first moof starting in [i_pos, i_end) by scanning for its
+ * header, moof followed by mfhd. */
+static bool LeafIndexResync( demux_t *p_demux, uint64_t i_pos, uint64_t i_end,
+                             uint64_t *pi_moof )
+{
+    if( stream_Seek( p_demux->s, i_pos ) )
+        return false;
+
+    while( i_pos < i_end )
+    {
+        const uint8_t *p_peek;
+        ssize_t i_peek = stream_Peek( p_demux->s, &p_peek, MP4_RESYNC_SIZE );
+        if( i_peek < 16 )
+            return false;
+
+        for( ssize_t i = 0; i <= i_peek - 16 && i_pos + i < i_end; i++ )
+        {
+            if( p_peek[i + 4] == 'm' && p_peek[i + 5] == 'o' &&
+                p_peek[i + 6] == 'o' && p_peek[i + 7] == 'f' &&
+                !memcmp( &p_peek[i + 12], "mfhd", 4 ) && GetDWBE( &p_peek[i] ) >= 24 )
+            {
+                *pi_moof = i_pos + i;
+                return true;
+            }
+        }
+
+        /* keep the last bytes, header might span */
+        if( stream_Read( p_demux->s, NULL, i_peek - 15 ) != i_peek - 15 )
+            return false;
+        i_pos += i_peek - 15;
+    }
+
+    return false;
+}
+
+/* Finds the moof to seek to for a time from the fragments time index.
+ * Unless it is complete (sidx), it interpolates a position between the
+ * known fragments surrounding that time, resyncs to the next moof there and
+ * refines from its time, adding every moof read to the index. */
+static int LeafIndexFindMoof( demux_t *p_demux, const mtime_t i_target_time,
+                              uint64_t *pi_pos, mtime_t *pi_mooftime )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragments_index_t *p_index = &p_sys->fragments.index;
+    const stime_t i_target = i_target_time * p_sys->i_timescale / CLOCK_FREQ;
+
+    const mp4_fragment_index_entry_t *p_entry =
+            MP4_Fragments_Index_Lookup( p_index, i_target );
+    if( !p_entry )
+        return VLC_EGENERIC;
+
+    mp4_fragment_index_entry_t lo = *p_entry, hi;
+    unsigned i_probes = 0;
+    if( !p_index->b_sidx )
+    {
+        if( p_entry + 1 < &p_index->p_entries[p_index->i_entries] )
+        {
+            hi = p_entry[1];
+        }
+        else
+        {
+            hi.i_pos = hi.i_end_pos = stream_Size( p_demux->s );
+            hi.i_time = p_sys->i_overall_duration;
+        }
+
+        /* Positions an unknown moof could start at are [lo end, i_max) */
+        uint64_t i_max = hi.i_pos;
+        uint64_t i_step = 0; /* backward steps after missing */
+        bool b_bisect = false;
+        int i_side = 0;
+        for( unsigned i = 0; i < MP4_INDEX_MAX_PROBES; i++ )
+        {
+            const uint64_t i_min = lo.i_end_pos > lo.i_pos ? lo.i_end_pos : lo.i_pos + 1;
+            if( i_min >= i_max )
+                break;
+
+            uint64_t i_guess;
+            if( i_step )
+            {
+                i_guess = i_max - __MIN( i_step, i_max - i_min );
+            }
+            else if( b_bisect || hi.i_time <= lo.i_time || i_target <= lo.i_time )
+            {
+                i_guess = i_min + ( i_max - i_min ) / 2;
+            }
+            else
+            {
+                i_guess = lo.i_pos + (uint64_t)( (double)( hi.i_pos - lo.i_pos ) *
+                                      ( i_target - lo.i_time ) / ( hi.i_time - lo.i_time ) );
+                i_guess = VLC_CLIP( i_guess, i_min, i_max - 1 );
+            }
+
+            uint64_t i_moof;
+            if( !LeafIndexResync( p_demux, i_guess, i_max, &i_moof ) )
+            {
+                /* Only the fragments before our guess can be missing, and
+                 * the wanted one is likely close: step back, doubling */
+                i_step = __MAX( 2 * __MAX( i_step, i_max - i_guess ), MP4_RESYNC_SIZE );
+                i_max = i_guess;
+                continue;
+            }
+            i_step = 0;
+
+            mp4_fragment_index_entry_t entry;
+            stime_t i_end_time;
+            if( !LeafIndexReadMoof( p_demux, i_moof, &entry, &i_end_time ) )
+                break;
+            i_probes++;
+
+            /* Interpolation can keep hitting the same side, bisect then */
+            if( entry.i_time <= i_target )
+            {
+                lo = entry;
+                if( i_end_time > i_target )
+                    break;
+                b_bisect = i_side < 0;
+                i_side = -1;
+            }
+            else
+            {
+                hi = entry;
+                i_max = entry.i_pos;
+                b_bisect = i_side > 0;
+                i_side = 1;
+            }
+        }
+    }
+
+    msg_Dbg( p_demux, "fragments index has moof at %"PRIu64" for time %"PRId64
+             " (%u moofs read)", lo.i_pos, i_target_time, i_probes );
+    *pi_pos = lo.i_pos;
+    *pi_mooftime = CLOCK_FREQ * lo.i_time / p_sys->i_timescale;
+    return VLC_SUCCESS;
+}
+
+/* Walks the boxes from i_pos to the end, returning the last moof position */
+static bool LeafFindLastMoof( demux_t *p_demux, uint64_t i_pos, uint64_t *pi_moof )
+{
+    const uint64_t i_size = stream_Size( p_demux->s );
+    bool b_found = false;
+
+    while( i_pos < i_size && stream_Seek( p_demux->s, i_pos ) == VLC_SUCCESS )
+    {
+        const uint8_t *p_peek;
+        if( stream_Peek( p_demux->s, &p_peek, 16 ) < 8 )
+            break;
+
+        uint64_t i_boxsize = GetDWBE( p_peek );
+        if( VLC_FOURCC( p_peek[4], p_peek[5], p_peek[6], p_peek[7] ) == ATOM_moof )
+        {
+            *pi_moof = i_pos;
+            b_found = true;
+        }
+
+        if( i_boxsize == 0 )
+            break;
+        else if( i_boxsize == 1 )
+            i_boxsize = GetQWBE( &p_peek[8] );
+        if( i_boxsize < 8 )
+            break;
+        i_pos += i_boxsize;
+    }
+
+    return b_found;
+}
+
+/* Sets up the fragments time index, as a cheaper replacement of reading
+ * all moofs upfront. It needs either a sidx covering the whole file, or
+ * tfdt in the first moof and the last moof found from the file tail. */
+static bool ProbeFragmentsIndex( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragments_index_t *p_index = &p_sys->fragments.index;
+    const uint64_t i_backup_pos = stream_Tell( p_demux->s );
+    const uint64_t i_size = stream_Size( p_demux->s );
+
+    if( !p_sys->i_timescale || !i_size )
+        return false;
+
+    MP4_Box_t *p_sidx = MP4_BoxGet( p_sys->p_root, "sidx" );
+    if( p_sidx && BOXDATA(p_sidx) && BOXDATA(p_sidx)->i_timescale &&
+        BOXDATA(p_sidx)->i_reference_count )
+    {
+        const MP4_Box_data_sidx_t *p_data = BOXDATA(p_sidx);
+        uint64_t i_pos = p_sidx->i_pos + p_sidx->i_size + p_data->i_first_offset;
+        stime_t i_time = 0;
+
+        p_index->i_time_base = p_data->i_earliest_presentation_time *
+                               p_sys->i_timescale / p_data->i_timescale;
+        for( uint16_t i = 0; i < p_data->i_reference_count; i++ )
+        {
+            const MP4_Box_sidx_item_t *p_item = &p_data->p_items[i];
+            MP4_Fragments_Index_Add( p_index, i_pos, i_pos + p_item->i_referenced_size,
+                                     i_time * p_sys->i_timescale / p_data->i_timescale );
+            i_pos += p_item->i_referenced_size;
+            i_time += p_item->i_subsegment_duration;
+        }
+
+        /* Only a single sidx indexing the whole file will do */
+        const uint8_t *p_peek;
+        bool b_complete = i_pos >= i_size;
+        if( !b_complete && stream_Seek( p_demux->s, i_pos ) == VLC_SUCCESS )
+        {
+            b_complete = stream_Peek( p_demux->s, &p_peek, 8 ) < 8;
+            if( !b_complete )
+            {
+                const uint32_t i_type = VLC_FOURCC( p_peek[4], p_peek[5], p_peek[6], p_peek[7] );
+                b_complete = i_type != ATOM_moof && i_type != ATOM_sidx &&
+                             i_type != ATOM_styp && i_type != ATOM_mdat;
+            }
+        }
+
+        if( b_complete )
+        {
+            p_index->b_sidx = true;
+            if( !p_sys->i_overall_duration )
+                p_sys->i_overall_duration = i_time * p_sys->i_timescale / p_data->i_timescale;
+            msg_Dbg( p_demux, "using sidx as fragments index, %u entries",
+                     p_index->i_entries );
+            return stream_Seek( p_demux->s, i_backup_pos ) == VLC_SUCCESS;
+        }
+
+        p_index->i_entries = 0;
+        p_index->i_time_base = 0;
+    }
+
+    /* Use moofs decoding times */
+    MP4_Box_t *p_moof = MP4_BoxGet( p_sys->p_root, "moof" );
+    stime_t i_start, i_end;
+    if( !p_moof || !LeafGetMoofTimes( p_demux, p_moof, &i_start, &i_end ) )
+    {
+        if( stream_Seek( p_demux->s, i_backup_pos ) )
+            msg_Err( p_demux, "cannot seek back to %"PRIu64, i_backup_pos );
+        return false;
+    }
+
+    p_index->i_time_base = i_start;
+    MP4_Fragments_Index_Add( p_index, p_moof->i_pos,
+                             LeafGetMdatEnd( p_demux, p_moof->i_pos + p_moof->i_size ), 0 );
+
+    if( !p_sys->i_overall_duration )
+    {
+        /* Get the duration from the last moof in the tail */
+        const uint64_t i_first_end = p_index->p_entries[0].i_end_pos;
+        for( uint64_t i_window = MP4_RESYNC_SIZE * 16; i_first_end < i_size; i_window *= 4 )
+        {
+            const uint64_t i_start_pos = i_size - __MIN( i_size - i_first_end, i_window );
+            uint64_t i_moof;
+            mp4_fragment_index_entry_t entry;
+            if( LeafIndexResync( p_demux, i_start_pos, i_size, &i_moof ) &&
+                LeafFindLastMoof( p_demux, i_moof, &i_moof ) &&
+                LeafIndexReadMoof( p_demux, i_moof, &entry, &i_end ) )
+            {
+                p_sys->i_overall_duration = i_end;
+                break;
+            }
+            if( i_start_pos <= i_first_end || i_window >= MP4_TAIL_PROBE_MAX )
+                break;
+        }
+    }
+
+    if( stream_Seek( p_demux->s, i_backup_pos ) != VLC_SUCCESS ||
+        !p_sys->i_overall_duration )
+    {
+        p_index->i_entries = 0;
+        return false;
+    }
+
+    msg_Dbg( p_demux, "using moofs decoding time as fragments index" );
+    return true;
+}
+
 static int ProbeIndex( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -4125,7 +4891,8 @@ static int ProbeFragments( demux_t *p_demux, bool b_force )
 
     assert( p_sys->p_root );
 
-    if ( p_sys->b_fastseekable || b_force )
+    const bool b_index = !b_force && var_InheritBool( p_demux, "mp4-fragments-index" );
+    if ( ( p_sys->b_fastseekable && !b_index ) || b_force )
     {
         MP4_ReadBoxContainerChildren( p_demux->s, p_sys->p_root, NULL ); /* Get the rest of the file */
         p_sys->b_fragments_probed = true;
@@ -4150,6 +4917,13 @@ static int ProbeFragments( demux_t *p_demux, bool b_force )
         AddFragment( p_demux, p_moov );
     }
 
+    if ( b_index && !p_sys->b_fragments_probed && !ProbeFragmentsIndex( p_demux ) &&
+         p_sys->b_fastseekable )
+    {
+        MP4_ReadBoxContainerChildren( p_demux->s, p_sys->p_root, NULL ); /* Get the rest of the file */
+        p_sys->b_fragments_probed = true;
+    }
+
     MP4_Box_t *p_moof = MP4_BoxGet( p_sys->p_root, "moof" );
     while ( p_moof )
     {
@@ -4845,6 +5619,9 @@ static int DemuxAsLeaf( demux_t *p_demux )
                         if( p_sidx && BOXDATA(p_sidx) && BOXDATA(p_sidx)->i_timescale )
                         {
                             mtime_t i_time_base = BOXDATA(p_sidx)->i_earliest_presentation_time;
+                            /* relative to the first fragment, as the index */
+                            i_time_base -= p_sys->fragments.index.i_time_base *
+                                           BOXDATA(p_sidx)->i_timescale / p_sys->i_timescale;
 
                             for( unsigned int i_track = 0; i_track < p_sys->i_tracks; i_track++ )
                             {
@@ -4861,6 +5638,8 @@ static int DemuxAsLeaf( demux_t *p_demux )
 
                 /* create fragment */
                 AddFragment( p_demux, p_mooxbox );
+                if( p_mooxbox->i_type == ATOM_moof )
+                    LeafIndexAddMoof( p_demux, p_mooxbox );
 
                 /* Append to root */
                 p_sys->p_root->p_last->p_next = p_mooxbox;
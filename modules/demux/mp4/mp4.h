@@ -61,6 +61,23 @@ typedef struct
 
 } mp4_chunk_t;
 
+/* Position in a stts/ctts table, to find sample timestamps without
+   expanding the table */
+typedef struct
+{
+    uint32_t     i_index;        /* table entry */
+    uint32_t     i_first_sample; /* first sample of that entry */
+    int64_t      i_first_dts;    /* dts of that sample, for stts only */
+} mp4_tts_cursor_t;
+
+/* Position in a stsc table, to find chunks without expanding the table */
+typedef struct
+{
+    uint32_t     i_index;        /* table entry */
+    uint32_t     i_first_chunk;  /* first chunk of that entry */
+    uint32_t     i_first_sample; /* first sample of that entry */
+} mp4_stsc_cursor_t;
+
  /* Contain all needed information for read all track with vlc */
 typedef struct
 {
@@ -110,6 +127,20 @@ typedef struct
     uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
                                     too much time to do sumations each time*/
 
+    /* lazy sample tables: the chunk table is decoded from stco/stsc a page
+       at a time when first needed, without the per chunk dts, and the
+       timestamps of the samples are read from stts/ctts on demand.
+       chunk is then NULL and p_sample_size points to the stsz table. */
+    bool             b_lazy_tables;
+    const MP4_Box_data_co64_t *p_co64;
+    const MP4_Box_data_stsc_t *p_stsc;
+    const MP4_Box_data_stts_t *p_stts;
+    const MP4_Box_data_ctts_t *p_ctts; /* could be NULL */
+    mp4_chunk_t      **pp_chunk_pages;
+    mp4_stsc_cursor_t stsc_cursor;  /* last lookups, for sequential reads */
+    mp4_tts_cursor_t dts_cursor;
+    mp4_tts_cursor_t pts_cursor;
+
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
     uint64_t     i_first_dts;    /* i_first_dts value
@@ -44,6 +44,8 @@
 
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
+#include "ts_index.h"
+#include "../index_cache.h"
 #include "sections.h"
 #include "pes.h"
 #include "timestamps.h"
@@ -117,6 +119,11 @@ static const char *const ts_standards_list[] =
 static const char *const ts_standards_list_text[] =
   { N_("Auto"), "MPEG", "DVB", "ARIB", "ATSC", "T-DMB" };
 
+#define SEEK_INDEX_TEXT N_("Store seek index")
+#define SEEK_INDEX_LONGTEXT N_("Keep the seek index built while playing " \
+    "a local recording in a file next to it, so that seeking is immediate " \
+    "when the recording is opened again.")
+
 #define STANDARD_TEXT N_("Digital TV Standard")
 #define STANDARD_LONGTEXT N_( "Selects mode for digital TV standard." \
                               "This feature affects EPG information and subtitles." )
@@ -146,6 +153,7 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_bool( "ts-seek-index-file", false, SEEK_INDEX_TEXT, SEEK_INDEX_LONGTEXT, true )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -167,11 +175,11 @@ static bool PIDReferencedByProgram( const ts_pmt_t *, uint16_t );
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
 static inline void FlushESBuffer( ts_pes_t *p_pes );
 static void UpdatePIDScrambledState( demux_t *p_demux, ts_pid_t *p_pid, bool );
-static inline int PIDGet( block_t *p )
+static inline int PIDGet( const uint8_t *p )
 {
-    return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
+    return ( (p[1]&0x1f)<<8 )|p[2];
 }
-static mtime_t GetPCR( const block_t * );
+static mtime_t GetPCR( const uint8_t *, size_t );
 
 static bool ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt );
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t, bool );
@@ -181,12 +189,16 @@ static block_t* ReadTSPacket( demux_t *p_demux );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
+static ts_index_t * GetSeekIndex( demux_sys_t *, const ts_pmt_t * );
+static void SeekIndexAppend( demux_t *, const ts_pmt_t *, mtime_t, bool );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 
 #define TS_PACKET_SIZE_188 188
 #define TS_PACKET_SIZE_192 192
 #define TS_PACKET_SIZE_204 204
 #define TS_PACKET_SIZE_MAX 204
+/* TS packets peeked at once by Demux(), whatever its per call budget */
+#define TS_READ_CHUNK 512
 #define TS_HEADER_SIZE 4
 
 static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_offset )
@@ -383,6 +395,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->i_chunk_left = 0;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -504,6 +517,30 @@ static int Open( vlc_object_t *p_this )
     stream_Control( p_sys->stream, STREAM_CAN_SEEK, &p_sys->b_canseek );
     stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK, &p_sys->b_canfastseek );
 
+    ARRAY_INIT( p_sys->seekindex.programs );
+    p_sys->seekindex.psz_file = NULL;
+    p_sys->seekindex.b_enabled = p_sys->b_canseek && !p_sys->b_access_control;
+    if( p_sys->seekindex.b_enabled && p_demux->psz_file &&
+        var_InheritBool( p_demux, "ts-seek-index-file" ) )
+    {
+        uint8_t key[INDEX_CACHE_KEY_SIZE];
+        ts_index_t **pp_index;
+        size_t i_index;
+
+        if( asprintf( &p_sys->seekindex.psz_file, "%s.tsidx", p_demux->psz_file ) < 0 )
+            p_sys->seekindex.psz_file = NULL;
+        else if( !index_cache_GetKey( p_sys->stream, key ) &&
+                 !ts_index_Load( VLC_OBJECT(p_demux), p_sys->seekindex.psz_file,
+                                 key, p_sys->i_packet_size,
+                                 stream_Size( p_sys->stream ),
+                                 &pp_index, &i_index ) )
+        {
+            for( size_t i = 0; i < i_index; i++ )
+                ARRAY_APPEND( p_sys->seekindex.programs, pp_index[i] );
+            free( pp_index );
+        }
+    }
+
     /* Preparse time */
     if( p_sys->b_canseek )
     {
@@ -540,6 +577,24 @@ static void Close( vlc_object_t *p_this )
 
     ARRAY_RESET( p_sys->programs );
 
+    if( p_sys->seekindex.psz_file )
+    {
+        uint8_t key[INDEX_CACHE_KEY_SIZE];
+        bool b_modified = false;
+        for( int i = 0; i < p_sys->seekindex.programs.i_size; i++ )
+            b_modified |= p_sys->seekindex.programs.p_elems[i]->b_modified;
+        /* A recording may have grown since loaded: store its current key */
+        if( b_modified && !index_cache_GetKey( p_sys->stream, key ) )
+            ts_index_Store( VLC_OBJECT(p_demux), p_sys->seekindex.psz_file,
+                            key, p_sys->i_packet_size,
+                            p_sys->seekindex.programs.p_elems,
+                            p_sys->seekindex.programs.i_size );
+        free( p_sys->seekindex.psz_file );
+    }
+    for( int i = 0; i < p_sys->seekindex.programs.i_size; i++ )
+        ts_index_Delete( p_sys->seekindex.programs.p_elems[i] );
+    ARRAY_RESET( p_sys->seekindex.programs );
+
 #ifdef HAVE_ARIBB24
     if ( p_sys->arib.p_instance )
         arib_instance_destroy( p_sys->arib.p_instance );
@@ -596,14 +651,97 @@ static int Demux( demux_t *p_demux )
         p_sys->patfix.status = PAT_FIXTRIED;
     }
 
-    /* We read at most 100 TS packet or until a frame is completed */
+    /* Packets are parsed in place from a peeked chunk of the stream, and only
+     * consumed once the chunk is done with. Only the gathered PES packets are
+     * copied to a block. The peek buffer must not be used after any other
+     * call on the stream: packets whose handling may reach the stream are
+     * copied, and the chunk consumed, beforehand. With hardware filtering,
+     * any PID filter change reaches the stream, so packets are read one by
+     * one.
+     * Chunks are larger than the per call budget. What a call leaves of one
+     * is still in the stream peek buffer, and the next call only peeks that
+     * much, so that it is not copied again to top it up. */
+    uint8_t pkt[TS_PACKET_SIZE_MAX];
+    const uint8_t *p_chunk = NULL;
+    uint64_t i_chunk_pos = 0;
+    size_t i_chunk = 0;
+    size_t i_consumed = 0;
+    bool b_eof = false;
+
+    /* We read at most i_ts_read TS packets or until a frame is completed */
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
         bool         b_frame = false;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        block_t     *p_pkt = NULL;
+        const uint8_t *p_raw;
+
+        if( !p_sys->b_access_control &&
+            i_consumed + p_sys->i_packet_size > i_chunk )
         {
-            return VLC_DEMUXER_EOF;
+            if( i_consumed > 0 &&
+                stream_Read( p_sys->stream, NULL, i_consumed ) != (ssize_t)i_consumed )
+            {
+                b_eof = true;
+                break;
+            }
+            i_consumed = 0;
+
+            i_chunk_pos = stream_Tell( p_sys->stream );
+            const size_t i_want = ( p_sys->i_chunk_left >= p_sys->i_packet_size )
+                                ? p_sys->i_chunk_left
+                                : p_sys->i_packet_size * TS_READ_CHUNK;
+            ssize_t i_peek = stream_Peek( p_sys->stream, &p_chunk, i_want );
+            i_chunk = ( i_peek > 0 ) ? i_peek : 0;
+            p_sys->i_chunk_left = 0;
+        }
+
+        if( i_consumed + p_sys->i_packet_size <= i_chunk &&
+            p_chunk[i_consumed + p_sys->i_packet_header_size] == 0x47 )
+        {
+            p_raw = &p_chunk[i_consumed + p_sys->i_packet_header_size];
+            p_sys->seekindex.i_pos = i_chunk_pos + i_consumed;
+            i_consumed += p_sys->i_packet_size;
+        }
+        else
+        {
+            /* Partial packet or lost sync: use the slow path that resyncs */
+            if( i_consumed > 0 &&
+                stream_Read( p_sys->stream, NULL, i_consumed ) != (ssize_t)i_consumed )
+            {
+                b_eof = true;
+                break;
+            }
+            i_consumed = i_chunk = 0;
+
+            if( !(p_pkt = ReadTSPacket( p_demux )) )
+            {
+                b_eof = true;
+                break;
+            }
+            p_raw = p_pkt->p_buffer;
+            p_sys->seekindex.i_pos = stream_Tell( p_sys->stream ) - p_sys->i_packet_size;
+        }
+        const size_t i_raw = p_sys->i_packet_size - p_sys->i_packet_header_size;
+
+        /* Parse the TS packet */
+        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_raw ) );
+
+        const bool b_scrambled_change = (p_raw[1] & 0x40) && (p_raw[3] & 0x10) &&
+                                        !SCRAMBLED(*p_pid) != !(p_raw[3] & 0x80);
+
+        /* Recording and PSI callbacks (CAM, filters) call the stream */
+        if( p_pkt == NULL &&
+            ( p_sys->b_start_record || b_scrambled_change ||
+              p_pid->type == TYPE_PAT || p_pid->type == TYPE_PMT ) )
+        {
+            memcpy( pkt, p_raw, i_raw );
+            p_raw = pkt;
+            if( stream_Read( p_sys->stream, NULL, i_consumed ) != (ssize_t)i_consumed )
+            {
+                b_eof = true;
+                break;
+            }
+            i_consumed = i_chunk = 0;
         }
 
         if( p_sys->b_start_record )
@@ -613,13 +751,9 @@ static int Demux( demux_t *p_demux )
             p_sys->b_start_record = false;
         }
 
-        /* Parse the TS packet */
-        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
-
-        if( (p_pkt->p_buffer[1] & 0x40) && (p_pkt->p_buffer[3] & 0x10) &&
-            !SCRAMBLED(*p_pid) != !(p_pkt->p_buffer[3] & 0x80) )
+        if( b_scrambled_change )
         {
-            UpdatePIDScrambledState( p_demux, p_pid, p_pkt->p_buffer[3] & 0x80 );
+            UpdatePIDScrambledState( p_demux, p_pid, p_raw[3] & 0x80 );
         }
 
         if( !SEEN(p_pid) )
@@ -630,37 +764,47 @@ static int Demux( demux_t *p_demux )
         }
 
         /* Adaptation field cannot be scrambled */
-        mtime_t i_pcr = GetPCR( p_pkt );
+        mtime_t i_pcr = GetPCR( p_raw, i_raw );
         if( i_pcr > VLC_TS_INVALID )
             PCRHandle( p_demux, p_pid, i_pcr );
 
         if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa )
         {
-            block_Release( p_pkt );
+            if( p_pkt )
+                block_Release( p_pkt );
             continue;
         }
 
         /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
         if( !SEEN( GetPID( p_sys, 0 ) ) &&
             (p_pid->probed.i_type == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
-            (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-            (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
+            (p_raw[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
+            (p_raw[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
         {
-            ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
-                      p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
+            ProbePES( p_demux, p_pid, p_raw + TS_HEADER_SIZE,
+                      i_raw - TS_HEADER_SIZE, p_raw[3] & 0x20 /* Adaptation field */);
         }
 
         switch( p_pid->type )
         {
         case TYPE_PAT:
         case TYPE_PMT:
-            ts_psi_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            ts_psi_Packet_Push( p_pid, p_raw );
             break;
 
         case TYPE_PES:
             p_sys->b_end_preparse = true;
 
+            /* Random access indicator of video streams */
+            if( p_sys->seekindex.b_enabled &&
+                (p_raw[3] & 0x20) && p_raw[4] > 0 && (p_raw[5] & 0x40) &&
+                p_pid->u.p_pes->p_es->fmt.i_cat == VIDEO_ES &&
+                p_pid->u.p_pes->p_es->p_program )
+            {
+                const ts_pmt_t *p_pmt = p_pid->u.p_pes->p_es->p_program;
+                SeekIndexAppend( p_demux, p_pmt, p_pmt->pcr.i_current, true );
+            }
+
             if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
             {
                 msg_Dbg( p_demux, "Creating delayed ES" );
@@ -671,33 +815,50 @@ static int Demux( demux_t *p_demux )
             if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
             {
                 /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
-                continue;
+                break;
+            }
+
+            if( p_pkt == NULL )
+            {
+                p_pkt = block_Alloc( i_raw );
+                if( unlikely(p_pkt == NULL) )
+                    break;
+                memcpy( p_pkt->p_buffer, p_raw, i_raw );
             }
 
             b_frame = ProcessTSPacket( p_demux, p_pid, p_pkt );
+            p_pkt = NULL;
             break;
 
         case TYPE_SI:
-            ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            ts_si_Packet_Push( p_pid, p_raw );
             break;
 
         case TYPE_PSIP:
-            ts_psip_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            ts_psip_Packet_Push( p_pid, p_raw );
             break;
 
         default:
             /* We have to handle PCR if present */
-            block_Release( p_pkt );
             break;
         }
 
+        if( p_pkt )
+            block_Release( p_pkt );
+
         if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
             break;
     }
 
+    if( i_consumed > 0 &&
+        stream_Read( p_sys->stream, NULL, i_consumed ) != (ssize_t)i_consumed )
+        b_eof = true;
+    else
+        p_sys->i_chunk_left = i_chunk - i_consumed;
+
+    if( b_eof )
+        return VLC_DEMUXER_EOF;
+
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -1636,13 +1797,11 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
-static mtime_t GetPCR( const block_t *p_pkt )
+static mtime_t GetPCR( const uint8_t *p, size_t i_size )
 {
-    const uint8_t *p = p_pkt->p_buffer;
-
     mtime_t i_pcr = -1;
 
-    if( likely(p_pkt->i_buffer > 11) &&
+    if( likely(i_size > 11) &&
         ( p[3]&0x20 ) && /* adaptation */
         ( p[5]&0x10 ) &&
         ( p[4] >= 7 ) )
@@ -1707,6 +1866,9 @@ static void ReadyQueuesPostSeek( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    for( int i = 0; i < p_sys->seekindex.programs.i_size; i++ )
+        ts_index_SetJump( p_sys->seekindex.programs.p_elems[i] );
+
     ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
     for( int i=0; i< p_pat->programs.i_size; i++ )
     {
@@ -1756,14 +1918,29 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
         return stream_Seek( p_sys->stream, 0 );
 
+    /* Use the index of the already demuxed parts */
+    uint64_t i_low = 0, i_high = 0;
+    if( p_sys->seekindex.b_enabled && p_pmt->pcr.i_first != -1 )
+    {
+        ts_index_t *p_index = GetSeekIndex( p_sys, p_pmt );
+        uint64_t i_pos;
+        if( p_index &&
+            ts_index_Lookup( p_index, i_scaledtime, &i_pos, &i_low, &i_high ) &&
+            stream_Seek( p_sys->stream, i_pos ) == VLC_SUCCESS )
+            return VLC_SUCCESS;
+    }
+
     if( !p_sys->b_canfastseek )
         return VLC_EGENERIC;
 
     int64_t i_initial_pos = stream_Tell( p_sys->stream );
 
-    /* Find the time position by using binary search algorithm. */
-    int64_t i_head_pos = 0;
+    /* Find the time position by using binary search algorithm,
+     * within the bounds the index could provide. */
+    int64_t i_head_pos = i_low - i_low % p_sys->i_packet_size;
     int64_t i_tail_pos = stream_Size( p_sys->stream ) - p_sys->i_packet_size;
+    if( i_high > 0 && (int64_t) i_high < i_tail_pos )
+        i_tail_pos = i_high;
     if( i_head_pos >= i_tail_pos )
         return VLC_EGENERIC;
 
@@ -1791,7 +1968,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
             else
                 i_pos = stream_Tell( p_sys->stream );
 
-            int i_pid = PIDGet( p_pkt );
+            int i_pid = PIDGet( p_pkt->p_buffer );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
             if( i_pid != 0x1FFF && p_pid->type == TYPE_PES &&
                 ts_pes_Find_es( p_pid->u.p_pes, p_pmt ) &&
@@ -1804,7 +1981,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                 {
                     if( p_pkt->i_buffer >= 4 + 2 + 5 )
                     {
-                        i_pcr = GetPCR( p_pkt );
+                        i_pcr = GetPCR( p_pkt->p_buffer, p_pkt->i_buffer );
                         i_skip += 1 + p_pkt->p_buffer[4];
                     }
                 }
@@ -1867,7 +2044,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
             break;
         }
 
-        const int i_pid = PIDGet( p_pkt );
+        const int i_pid = PIDGet( p_pkt->p_buffer );
         ts_pid_t *p_pid = GetPID(p_sys, i_pid);
 
         p_pid->i_flags |= FLAG_SEEN;
@@ -1878,7 +2055,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
             bool b_adaptfield = p_pkt->p_buffer[3] & 0x20;
 
             if( b_adaptfield && p_pkt->i_buffer >= 4 + 2 + 5 )
-                *pi_pcr = GetPCR( p_pkt );
+                *pi_pcr = GetPCR( p_pkt->p_buffer, p_pkt->i_buffer );
 
             if( *pi_pcr == -1 &&
                 (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* payload start */
@@ -2101,6 +2278,38 @@ static void PCRCheckDTS( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr)
     }
 }
 
+static ts_index_t * GetSeekIndex( demux_sys_t *p_sys, const ts_pmt_t *p_pmt )
+{
+    for( int i = 0; i < p_sys->seekindex.programs.i_size; i++ )
+    {
+        ts_index_t *p_index = p_sys->seekindex.programs.p_elems[i];
+        if( p_index->i_program == p_pmt->i_number )
+        {
+            ts_index_SetTimebase( p_index, p_pmt->pcr.i_first );
+            return p_index;
+        }
+    }
+
+    ts_index_t *p_index = ts_index_New( p_pmt->i_number, p_pmt->pcr.i_first );
+    if( p_index )
+        ARRAY_APPEND( p_sys->seekindex.programs, p_index );
+    return p_index;
+}
+
+static void SeekIndexAppend( demux_t *p_demux, const ts_pmt_t *p_pmt,
+                             mtime_t i_pcr, bool b_keyframe )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->seekindex.b_enabled || !p_pmt->b_selected ||
+        p_pmt->pcr.i_first == -1 || i_pcr == -1 )
+        return;
+
+    ts_index_t *p_index = GetSeekIndex( p_sys, p_pmt );
+    if( p_index )
+        ts_index_Append( p_index, i_pcr, p_sys->seekindex.i_pos, b_keyframe );
+}
+
 static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
@@ -2126,6 +2335,7 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
             {
                 /* ? update PCR for the whole group program ? */
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                SeekIndexAppend( p_demux, p_pmt, i_program_pcr, false );
             }
         }
         else /* set PCR provided by current pid to program(s) referencing it */
@@ -2136,6 +2346,7 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
                 /* We've found a target group for update */
                 PCRCheckDTS( p_demux, p_pmt, i_pcr );
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                SeekIndexAppend( p_demux, p_pmt, i_program_pcr, false );
             }
         }
 
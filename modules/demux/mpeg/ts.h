@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_index_t ts_index_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -59,6 +60,8 @@ struct demux_sys_t
 
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
+    /* bytes left in the stream peek buffer from the last chunk */
+    size_t      i_chunk_left;
 
     bool        b_force_seek_per_percent;
 
@@ -121,6 +124,15 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+
+    /* Seek index */
+    struct
+    {
+        bool        b_enabled;
+        char       *psz_file; /* sidecar storage */
+        uint64_t    i_pos; /* position of the packet being demuxed */
+        DECL_ARRAY(ts_index_t *) programs;
+    } seekindex;
 };
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
@@ -0,0 +1,289 @@
+/*****************************************************************************
+ * ts_index.c : Seek index for the TS demuxer
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "ts_index.h"
+#include "../index_cache.h"
+
+#define INDEX_ALLOC_CHUNK 1024
+
+/* Sidecar file layout, after the index cache header, values big endian:
+ * header: packet size, programs count
+ * program: number, flags, first pcr, entries count
+ * entry: time, position, flags */
+#define INDEX_MAGIC "VLCTSIDX"
+#define INDEX_VERSION 2
+#define INDEX_HEADER_SIZE (4 + 4)
+#define INDEX_PROGRAM_SIZE (2 + 2 + 8 + 4)
+#define INDEX_ENTRY_SIZE (8 + 8 + 1)
+
+ts_index_t * ts_index_New( uint16_t i_program, int64_t i_first_pcr )
+{
+    ts_index_t *p_index = malloc( sizeof(*p_index) );
+    if( !p_index )
+        return NULL;
+    p_index->i_program = i_program;
+    p_index->i_first_pcr = i_first_pcr;
+    p_index->b_keyframes = false;
+    p_index->b_jump = false;
+    p_index->b_modified = false;
+    p_index->i_entries = 0;
+    p_index->i_alloc = 0;
+    p_index->p_entries = NULL;
+    return p_index;
+}
+
+void ts_index_Delete( ts_index_t *p_index )
+{
+    free( p_index->p_entries );
+    free( p_index );
+}
+
+void ts_index_SetTimebase( ts_index_t *p_index, int64_t i_first_pcr )
+{
+    if( p_index->i_first_pcr == i_first_pcr )
+        return;
+    p_index->i_first_pcr = i_first_pcr;
+    p_index->i_entries = 0;
+    p_index->b_keyframes = false;
+    p_index->b_jump = false;
+    p_index->b_modified = true;
+}
+
+void ts_index_SetJump( ts_index_t *p_index )
+{
+    p_index->b_jump = true;
+}
+
+void ts_index_Append( ts_index_t *p_index, int64_t i_time, uint64_t i_pos,
+                      bool b_keyframe )
+{
+    /* Once random access points are seen, only index those */
+    if( !b_keyframe && p_index->b_keyframes )
+        return;
+
+    if( p_index->i_entries )
+    {
+        const ts_index_entry_t *p_last = &p_index->p_entries[p_index->i_entries - 1];
+        /* Only grow at end, as we can't tell about unindexed regions */
+        if( i_pos <= p_last->i_pos || i_time < p_last->i_time )
+            return;
+        if( !p_index->b_jump && i_time - p_last->i_time < TS_INDEX_INTERVAL &&
+            ( !b_keyframe || p_index->b_keyframes ) )
+            return;
+    }
+
+    if( p_index->i_entries == p_index->i_alloc )
+    {
+        ts_index_entry_t *p_realloc = realloc( p_index->p_entries,
+                    (p_index->i_alloc + INDEX_ALLOC_CHUNK) * sizeof(ts_index_entry_t) );
+        if( !p_realloc )
+            return;
+        p_index->p_entries = p_realloc;
+        p_index->i_alloc += INDEX_ALLOC_CHUNK;
+    }
+
+    ts_index_entry_t *p_entry = &p_index->p_entries[p_index->i_entries++];
+    p_entry->i_time = i_time;
+    p_entry->i_pos = i_pos;
+    p_entry->i_flags = 0;
+    if( b_keyframe )
+    {
+        p_entry->i_flags |= TS_INDEX_FLAG_KEYFRAME;
+        p_index->b_keyframes = true;
+    }
+    if( p_index->b_jump && p_index->i_entries > 1 )
+        p_entry->i_flags |= TS_INDEX_FLAG_JUMP;
+    p_index->b_jump = false;
+    p_index->b_modified = true;
+}
+
+bool ts_index_Lookup( const ts_index_t *p_index, int64_t i_time, uint64_t *pi_pos,
+                      uint64_t *pi_low, uint64_t *pi_high )
+{
+    *pi_low = 0;
+    *pi_high = 0;
+
+    if( p_index->i_entries == 0 )
+        return false;
+
+    /* Find the last entry before time */
+    size_t i_lo = 0, i_hi = p_index->i_entries;
+    while( i_lo < i_hi )
+    {
+        size_t i_mid = i_lo + (i_hi - i_lo) / 2;
+        if( p_index->p_entries[i_mid].i_time <= i_time )
+            i_lo = i_mid + 1;
+        else
+            i_hi = i_mid;
+    }
+
+    if( i_lo == 0 )
+    {
+        *pi_high = p_index->p_entries[0].i_pos;
+        return false;
+    }
+
+    const ts_index_entry_t *p_entry = &p_index->p_entries[i_lo - 1];
+    const ts_index_entry_t *p_next = ( i_lo < p_index->i_entries ) ?
+                                     &p_index->p_entries[i_lo] : NULL;
+
+    /* Time is within a contiguously demuxed region, or close enough
+     * after the last entry of one */
+    if( ( p_next && !(p_next->i_flags & TS_INDEX_FLAG_JUMP) ) ||
+        i_time - p_entry->i_time <= 2 * TS_INDEX_INTERVAL )
+    {
+        *pi_pos = p_entry->i_pos;
+        return true;
+    }
+
+    *pi_low = p_entry->i_pos;
+    if( p_next )
+        *pi_high = p_next->i_pos;
+    return false;
+}
+
+int ts_index_Load( vlc_object_t *p_obj, const char *psz_path, const uint8_t *p_key,
+                   unsigned i_packet_size, uint64_t i_stream_size,
+                   ts_index_t ***ppp_index, size_t *pi_index )
+{
+    uint8_t header[INDEX_HEADER_SIZE];
+    ts_index_t **pp_index = NULL;
+    size_t i_index = 0;
+
+    FILE *p_file = index_cache_Open( p_obj, psz_path, INDEX_MAGIC,
+                                     INDEX_VERSION, p_key );
+    if( !p_file )
+        return VLC_EGENERIC;
+
+    if( fread( header, INDEX_HEADER_SIZE, 1, p_file ) != 1 ||
+        GetDWBE( &header[0] ) != i_packet_size )
+        goto error;
+
+    const uint32_t i_programs = GetDWBE( &header[4] );
+    for( uint32_t i = 0; i < i_programs; i++ )
+    {
+        uint8_t program[INDEX_PROGRAM_SIZE];
+        if( fread( program, INDEX_PROGRAM_SIZE, 1, p_file ) != 1 )
+            goto error;
+
+        ts_index_t *p_index = ts_index_New( GetWBE( &program[0] ),
+                                            GetQWBE( &program[4] ) );
+        if( !p_index )
+            goto error;
+
+        ts_index_t **pp_realloc = realloc( pp_index, (i_index + 1) * sizeof(*pp_index) );
+        if( !pp_realloc )
+        {
+            ts_index_Delete( p_index );
+            goto error;
+        }
+        pp_index = pp_realloc;
+        pp_index[i_index++] = p_index;
+
+        const uint32_t i_entries = GetDWBE( &program[12] );
+        p_index->b_keyframes = GetWBE( &program[2] ) & 0x01;
+        if( i_entries == 0 )
+            continue;
+        if( i_entries > SIZE_MAX / sizeof(ts_index_entry_t) )
+            goto error;
+        p_index->p_entries = malloc( i_entries * sizeof(ts_index_entry_t) );
+        if( !p_index->p_entries )
+            goto error;
+        p_index->i_alloc = i_entries;
+
+        for( uint32_t j = 0; j < i_entries; j++ )
+        {
+            uint8_t entry[INDEX_ENTRY_SIZE];
+            if( fread( entry, INDEX_ENTRY_SIZE, 1, p_file ) != 1 )
+                goto error;
+
+            ts_index_entry_t *p_entry = &p_index->p_entries[j];
+            p_entry->i_time = GetQWBE( &entry[0] );
+            p_entry->i_pos = GetQWBE( &entry[8] );
+            p_entry->i_flags = entry[16];
+            if( p_entry->i_pos >= i_stream_size ||
+                ( j > 0 && ( p_entry->i_pos <= p_entry[-1].i_pos ||
+                             p_entry->i_time < p_entry[-1].i_time ) ) )
+                goto error;
+            p_index->i_entries++;
+        }
+        /* whatever comes next is not contiguous */
+        p_index->b_jump = true;
+    }
+
+    fclose( p_file );
+    msg_Dbg( p_obj, "loaded seek index %s", psz_path );
+    *ppp_index = pp_index;
+    *pi_index = i_index;
+    return VLC_SUCCESS;
+
+error:
+    msg_Warn( p_obj, "invalid seek index %s", psz_path );
+    fclose( p_file );
+    for( size_t i = 0; i < i_index; i++ )
+        ts_index_Delete( pp_index[i] );
+    free( pp_index );
+    return VLC_EGENERIC;
+}
+
+int ts_index_Store( vlc_object_t *p_obj, const char *psz_path, const uint8_t *p_key,
+                    unsigned i_packet_size,
+                    ts_index_t * const *pp_index, size_t i_index )
+{
+    uint8_t header[INDEX_HEADER_SIZE];
+
+    FILE *p_file = index_cache_Create( p_obj, psz_path, INDEX_MAGIC,
+                                       INDEX_VERSION, p_key );
+    if( !p_file )
+        return VLC_EGENERIC;
+
+    SetDWBE( &header[0], i_packet_size );
+    SetDWBE( &header[4], i_index );
+    bool b_error = fwrite( header, INDEX_HEADER_SIZE, 1, p_file ) != 1;
+
+    for( size_t i = 0; i < i_index && !b_error; i++ )
+    {
+        const ts_index_t *p_index = pp_index[i];
+        uint8_t program[INDEX_PROGRAM_SIZE];
+
+        SetWBE( &program[0], p_index->i_program );
+        SetWBE( &program[2], p_index->b_keyframes ? 0x01 : 0x00 );
+        SetQWBE( &program[4], p_index->i_first_pcr );
+        SetDWBE( &program[12], p_index->i_entries );
+        b_error = fwrite( program, INDEX_PROGRAM_SIZE, 1, p_file ) != 1;
+
+        for( size_t j = 0; j < p_index->i_entries && !b_error; j++ )
+        {
+            const ts_index_entry_t *p_entry = &p_index->p_entries[j];
+            uint8_t entry[INDEX_ENTRY_SIZE];
+
+            SetQWBE( &entry[0], p_entry->i_time );
+            SetQWBE( &entry[8], p_entry->i_pos );
+            entry[16] = p_entry->i_flags;
+            b_error = fwrite( entry, INDEX_ENTRY_SIZE, 1, p_file ) != 1;
+        }
+    }
+
+    return index_cache_Commit( p_obj, p_file, psz_path, b_error );
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************
+ * ts_index.h : Seek index for the TS demuxer
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifndef VLC_TS_INDEX_H
+#define VLC_TS_INDEX_H
+
+/* Minimum time between two index entries (90kHz) */
+#define TS_INDEX_INTERVAL (90000 / 2)
+
+#define TS_INDEX_FLAG_KEYFRAME 0x01 /* random access indicator set */
+#define TS_INDEX_FLAG_JUMP     0x02 /* not contiguous with previous entry */
+
+typedef struct
+{
+    int64_t  i_time; /* program PCR, wrap around extended */
+    uint64_t i_pos;  /* position of the packet in the stream */
+    uint8_t  i_flags;
+} ts_index_entry_t;
+
+/* time to position index of one program, only appended to while demuxing */
+typedef struct ts_index_t
+{
+    uint16_t i_program;
+    int64_t  i_first_pcr; /* timebase the entries relate to */
+    bool     b_keyframes; /* random access points are signaled */
+    bool     b_jump;      /* next entry follows a seek */
+    bool     b_modified;  /* since loaded */
+    size_t   i_entries;
+    size_t   i_alloc;
+    ts_index_entry_t *p_entries;
+} ts_index_t;
+
+ts_index_t * ts_index_New( uint16_t i_program, int64_t i_first_pcr );
+void ts_index_Delete( ts_index_t * );
+
+/* drops all entries if the index was built on another timebase */
+void ts_index_SetTimebase( ts_index_t *, int64_t i_first_pcr );
+void ts_index_SetJump( ts_index_t * );
+void ts_index_Append( ts_index_t *, int64_t i_time, uint64_t i_pos, bool b_keyframe );
+
+/**
+ * Looks up the position to seek to for a given time.
+ * On failure, *pi_low and *pi_high are set to the known bounds of the
+ * position (*pi_high is 0 if unknown).
+ * @return true if the indexed region directly covers the time
+ */
+bool ts_index_Lookup( const ts_index_t *, int64_t i_time, uint64_t *pi_pos,
+                      uint64_t *pi_low, uint64_t *pi_high );
+
+/* Sidecar file storage, bound to the stream identity (see index_cache.h) */
+int ts_index_Load( vlc_object_t *, const char *psz_path, const uint8_t *p_key,
+                   unsigned i_packet_size, uint64_t i_stream_size,
+                   ts_index_t ***ppp_index, size_t *pi_index );
+int ts_index_Store( vlc_object_t *, const char *psz_path, const uint8_t *p_key,
+                    unsigned i_packet_size,
+                    ts_index_t * const *pp_index, size_t i_index );
+
+#endif
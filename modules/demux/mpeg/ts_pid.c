@@ -40,8 +40,8 @@ void ts_pid_list_Init( ts_pid_list_t *p_list )
     p_list->pp_all = NULL;
     p_list->i_all = 0;
     p_list->i_all_alloc = 0;
-    p_list->i_last_pid = 0;
-    p_list->p_last = NULL;
+    for( int i = 0; i < TS_PID_PAGES; i++ )
+        p_list->pp_index[i] = NULL;
 }
 
 void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
@@ -56,6 +56,8 @@ void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
         free( pid );
     }
     free( p_list->pp_all );
+    for( int i = 0; i < TS_PID_PAGES; i++ )
+        free( p_list->pp_index[i] );
 }
 
 ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
@@ -69,19 +71,26 @@ ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
         case 0x1FFF:
             return &p_list->dummy;
         default:
-            if( p_list->i_last_pid == i_pid )
-                return p_list->p_last;
         break;
     }
 
-    for( int i=0; i < p_list->i_all; i++ )
+    assert( i_pid < TS_PID_COUNT );
+    ts_pid_t **pp_page = p_list->pp_index[i_pid >> TS_PID_PAGE_BITS];
+    if( likely(pp_page) )
     {
-        if( p_list->pp_all[i]->i_pid == i_pid )
+        ts_pid_t *p_pid = pp_page[i_pid & (TS_PID_PAGE_SIZE - 1)];
+        if( likely(p_pid) )
+            return p_pid;
+    }
+    else
+    {
+        pp_page = calloc( TS_PID_PAGE_SIZE, sizeof(ts_pid_t *) );
+        if( !pp_page )
         {
-            p_list->p_last = p_list->pp_all[i];
-            p_list->i_last_pid = i_pid;
-            return p_list->p_last;
+            abort();
+            //return NULL;
         }
+        p_list->pp_index[i_pid >> TS_PID_PAGE_BITS] = pp_page;
     }
 
     if( p_list->i_all >= p_list->i_all_alloc )
@@ -106,9 +115,7 @@ ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
 
     p_pid->i_pid = i_pid;
     p_list->pp_all[p_list->i_all++] = p_pid;
-
-    p_list->p_last = p_pid;
-    p_list->i_last_pid = i_pid;
+    pp_page[i_pid & (TS_PID_PAGE_SIZE - 1)] = p_pid;
 
     return p_pid;
 }
@@ -76,6 +76,12 @@ struct ts_pid_t
 
 };
 
+#define TS_PID_COUNT 8192
+/* two levels lookup table: pages of PID pointers allocated on use */
+#define TS_PID_PAGE_BITS 7
+#define TS_PID_PAGE_SIZE (1 << TS_PID_PAGE_BITS)
+#define TS_PID_PAGES (TS_PID_COUNT >> TS_PID_PAGE_BITS)
+
 struct ts_pid_list_t
 {
     ts_pid_t   pat;
@@ -85,10 +91,8 @@ struct ts_pid_list_t
     ts_pid_t **pp_all;
     int        i_all;
     int        i_all_alloc;
-    /* last recently used */
-    uint16_t   i_last_pid;
-    ts_pid_t  *p_last;
-
+    /* index of pp_all entries by pid */
+    ts_pid_t **pp_index[TS_PID_PAGES];
 };
 
 /* opacified pid list */
@@ -42,6 +42,7 @@
 #include <vlc_bits.h>
 #include "xiph.h"
 #include "xiph_metadata.h"
+#include "index_cache.h"
 #include "ogg.h"
 #include "oggseek.h"
 #include "opus.h"
@@ -52,6 +53,12 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define INDEX_CACHE_LONGTEXT N_( \
+    "Save the positions of the pages found while playing and seeking to " \
+    "the user cache directory, so that seeking in the file does not need " \
+    "to search again the next time.")
+
 vlc_module_begin ()
     set_shortname ( "OGG" )
     set_description( N_("OGG demuxer" ) )
@@ -59,6 +66,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_capability( "demux", 50 )
     set_callbacks( Open, Close )
+    add_bool( "ogg-index-cache", true,
+              INDEX_CACHE_TEXT, INDEX_CACHE_LONGTEXT, true )
     add_shortcut( "ogg" )
 vlc_module_end ()
 
@@ -263,6 +272,9 @@ static void Close( vlc_object_t *p_this )
     /* Cleanup the bitstream parser */
     ogg_sync_clear( &p_sys->oy );
 
+    Oggseek_IndexCacheSave( p_demux );
+    free( p_sys->psz_index_cache );
+
     Ogg_EndOfStream( p_demux );
 
     if( p_sys->p_old_stream )
@@ -296,6 +308,9 @@ static int Demux( demux_t * p_demux )
         if ( p_sys->i_streams ) /* All finished */
         {
             msg_Dbg( p_demux, "end of a group of logical streams" );
+            /* Only the first group is cached */
+            Oggseek_IndexCacheSave( p_demux );
+            FREENULL( p_sys->psz_index_cache );
             /* We keep the ES to try reusing it in Ogg_BeginningOfStream
              * only 1 ES is supported (common case for ogg web radio) */
             if( p_sys->i_streams == 1 )
@@ -318,7 +333,10 @@ static int Demux( demux_t * p_demux )
             /* Find the real duration */
             stream_Control( p_demux->s, STREAM_CAN_SEEK, &b_canseek );
             if ( b_canseek )
+            {
                 Oggseek_ProbeEnd( p_demux );
+                Oggseek_IndexCacheLoad( p_demux );
+            }
         }
         else
         {
@@ -353,6 +371,7 @@ static int Demux( demux_t * p_demux )
          */
         if( Ogg_ReadPage( p_demux, &p_sys->current_page ) != VLC_SUCCESS )
             return VLC_DEMUXER_EOF; /* EOF */
+        Oggseek_IndexPage( p_demux, &p_sys->current_page );
         /* Test for End of Stream */
         if( ogg_page_eos( &p_sys->current_page ) )
         {
@@ -2159,8 +2178,8 @@ static int Ogg_BeginningOfStream( demux_t *p_demux )
 
         p_stream->p_es = NULL;
 
-        /* initialise kframe index */
-        p_stream->idx=NULL;
+        /* initialise page index */
+        p_stream->idx.i_runpos = -1;
 
         if ( p_stream->fmt.i_bitrate == 0  &&
              ( p_stream->fmt.i_cat == VIDEO_ES ||
@@ -2249,10 +2268,7 @@ static void Ogg_LogicalStreamDelete( demux_t *p_demux, logical_stream_t *p_strea
     es_format_Clean( &p_stream->fmt_old );
     es_format_Clean( &p_stream->fmt );
 
-    if ( p_stream->idx != NULL)
-    {
-        oggseek_index_entries_free( p_stream->idx );
-    }
+    oggseek_index_entries_free( &p_stream->idx );
 
     Ogg_FreeSkeleton( p_stream->p_skel );
     p_stream->p_skel = NULL;
@@ -3122,7 +3138,8 @@ static void Ogg_ReadSkeletonBones( demux_t *p_demux, ogg_packet *p_oggpacket )
         p_skel = malloc( sizeof( ogg_skeleton_t ) );
         if ( !p_skel ) return;
         TAB_INIT( p_skel->i_messages, p_skel->ppsz_messages );
-        p_skel->p_index = NULL;
+        p_skel->p_keypoints = NULL;
+        p_skel->i_keypoints = 0;
         p_target_stream->p_skel = p_skel;
     }
 
@@ -3164,10 +3181,15 @@ unsigned const char * Read7BitsVariableLE( unsigned const char *p_begin,
         if ( (*p_begin++ & 0x80) == 0x80 ) break; /* see prev */
     }
 
-    *pi_value = GetQWLE( pi_value );
     return p_begin;
 }
 
+/* Converts a skeleton time numerator */
+static mtime_t Ogg_SkeletonTime( uint64_t i_num, uint64_t i_den )
+{
+    return i_num / i_den * CLOCK_FREQ + i_num % i_den * CLOCK_FREQ / i_den;
+}
+
 static void Ogg_ReadSkeletonIndex( demux_t *p_demux, ogg_packet *p_oggpacket )
 {
     if ( p_demux->p_sys->skeleton.major < 4
@@ -3190,9 +3212,19 @@ static void Ogg_ReadSkeletonIndex( demux_t *p_demux, ogg_packet *p_oggpacket )
     msg_Dbg( p_demux, "%" PRIi64 " index data for %" PRIi32, i_keypoints, i_serialno );
     if ( !i_keypoints ) return;
 
-    p_stream->p_skel->i_indexstampden = GetQWLE( &p_oggpacket->packet[18] );
-    p_stream->p_skel->i_indexfirstnum = GetQWLE( &p_oggpacket->packet[24] );
-    p_stream->p_skel->i_indexlastnum = GetQWLE( &p_oggpacket->packet[32] );
+    const uint64_t i_den = GetQWLE( &p_oggpacket->packet[18] ); /* time denominator */
+    /* Each keypoint takes at least 2 bytes */
+    if ( i_den == 0 || i_den > INT64_MAX / CLOCK_FREQ ||
+         i_keypoints > (uint64_t)( p_oggpacket->bytes - 42 ) / 2 )
+    {
+        msg_Warn( p_demux, "Invalid Index: bad header" );
+        return;
+    }
+
+    ogg_skeleton_keypoint_t *p_keypoints =
+            malloc( i_keypoints * sizeof( *p_keypoints ) );
+    if ( !p_keypoints ) return;
+
     unsigned const char *p_fwdbyte = &p_oggpacket->packet[42];
     unsigned const char *p_boundary = p_oggpacket->packet + p_oggpacket->bytes;
     uint64_t i_offset = 0;
@@ -3205,22 +3237,25 @@ static void Ogg_ReadSkeletonIndex( demux_t *p_demux, ogg_packet *p_oggpacket )
         p_fwdbyte = Read7BitsVariableLE( p_fwdbyte, p_boundary, &i_val );
         i_offset += i_val;
         p_fwdbyte = Read7BitsVariableLE( p_fwdbyte, p_boundary, &i_val );
-        i_time += i_val * p_stream->p_skel->i_indexstampden;
+        i_time += i_val;
+        if ( i_offset > INT64_MAX || i_time > INT64_MAX ) break;
+        p_keypoints[i_keypoints_found].i_pos = i_offset;
+        p_keypoints[i_keypoints_found].i_time = Ogg_SkeletonTime( i_time, i_den );
         i_keypoints_found++;
     }
 
     if ( i_keypoints_found != i_keypoints )
     {
         msg_Warn( p_demux, "Invalid Index: missing entries" );
+        free( p_keypoints );
         return;
     }
 
-    p_stream->p_skel->p_index = malloc( p_oggpacket->bytes - 42 );
-    if ( !p_stream->p_skel->p_index ) return;
-    memcpy( p_stream->p_skel->p_index, &p_oggpacket->packet[42],
-            p_oggpacket->bytes - 42 );
-    p_stream->p_skel->i_index = i_keypoints_found;
-    p_stream->p_skel->i_index_size = p_oggpacket->bytes - 42;
+    free( p_stream->p_skel->p_keypoints );
+    p_stream->p_skel->p_keypoints = p_keypoints;
+    p_stream->p_skel->i_keypoints = i_keypoints_found;
+    p_stream->p_skel->i_index_last =
+            Ogg_SkeletonTime( GetQWLE( &p_oggpacket->packet[34] ), i_den );
 }
 
 static void Ogg_FreeSkeleton( ogg_skeleton_t *p_skel )
@@ -3229,7 +3264,7 @@ static void Ogg_FreeSkeleton( ogg_skeleton_t *p_skel )
     for ( int i=0; i< p_skel->i_messages; i++ )
         free( p_skel->ppsz_messages[i] );
     TAB_CLEAN( p_skel->i_messages, p_skel->ppsz_messages );
-    free( p_skel->p_index );
+    free( p_skel->p_keypoints );
     free( p_skel );
 }
 
@@ -3252,52 +3287,35 @@ static void Ogg_ApplySkeleton( logical_stream_t *p_stream )
     }
 }
 
-/* Return true if there's a skeleton exact match */
+/* Return true if the skeleton has the keyframe to start decoding i_time from.
+ * Otherwise, the bounds of the search are narrowed down if possible. */
 bool Ogg_GetBoundsUsingSkeletonIndex( logical_stream_t *p_stream, int64_t i_time,
                                       int64_t *pi_lower, int64_t *pi_upper )
 {
-    if ( !p_stream || !p_stream->p_skel || !p_stream->p_skel->p_index )
+    if ( !p_stream || !p_stream->p_skel || !p_stream->p_skel->p_keypoints )
         return false;
 
-    /* Validate range */
-    if ( i_time < p_stream->p_skel->i_indexfirstnum
-                * p_stream->p_skel->i_indexstampden ||
-         i_time > p_stream->p_skel->i_indexlastnum
-                * p_stream->p_skel->i_indexstampden ) return false;
-
-    /* Then Lookup its index */
-    unsigned const char *p_fwdbyte = p_stream->p_skel->p_index;
-    struct
-    {
-        int64_t i_pos;
-        int64_t i_time;
-    } current = { 0, 0 }, prev = { -1, -1 };
-
-    uint64_t i_keypoints_found = 0;
+    const ogg_skeleton_keypoint_t *p_keypoints = p_stream->p_skel->p_keypoints;
+    size_t i_min = 0, i_max = p_stream->p_skel->i_keypoints;
 
-    while( p_fwdbyte < p_fwdbyte + p_stream->p_skel->i_index_size
-           && i_keypoints_found < p_stream->p_skel->i_index )
+    /* first keypoint past i_time */
+    while ( i_min < i_max )
     {
-        uint64_t i_val;
-        p_fwdbyte = Read7BitsVariableLE( p_fwdbyte,
-                        p_fwdbyte + p_stream->p_skel->i_index_size, &i_val );
-        current.i_pos += i_val;
-        p_fwdbyte = Read7BitsVariableLE( p_fwdbyte,
-                        p_fwdbyte + p_stream->p_skel->i_index_size, &i_val );
-        current.i_time += i_val * p_stream->p_skel->i_indexstampden;
-        if ( current.i_pos < 0 || current.i_time < 0 ) break;
+        size_t i_mid = ( i_min + i_max ) / 2;
+        if ( p_keypoints[i_mid].i_time <= i_time )
+            i_min = i_mid + 1;
+        else
+            i_max = i_mid;
+    }
 
-        i_keypoints_found++;
+    if ( i_min < p_stream->p_skel->i_keypoints )
+        *pi_upper = p_keypoints[i_min].i_pos;
+    if ( i_min > 0 )
+        *pi_lower = p_keypoints[i_min - 1].i_pos;
 
-        if ( i_time <= current.i_time )
-        {
-            *pi_lower = prev.i_pos;
-            *pi_upper = current.i_pos;
-            return ( i_time == current.i_time );
-        }
-        prev = current;
-    }
-    return false;
+    /* past the last keypoint, the index only tells where to start searching */
+    return ( i_min < p_stream->p_skel->i_keypoints ||
+             i_time <= p_stream->p_skel->i_index_last );
 }
 
 static uint32_t dirac_uint( bs_t *p_bs )
@@ -49,6 +49,17 @@
 #define PACKET_IS_SYNCPOINT  0x08
 
 typedef struct oggseek_index_entry demux_index_entry_t;
+
+/* page index, sorted by position */
+typedef struct
+{
+    demux_index_entry_t *p_entries;
+    size_t i_entries;
+    size_t i_alloc;
+    int64_t i_runpos;   /* last page indexed while reading in sequence, or -1 */
+    bool b_dirty;       /* has entries that are not in the cache */
+} demux_index_t;
+
 typedef struct ogg_skeleton_t ogg_skeleton_t;
 
 typedef struct backup_queue
@@ -99,8 +110,8 @@ typedef struct logical_stream_s
     /* offset of first keyframe for theora; can be 0 or 1 depending on version number */
     int8_t i_keyframe_offset;
 
-    /* keyframe index for seeking, created as we discover keyframes */
-    demux_index_entry_t *idx;
+    /* page index for seeking, filled while demuxing and seeking */
+    demux_index_t idx;
 
     /* Skeleton data */
     ogg_skeleton_t *p_skel;
@@ -157,16 +168,19 @@ typedef struct logical_stream_s
 
 } logical_stream_t;
 
+typedef struct
+{
+    int64_t i_pos;              /* of the page where the keyframe starts */
+    mtime_t i_time;
+} ogg_skeleton_keypoint_t;
+
 struct ogg_skeleton_t
 {
     int            i_messages;
     char         **ppsz_messages;
-    unsigned char *p_index;
-    uint64_t       i_index;
-    uint64_t       i_index_size;
-    int64_t        i_indexstampden;/* time denominator */
-    int64_t        i_indexfirstnum;/* first sample time numerator */
-    int64_t        i_indexlastnum;
+    ogg_skeleton_keypoint_t *p_keypoints;
+    size_t         i_keypoints;
+    mtime_t        i_index_last;   /* end time of the indexed samples */
 };
 
 struct demux_sys_t
@@ -233,6 +247,12 @@ struct demux_sys_t
     /* Length, if available. */
     int64_t i_length;
 
+    /* end of the last page demuxed, to tell if pages are read in sequence */
+    int64_t i_index_nextpos;
+    /* index cache file, or NULL */
+    char *psz_index_cache;
+    uint8_t index_key[INDEX_CACHE_KEY_SIZE]; /* identity of the cached file */
+
 };
 
 
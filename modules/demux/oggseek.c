@@ -38,6 +38,7 @@
 
 #include <assert.h>
 
+#include "index_cache.h"
 #include "ogg.h"
 #include "oggseek.h"
 
@@ -67,115 +68,346 @@ typedef struct packetStartCoordinates
 * index entries
 *************************************************************/
 
-/* free all entries in index list */
+/* pages closer than this to the previous one indexed while
+   demuxing are not indexed */
+#define OGGSEEK_INDEX_INTERVAL CLOCK_FREQ
 
-void oggseek_index_entries_free ( demux_index_entry_t *idx )
+/* free all entries in index */
+
+void oggseek_index_entries_free ( demux_index_t *idx )
+{
+    free( idx->p_entries );
+    idx->p_entries = NULL;
+    idx->i_entries = idx->i_alloc = 0;
+    idx->i_runpos = -1;
+}
+
+/* returns the number of entries before i_pagepos */
+
+static size_t OggSeekIndexLookup( const demux_index_t *idx, int64_t i_pagepos )
 {
-    demux_index_entry_t *idx_next;
+    size_t i_min = 0, i_max = idx->i_entries;
 
-    while ( idx != NULL )
+    while ( i_min < i_max )
     {
-        idx_next = idx->p_next;
-        free( idx );
-        idx = idx_next;
+        size_t i_mid = ( i_min + i_max ) / 2;
+        if ( idx->p_entries[i_mid].i_pagepos < i_pagepos )
+            i_min = i_mid + 1;
+        else
+            i_max = i_mid;
     }
+    return i_min;
 }
 
+/* We insert into index, sorting by pagepos (as a page can match multiple
+   time stamps) */
+static demux_index_entry_t *OggSeekIndexAdd( logical_stream_t *p_stream,
+                                             int64_t i_pagepos,
+                                             int64_t i_granule,
+                                             int64_t i_timestamp )
+{
+    demux_index_t *idx = &p_stream->idx;
 
-/* internal function to create a new list member */
+    if ( i_pagepos < 1 || i_timestamp < 0 ) return NULL;
 
-static demux_index_entry_t *index_entry_new( void )
-{
-    demux_index_entry_t *idx = xmalloc( sizeof( demux_index_entry_t ) );
-    if ( !idx ) return NULL;
-    idx->p_next = idx->p_prev = NULL;
-    idx->i_pagepos_end = -1;
-    return idx;
+    size_t i = OggSeekIndexLookup( idx, i_pagepos );
+    if ( i < idx->i_entries && idx->p_entries[i].i_pagepos == i_pagepos )
+        return &idx->p_entries[i];
+
+    /* timestamps must grow with the position, or we can't look them up */
+    if ( ( i > 0 && idx->p_entries[i - 1].i_timestamp > i_timestamp ) ||
+         ( i < idx->i_entries && idx->p_entries[i].i_timestamp < i_timestamp ) )
+        return NULL;
+
+    if ( idx->i_entries == idx->i_alloc )
+    {
+        size_t i_alloc = __MAX( idx->i_alloc * 2, 256 );
+        demux_index_entry_t *p_realloc =
+                realloc( idx->p_entries, i_alloc * sizeof( *p_realloc ) );
+        if ( !p_realloc ) return NULL;
+        idx->p_entries = p_realloc;
+        idx->i_alloc = i_alloc;
+    }
+
+    demux_index_entry_t *p_entry = &idx->p_entries[i];
+    memmove( p_entry + 1, p_entry, ( idx->i_entries - i ) * sizeof( *p_entry ) );
+    idx->i_entries++;
+    idx->b_dirty = true;
+
+    p_entry->i_pagepos = i_pagepos;
+    p_entry->i_granule = i_granule;
+    p_entry->i_timestamp = i_timestamp;
+    /* if the pages up to the next entry were read, so were ours */
+    p_entry->b_contiguous = ( i + 1 < idx->i_entries && p_entry[1].b_contiguous );
+
+    return p_entry;
 }
 
-/* We insert into index, sorting by pagepos (as a page can match multiple
-   time stamps) */
-const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *p_stream,
-                                             int64_t i_timestamp,
-                                             int64_t i_pagepos )
+/* Narrows the search bounds for i_timestamp. Returns the entry to start
+   reading from if all the pages around i_timestamp were indexed */
+static const demux_index_entry_t *OggSeekIndexFind ( logical_stream_t *p_stream,
+                                                     int64_t i_timestamp,
+                                                     int64_t *pi_pos_lower,
+                                                     int64_t *pi_pos_upper )
 {
-    demux_index_entry_t *idx;
-    demux_index_entry_t *last_idx = NULL;
+    const demux_index_t *idx = &p_stream->idx;
+    size_t i_min = 0, i_max = idx->i_entries;
 
-    if ( p_stream == NULL ) return NULL;
+    /* first entry past i_timestamp */
+    while ( i_min < i_max )
+    {
+        size_t i_mid = ( i_min + i_max ) / 2;
+        if ( idx->p_entries[i_mid].i_timestamp <= i_timestamp )
+            i_min = i_mid + 1;
+        else
+            i_max = i_mid;
+    }
+
+    if ( i_min > 0 )
+        *pi_pos_lower = __MAX( *pi_pos_lower, idx->p_entries[i_min - 1].i_pagepos );
+
+    if ( i_min < idx->i_entries )
+    {
+        if ( *pi_pos_upper < 0 || *pi_pos_upper > idx->p_entries[i_min].i_pagepos )
+            *pi_pos_upper = idx->p_entries[i_min].i_pagepos;
+        if ( i_min > 0 && idx->p_entries[i_min].b_contiguous )
+            return &idx->p_entries[i_min - 1];
+    }
+
+    return NULL;
+}
 
-    idx = p_stream->idx;
+/* Indexes the page the demuxer just read. As long as pages are read in
+   sequence, the entries cover all the data in between, so that seeking
+   back into what was already played needs no search at all */
+void Oggseek_IndexPage( demux_t *p_demux, const ogg_page *p_page )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    logical_stream_t *p_stream = NULL;
 
-    if ( i_timestamp < 1 || i_pagepos < 1 ) return NULL;
+    const int64_t i_pagepos = stream_Tell( p_demux->s )
+                            - ( p_sys->oy.fill - p_sys->oy.returned )
+                            - p_page->header_len - p_page->body_len;
 
-    if ( idx == NULL )
+    if ( i_pagepos != p_sys->i_index_nextpos )
     {
-        demux_index_entry_t *ie = index_entry_new();
-        if ( !ie ) return NULL;
-        ie->i_value = i_timestamp;
-        ie->i_pagepos = i_pagepos;
-        p_stream->idx = ie;
-        return ie;
+        /* we seeked */
+        for ( int i = 0; i < p_sys->i_streams; i++ )
+            p_sys->pp_stream[i]->idx.i_runpos = -1;
     }
+    p_sys->i_index_nextpos = i_pagepos + p_page->header_len + p_page->body_len;
+
+    int64_t i_granule = ogg_page_granulepos( p_page );
+    if ( i_granule <= 0 ) return;
 
-    while ( idx != NULL )
+    for ( int i = 0; i < p_sys->i_streams; i++ )
     {
-        if ( idx->i_pagepos > i_pagepos ) break;
-        last_idx = idx;
-        idx = idx->p_next;
+        if ( p_sys->pp_stream[i]->i_serial_no == ogg_page_serialno( p_page ) )
+        {
+            p_stream = p_sys->pp_stream[i];
+            break;
+        }
     }
+    if ( !p_stream || p_stream == p_sys->p_skelstream ) return;
+
+    demux_index_t *idx = &p_stream->idx;
+    int64_t i_timestamp = Oggseek_GranuleToAbsTimestamp( p_stream, i_granule, false );
+    size_t i_last = 0;
 
-    /* new entry; insert after last_idx */
-    idx = index_entry_new();
-    if ( !idx ) return NULL;
-    if ( last_idx != NULL )
+    if ( idx->i_runpos >= 0 )
     {
-        idx->p_next = last_idx->p_next;
-        last_idx->p_next = idx;
-        idx->p_prev = last_idx;
+        i_last = OggSeekIndexLookup( idx, idx->i_runpos );
+        assert( i_last < idx->i_entries );
+        if ( i_timestamp < idx->p_entries[i_last].i_timestamp + OGGSEEK_INDEX_INTERVAL )
+            return;
     }
-    else
+
+    demux_index_entry_t *p_entry = OggSeekIndexAdd( p_stream, i_pagepos,
+                                                    i_granule, i_timestamp );
+    if ( !p_entry )
     {
-        idx->p_next = p_stream->idx;
-        p_stream->idx = idx;
+        idx->i_runpos = -1;
+        return;
     }
 
-    if ( idx->p_next != NULL )
+    if ( idx->i_runpos >= 0 )
     {
-        idx->p_next->p_prev = idx;
+        /* we read all the pages since the previous entry of the run */
+        for ( demux_index_entry_t *p = &idx->p_entries[i_last + 1]; p <= p_entry; p++ )
+        {
+            if ( !p->b_contiguous )
+            {
+                p->b_contiguous = true;
+                idx->b_dirty = true;
+            }
+        }
     }
+    idx->i_runpos = i_pagepos;
+}
 
-    idx->i_value = i_timestamp;
-    idx->i_pagepos = i_pagepos;
+/************************************************************
+* index cache
+*************************************************************
+* The indexes of the first group of logical streams are saved in the user
+* cache directory, in a file named after the URL and identity key of the
+* file.
+*************************************************************/
 
-    return idx;
+#define OGGSEEK_INDEX_CACHE_MAGIC   "VLCOGIDX"
+#define OGGSEEK_INDEX_CACHE_VERSION 2
+#define OGGSEEK_INDEX_CACHE_ENTRY   17
+
+static char *OggSeekIndexCacheGetPath( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if ( !var_InheritBool( p_demux, "ogg-index-cache" ) ||
+         index_cache_GetKey( p_demux->s, p_sys->index_key ) )
+        return NULL;
+
+    return index_cache_GetPath( p_demux->s, "ogg-index", p_sys->index_key );
 }
 
-static bool OggSeekIndexFind ( logical_stream_t *p_stream, int64_t i_timestamp,
-                               int64_t *pi_pos_lower, int64_t *pi_pos_upper )
+/* Loads the indexes of the logical streams from the cache */
+void Oggseek_IndexCacheLoad( demux_t *p_demux )
 {
-    demux_index_entry_t *idx = p_stream->idx;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    free( p_sys->psz_index_cache );
+    p_sys->psz_index_cache = OggSeekIndexCacheGetPath( p_demux );
+    if ( !p_sys->psz_index_cache )
+        return;
+
+    FILE *f = index_cache_Open( VLC_OBJECT(p_demux), p_sys->psz_index_cache,
+                                OGGSEEK_INDEX_CACHE_MAGIC,
+                                OGGSEEK_INDEX_CACHE_VERSION, p_sys->index_key );
+    if ( !f )
+        return;
+
+    const int64_t i_size = stream_Size( p_demux->s );
+    uint8_t p_buf[OGGSEEK_INDEX_CACHE_ENTRY];
 
-    while ( idx != NULL )
+    if ( fread( p_buf, 4, 1, f ) != 1 )
+        goto error;
+
+    for ( uint32_t i_streams = GetDWLE( &p_buf[0] ); i_streams > 0; i_streams-- )
     {
-        if ( idx->i_value <= i_timestamp )
+        logical_stream_t *p_stream = NULL;
+
+        if ( fread( p_buf, 12, 1, f ) != 1 )
+            goto error;
+
+        for ( int i = 0; i < p_sys->i_streams; i++ )
         {
-            if ( !idx->p_next ) /* found on last index */
-            {
-                *pi_pos_lower = idx->i_pagepos;
-                return true;
-            }
-            if ( idx->p_next->i_value > i_timestamp )
+            if ( (uint32_t)p_sys->pp_stream[i]->i_serial_no == GetDWLE( &p_buf[0] ) &&
+                 p_sys->pp_stream[i]->fmt.i_codec == GetDWLE( &p_buf[4] ) )
             {
-                *pi_pos_lower = idx->i_pagepos;
-                *pi_pos_upper = idx->p_next->i_pagepos;
-                return true;
+                p_stream = p_sys->pp_stream[i];
+                break;
             }
         }
-        idx = idx->p_next;
+
+        for ( uint32_t i_count = GetDWLE( &p_buf[8] ); i_count > 0; i_count-- )
+        {
+            if ( fread( p_buf, OGGSEEK_INDEX_CACHE_ENTRY, 1, f ) != 1 )
+                goto error;
+            if ( !p_stream )
+                continue;
+
+            int64_t i_pagepos = GetQWLE( &p_buf[0] );
+            int64_t i_granule = GetQWLE( &p_buf[8] );
+            demux_index_t *idx = &p_stream->idx;
+
+            if ( i_pagepos >= i_size || i_granule <= 0 || ( idx->i_entries &&
+                 idx->p_entries[idx->i_entries - 1].i_pagepos >= i_pagepos ) )
+                goto error;
+
+            demux_index_entry_t *p_entry = OggSeekIndexAdd( p_stream, i_pagepos, i_granule,
+                    Oggseek_GranuleToAbsTimestamp( p_stream, i_granule, false ) );
+            if ( !p_entry )
+                goto error;
+            p_entry->b_contiguous = p_buf[16] != 0;
+        }
+
+        if ( p_stream )
+        {
+            p_stream->idx.b_dirty = false;
+            msg_Dbg( p_demux, "stream %d loaded %zu cached index entries",
+                     p_stream->i_serial_no, p_stream->idx.i_entries );
+        }
     }
+    fclose( f );
+    return;
+
+error:
+    msg_Warn( p_demux, "ignoring invalid index cache %s",
+              p_sys->psz_index_cache );
+    fclose( f );
+    for ( int i = 0; i < p_sys->i_streams; i++ )
+        oggseek_index_entries_free( &p_sys->pp_stream[i]->idx );
+}
 
-    return false;
+/* Saves the indexes of the logical streams, if they changed */
+void Oggseek_IndexCacheSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const char *psz_path = p_sys->psz_index_cache;
+    uint32_t i_streams = 0;
+    bool b_dirty = false;
+
+    if ( !psz_path )
+        return;
+
+    for ( int i = 0; i < p_sys->i_streams; i++ )
+    {
+        if ( p_sys->pp_stream[i]->idx.i_entries )
+            i_streams++;
+        b_dirty |= p_sys->pp_stream[i]->idx.b_dirty;
+    }
+    if ( !b_dirty )
+        return;
+
+    FILE *f = index_cache_Create( VLC_OBJECT(p_demux), psz_path,
+                                  OGGSEEK_INDEX_CACHE_MAGIC,
+                                  OGGSEEK_INDEX_CACHE_VERSION,
+                                  p_sys->index_key );
+    if ( !f )
+        return;
+
+    uint8_t p_buf[OGGSEEK_INDEX_CACHE_ENTRY];
+    bool b_error = false;
+
+    SetDWLE( &p_buf[0], i_streams );
+    b_error |= fwrite( p_buf, 4, 1, f ) != 1;
+
+    for ( int i = 0; i < p_sys->i_streams && !b_error; i++ )
+    {
+        const logical_stream_t *p_stream = p_sys->pp_stream[i];
+        if ( !p_stream->idx.i_entries )
+            continue;
+
+        SetDWLE( &p_buf[0], p_stream->i_serial_no );
+        SetDWLE( &p_buf[4], p_stream->fmt.i_codec );
+        SetDWLE( &p_buf[8], p_stream->idx.i_entries );
+        b_error |= fwrite( p_buf, 12, 1, f ) != 1;
+
+        for ( size_t j = 0; j < p_stream->idx.i_entries && !b_error; j++ )
+        {
+            const demux_index_entry_t *p_entry = &p_stream->idx.p_entries[j];
+
+            SetQWLE( &p_buf[0], p_entry->i_pagepos );
+            SetQWLE( &p_buf[8], p_entry->i_granule );
+            p_buf[16] = p_entry->b_contiguous;
+            b_error |= fwrite( p_buf, OGGSEEK_INDEX_CACHE_ENTRY, 1, f ) != 1;
+        }
+    }
+
+    if ( index_cache_Commit( VLC_OBJECT(p_demux), f, psz_path, b_error )
+         == VLC_SUCCESS )
+    {
+        for ( int i = 0; i < p_sys->i_streams; i++ )
+            p_sys->pp_stream[i]->idx.b_dirty = false;
+    }
 }
 
 /*********************************************************************
@@ -750,6 +982,41 @@ int64_t Oggseek_GranuleToAbsTimestamp( logical_stream_t *p_stream,
     return i_timestamp;
 }
 
+/* returns the pos of the keyframe the page at i_pos depends on */
+static int64_t OggSeekToKeyframe( demux_t *p_demux, logical_stream_t *p_stream,
+                                  int64_t i_pos, int64_t i_granule )
+{
+    if ( p_stream->b_oggds )
+    {
+        int64_t a = OggBackwardSeekToFrame( p_demux,
+                __MAX ( i_pos - OGGSEEK_BYTES_TO_READ, p_stream->i_data_start ),
+                i_pos,
+                p_stream, i_granule /* unused */ );
+        return a;
+    }
+    /* If not each packet is usable as keyframe, query the codec for keyframe */
+    else if ( Ogg_GetKeyframeGranule( p_stream, i_granule ) != i_granule )
+    {
+        int64_t i_keyframegranule = Ogg_GetKeyframeGranule( p_stream, i_granule );
+
+        OggDebug( msg_Dbg( p_demux, "Need to reseek to keyframe (%"PRId64") granule (%"PRId64"!=%"PRId64") to t=%"PRId64,
+                           i_keyframegranule >> p_stream->i_granule_shift,
+                           i_granule,
+                           i_pos,
+                           Oggseek_GranuleToAbsTimestamp( p_stream, i_keyframegranule, false ) ) );
+
+        OggDebug( msg_Dbg( p_demux, "Seeking back to %"PRId64, __MAX ( i_pos - OGGSEEK_BYTES_TO_READ, p_stream->i_data_start ) ) );
+
+        int64_t a = OggBackwardSeekToFrame( p_demux,
+            __MAX ( i_pos - OGGSEEK_BYTES_TO_READ, p_stream->i_data_start ),
+            stream_Size( p_demux->s ), p_stream, i_keyframegranule );
+        return a;
+    }
+
+    return i_pos;
+}
+
+
 /* returns pos */
 static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stream,
             int64_t i_targettime, int64_t i_pos_lower, int64_t i_pos_upper)
@@ -819,6 +1086,8 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
         if ( current.i_pos != -1 && current.i_granule != -1 )
         {
             /* found a page */
+            OggSeekIndexAdd( p_stream, current.i_pos, current.i_granule,
+                             current.i_timestamp );
 
             if ( current.i_timestamp <= i_targettime )
             {
@@ -860,34 +1129,7 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
             bestlower = lowestupper;
     }
 
-    if ( p_stream->b_oggds )
-    {
-        int64_t a = OggBackwardSeekToFrame( p_demux,
-                __MAX ( bestlower.i_pos - OGGSEEK_BYTES_TO_READ, p_stream->i_data_start ),
-                bestlower.i_pos,
-                p_stream, bestlower.i_granule /* unused */ );
-        return a;
-    }
-    /* If not each packet is usable as keyframe, query the codec for keyframe */
-    else if ( Ogg_GetKeyframeGranule( p_stream, bestlower.i_granule ) != bestlower.i_granule )
-    {
-        int64_t i_keyframegranule = Ogg_GetKeyframeGranule( p_stream, bestlower.i_granule );
-
-        OggDebug( msg_Dbg( p_demux, "Need to reseek to keyframe (%"PRId64") granule (%"PRId64"!=%"PRId64") to t=%"PRId64,
-                           i_keyframegranule >> p_stream->i_granule_shift,
-                           bestlower.i_granule,
-                           i_pos_upper,
-                           Oggseek_GranuleToAbsTimestamp( p_stream, i_keyframegranule, false ) ) );
-
-        OggDebug( msg_Dbg( p_demux, "Seeking back to %"PRId64, __MAX ( bestlower.i_pos - OGGSEEK_BYTES_TO_READ, p_stream->i_data_start ) ) );
-
-        int64_t a = OggBackwardSeekToFrame( p_demux,
-            __MAX ( bestlower.i_pos - OGGSEEK_BYTES_TO_READ, p_stream->i_data_start ),
-            stream_Size( p_demux->s ), p_stream, i_keyframegranule );
-        return a;
-    }
-
-    return bestlower.i_pos;
+    return OggSeekToKeyframe( p_demux, p_stream, bestlower.i_pos, bestlower.i_granule );
 }
 
 
@@ -902,19 +1144,27 @@ int Oggseek_BlindSeektoAbsoluteTime( demux_t *p_demux, logical_stream_t *p_strea
     int64_t i_lowerpos = -1;
     int64_t i_upperpos = -1;
     bool b_found = false;
+    const demux_index_entry_t *p_entry;
 
     /* Search in skeleton */
-    Ogg_GetBoundsUsingSkeletonIndex( p_stream, i_time, &i_lowerpos, &i_upperpos );
-    if ( i_lowerpos != -1 ) b_found = true;
+    if ( Ogg_GetBoundsUsingSkeletonIndex( p_stream, i_time, &i_lowerpos, &i_upperpos ) )
+    {
+        if ( i_lowerpos == -1 ) i_lowerpos = p_stream->i_data_start;
+        b_found = true;
+    }
 
     /* And also search in our own index */
-    if ( !b_found && OggSeekIndexFind( p_stream, i_time, &i_lowerpos, &i_upperpos ) )
+    if ( !b_found &&
+         ( p_entry = OggSeekIndexFind( p_stream, i_time, &i_lowerpos, &i_upperpos ) ) )
     {
-        b_found = true;
+        i_lowerpos = OggSeekToKeyframe( p_demux, p_stream,
+                                        p_entry->i_pagepos, p_entry->i_granule );
+        b_found = ( i_lowerpos != -1 );
     }
 
     /* Or try to be smart with audio fixed bitrate streams */
-    if ( !b_found && p_stream->fmt.i_cat == AUDIO_ES && p_sys->i_streams == 1
+    if ( !b_found && i_lowerpos == -1 && i_upperpos == -1 &&
+         p_stream->fmt.i_cat == AUDIO_ES && p_sys->i_streams == 1
          && p_sys->i_bitrate && Ogg_GetKeyframeGranule( p_stream, 0xFF00FF00 ) == 0xFF00FF00 )
     {
         /* But only if there's no keyframe/preload requirements */
@@ -927,10 +1177,14 @@ int Oggseek_BlindSeektoAbsoluteTime( demux_t *p_demux, logical_stream_t *p_strea
     if ( !b_found && b_fastseek )
     {
         i_lowerpos = OggBisectSearchByTime( p_demux, p_stream, i_time,
-                                            p_stream->i_data_start, p_sys->i_total_length );
+                                            i_lowerpos, i_upperpos );
         b_found = ( i_lowerpos != -1 );
     }
 
+    /* or start from the closest known page */
+    if ( !b_found && i_lowerpos != -1 )
+        b_found = true;
+
     if ( !b_found ) return -1;
 
     if ( i_lowerpos < p_stream->i_data_start || i_upperpos > p_sys->i_total_length )
@@ -991,10 +1245,12 @@ int Oggseek_SeektoAbsolutetime( demux_t *p_demux, logical_stream_t *p_stream,
     OggDebug( msg_Dbg( p_demux, "=================== Seeking To Absolute Time %"PRId64, i_time ) );
     int64_t i_offset_lower = -1;
     int64_t i_offset_upper = -1;
+    int64_t i_pagepos;
+    const demux_index_entry_t *p_entry;
 
     if ( Ogg_GetBoundsUsingSkeletonIndex( p_stream, i_time, &i_offset_lower, &i_offset_upper ) )
     {
-        /* Exact match */
+        /* Keyframe found */
         OggDebug( msg_Dbg( p_demux, "Found keyframe at %"PRId64" using skeleton index", i_offset_lower ) );
         if ( i_offset_lower == -1 ) i_offset_lower = p_stream->i_data_start;
         p_sys->i_input_position = i_offset_lower;
@@ -1004,15 +1260,23 @@ int Oggseek_SeektoAbsolutetime( demux_t *p_demux, logical_stream_t *p_stream,
     }
     OggDebug( msg_Dbg( p_demux, "Search bounds set to %"PRId64" %"PRId64" using skeleton index", i_offset_lower, i_offset_upper ) );
 
-    OggNoDebug(
-        OggSeekIndexFind( p_stream, i_time, &i_offset_lower, &i_offset_upper )
-    );
+    p_entry = OggSeekIndexFind( p_stream, i_time, &i_offset_lower, &i_offset_upper );
+    if ( p_entry )
+    {
+        OggDebug( msg_Dbg( p_demux, "Found page at %"PRId64" using our index", p_entry->i_pagepos ) );
+        i_pagepos = OggSeekToKeyframe( p_demux, p_stream,
+                                       p_entry->i_pagepos, p_entry->i_granule );
+    }
+    else
+    {
+        i_offset_lower = __MAX( i_offset_lower, p_stream->i_data_start );
+        if ( i_offset_upper < 0 || i_offset_upper > p_sys->i_total_length )
+            i_offset_upper = p_sys->i_total_length;
 
-    i_offset_lower = __MAX( i_offset_lower, p_stream->i_data_start );
-    i_offset_upper = __MIN( i_offset_upper, p_sys->i_total_length );
+        i_pagepos = OggBisectSearchByTime( p_demux, p_stream, i_time,
+                                           i_offset_lower, i_offset_upper );
+    }
 
-    int64_t i_pagepos = OggBisectSearchByTime( p_demux, p_stream, i_time,
-                                       i_offset_lower, i_offset_upper);
     if ( i_pagepos >= 0 )
     {
         /* be sure to clear any state or read+pagein() will fail on same # */
@@ -1020,11 +1284,6 @@ int Oggseek_SeektoAbsolutetime( demux_t *p_demux, logical_stream_t *p_stream,
         p_sys->i_input_position = i_pagepos;
         seek_byte( p_demux, p_sys->i_input_position );
     }
-    /* Insert keyframe position into index */
-    OggNoDebug(
-    if ( i_pagepos >= p_stream->i_data_start )
-        OggSeek_IndexAdd( p_stream, i_time, i_pagepos )
-    );
 
     OggDebug( msg_Dbg( p_demux, "=================== Seeked To %"PRId64" time %"PRId64, i_pagepos, i_time ) );
     return i_pagepos;
@@ -31,22 +31,23 @@
 #define OGGSEEK_BYTES_TO_READ 8500
 
 /* index entries are structured as follows:
- *   - for theora, highest granulepos -> pagepos (bytes) where keyframe begins
- *  - for dirac, kframe (sync point) -> pagepos of sequence start (?)
+ *   - i_pagepos is the start of the page of granule i_granule itself. A
+ *     packet continued onto that page began on an earlier one, so reading
+ *     from there yields the packets starting on it and after
+ *   - for theora, dirac and oggds the keyframe still needs to be looked up
+ *     from there, as we do after bisecting
  */
 
 /* this is typedefed to demux_index_entry_t in ogg.h */
 struct oggseek_index_entry
 {
-    demux_index_entry_t *p_next;
-    demux_index_entry_t *p_prev;
-
-    /* value is highest granulepos for theora, sync frame for dirac */
-    int64_t i_value;
     int64_t i_pagepos;
+    int64_t i_granule;
+    int64_t i_timestamp;    /* of i_granule */
 
-    /* not used for theora because the granulepos tells us this */
-    int64_t i_pagepos_end;
+    /* all the pages since the previous entry were read in sequence, so
+     * that there is no page of the stream with a timestamp in between */
+    bool    b_contiguous;
 };
 
 int64_t Ogg_GetKeyframeGranule ( logical_stream_t *p_stream, int64_t i_granule );
@@ -57,9 +58,12 @@ int64_t Oggseek_GranuleToAbsTimestamp ( logical_stream_t *p_stream, int64_t i_gr
 int     Oggseek_BlindSeektoAbsoluteTime ( demux_t *, logical_stream_t *, int64_t, bool );
 int     Oggseek_BlindSeektoPosition ( demux_t *, logical_stream_t *, double f, bool );
 int     Oggseek_SeektoAbsolutetime ( demux_t *, logical_stream_t *, int64_t i_granulepos );
-const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *, int64_t, int64_t );
 void    Oggseek_ProbeEnd( demux_t * );
 
-void oggseek_index_entries_free ( demux_index_entry_t * );
+void    Oggseek_IndexPage ( demux_t *, const ogg_page * );
+void    Oggseek_IndexCacheLoad ( demux_t * );
+void    Oggseek_IndexCacheSave ( demux_t * );
+
+void oggseek_index_entries_free ( demux_index_t * );
 
 int64_t oggseek_read_page ( demux_t * );
@@ -52,6 +52,17 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define MOOVRESERVE_TEXT N_("Space reserved for the moov header (KiB)")
+#define MOOVRESERVE_LONGTEXT N_(\
+    "Space reserved at the start of \"Fast Start\" files for the moov " \
+    "header, which grows with the number of samples. When the header fits " \
+    "in, it is written there and the media data does not need to be moved " \
+    "when finishing the file. The default fits about a quarter of an hour " \
+    "of audio and video. 0 reserves nothing.")
+
+/* Media data is moved by chunks of that size to fit the moov header */
+#define FASTSTART_MOVE_SIZE (1 << 20)
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static int  OpenFrag   (vlc_object_t *);
@@ -68,6 +79,8 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "faststart", true,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true)
+    add_integer_with_range(SOUT_CFG_PREFIX "moov-reserve", 1024, 0, 65536,
+                           MOOVRESERVE_TEXT, MOOVRESERVE_LONGTEXT, true)
     set_capability("sout mux", 5)
     add_shortcut("mp4", "mov", "3gp")
     set_callbacks(Open, Close)
@@ -87,7 +100,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "moov-reserve", NULL
 };
 
 static int Control(sout_mux_t *, int, va_list);
@@ -159,6 +172,8 @@ struct sout_mux_sys_t
     bool b_64_ext;
     bool b_fast_start;
 
+    uint64_t i_free_pos; /* space reserved for the moov */
+    uint64_t i_free_size;
     uint64_t i_mdat_pos;
     uint64_t i_pos;
     mtime_t  i_read_duration;
@@ -205,6 +220,7 @@ static int Open(vlc_object_t *p_this)
     p_sys->i_nb_streams = 0;
     p_sys->pp_streams   = NULL;
     p_sys->i_mdat_pos   = 0;
+    p_sys->i_free_size  = 0;
     p_sys->b_mov        = p_mux->psz_mux && !strcmp(p_mux->psz_mux, "mov");
     p_sys->b_3gp        = p_mux->psz_mux && !strcmp(p_mux->psz_mux, "3gp");
     p_sys->i_read_duration   = 0;
@@ -238,6 +254,25 @@ static int Open(vlc_object_t *p_this)
      * Quicktime actually doesn't like the 64 bits extensions !!! */
     p_sys->b_64_ext = false;
 
+    /* Reserve space for the moov header, in a free box */
+    p_sys->i_free_pos = p_sys->i_pos;
+    if (var_GetBool(p_this, SOUT_CFG_PREFIX "faststart"))
+        p_sys->i_free_size = var_GetInteger(p_this, SOUT_CFG_PREFIX "moov-reserve") * 1024;
+    if (p_sys->i_free_size > 0) {
+        block_t *p_free = block_Alloc(p_sys->i_free_size);
+        if (!p_free) {
+            free(p_sys);
+            return VLC_ENOMEM;
+        }
+        memset(p_free->p_buffer, 0, p_free->i_buffer);
+        SetDWBE(p_free->p_buffer, p_sys->i_free_size);
+        memcpy(&p_free->p_buffer[4], "free", 4);
+
+        p_sys->i_pos += p_sys->i_free_size;
+        p_sys->i_mdat_pos = p_sys->i_pos;
+        sout_AccessOutWrite(p_mux->p_access, p_free);
+    }
+
     /* Now add mdat header */
     box = box_new("mdat");
     if(!box)
@@ -255,6 +290,13 @@ static int Open(vlc_object_t *p_this)
     return VLC_SUCCESS;
 }
 
+/* The buffer the media data is moved through is reused, and freed once
+ * all the data has been moved */
+static void FastStartBufferRelease(block_t *p_block)
+{
+    VLC_UNUSED(p_block);
+}
+
 /*****************************************************************************
  * Close:
  *****************************************************************************/
@@ -292,46 +334,74 @@ static void Close(vlc_object_t *p_this)
     /* Check we need to create "fast start" files */
     p_sys->b_fast_start = var_GetBool(p_this, SOUT_CFG_PREFIX "faststart");
     while (p_sys->b_fast_start && moov && moov->b) {
-        /* Move data to the end of the file so we can fit the moov header
-         * at the start */
+        /* Use the reserved space for the moov header at the start, and move
+         * data to the end of the file only if it doesn't fit in */
         int64_t i_size = p_sys->i_pos - p_sys->i_mdat_pos;
-        int i_moov_size = moov->b->i_buffer;
+        int64_t i_shift = (int64_t)moov->b->i_buffer - p_sys->i_free_size;
+        if (i_shift < 0 && i_shift > -8)
+            i_shift += 8; /* leftover too small for a free box */
+        if (i_shift < 0)
+            i_shift = 0;
+
+        if (i_shift > 0 && p_sys->i_free_size > 0)
+            msg_Warn(p_this, "moov header exceeds the reserved space by %"PRId64
+                     " bytes, moving data", i_shift);
+
+        /* The data is moved through a single buffer, allocated before
+         * anything is moved so that failing cannot leave it half moved */
+        uint8_t *p_move = NULL;
+        if (i_shift > 0 && i_size > 0) {
+            p_move = malloc(__MIN(FASTSTART_MOVE_SIZE, i_size));
+            if (!p_move)
+                p_sys->b_fast_start = false;
+        }
+
+        while (p_sys->b_fast_start && i_shift > 0 && i_size > 0) {
+            int64_t i_chunk = __MIN(FASTSTART_MOVE_SIZE, i_size);
+            block_t buf;
+            block_Init(&buf, p_move, i_chunk);
+            buf.pf_release = FastStartBufferRelease;
 
-        while (i_size > 0) {
-            int64_t i_chunk = __MIN(32768, i_size);
-            block_t *p_buf = block_Alloc(i_chunk);
             sout_AccessOutSeek(p_mux->p_access,
                                 p_sys->i_mdat_pos + i_size - i_chunk);
-            if (sout_AccessOutRead(p_mux->p_access, p_buf) < i_chunk) {
+            if (sout_AccessOutRead(p_mux->p_access, &buf) < i_chunk) {
                 msg_Warn(p_this, "read() not supported by access output, "
                           "won't create a fast start file");
                 p_sys->b_fast_start = false;
-                block_Release(p_buf);
                 break;
             }
             sout_AccessOutSeek(p_mux->p_access, p_sys->i_mdat_pos + i_size +
-                                i_moov_size - i_chunk);
-            sout_AccessOutWrite(p_mux->p_access, p_buf);
+                                i_shift - i_chunk);
+            sout_AccessOutWrite(p_mux->p_access, &buf);
             i_size -= i_chunk;
         }
+        free(p_move);
 
         if (!p_sys->b_fast_start)
             break;
 
         /* Update pos pointers */
-        i_moov_pos = p_sys->i_mdat_pos;
-        p_sys->i_mdat_pos += moov->b->i_buffer;
+        i_moov_pos = p_sys->i_free_pos;
+        p_sys->i_mdat_pos += i_shift;
+
+        /* Keep the remaining reserved space as a free box, following
+         * the moov header */
+        const uint64_t i_free = p_sys->i_free_size + i_shift - moov->b->i_buffer;
+        if (i_free > 0) {
+            bo_add_32be  (moov, i_free);
+            bo_add_fourcc(moov, "free");
+        }
 
         /* Fix-up samples to chunks table in MOOV header */
-        for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++) {
+        for (unsigned int i_trak = 0; i_shift > 0 && i_trak < p_sys->i_nb_streams; i_trak++) {
             mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
             unsigned i_written = 0;
             for (unsigned i = 0; i < p_stream->mux.i_entry_count; ) {
                 mp4mux_entry_t *entry = p_stream->mux.entry;
                 if (b_stco64)
-                    bo_set_64be(moov, p_stream->mux.i_stco_pos + i_written++ * 8, entry[i].i_pos + p_sys->i_mdat_pos - i_moov_pos);
+                    bo_set_64be(moov, p_stream->mux.i_stco_pos + i_written++ * 8, entry[i].i_pos + i_shift);
                 else
-                    bo_set_32be(moov, p_stream->mux.i_stco_pos + i_written++ * 4, entry[i].i_pos + p_sys->i_mdat_pos - i_moov_pos);
+                    bo_set_32be(moov, p_stream->mux.i_stco_pos + i_written++ * 4, entry[i].i_pos + i_shift);
 
                 for (; i < p_stream->mux.i_entry_count; i++)
                     if (i >= p_stream->mux.i_entry_count - 1 ||
@@ -81,6 +81,21 @@
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
 
+#define LADDER_TEXT N_("Encoding ladder")
+#define LADDER_LONGTEXT N_( \
+    "Decode the video once and encode it for every rung of this " \
+    "colon-separated list of WIDTHxHEIGHT@BITRATE entries, each on its own " \
+    "thread and as its own output stream. A null width or height keeps " \
+    "the aspect ratio." )
+#define LADDER_QUEUE_TEXT N_("Encoding ladder queue")
+#define LADDER_QUEUE_LONGTEXT N_( \
+    "Number of decoded pictures each rung of the ladder can hold " \
+    "before it falls behind." )
+#define LADDER_DROP_TEXT N_("Drop late pictures")
+#define LADDER_DROP_LONGTEXT N_( \
+    "Drop pictures for a rung of the ladder that fell behind instead of " \
+    "waiting for it." )
+
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
     "This is the audio encoder module that will be used (and its associated "\
@@ -179,6 +194,13 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter2",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "ladder", NULL, LADDER_TEXT,
+                LADDER_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "ladder-queue", 8, LADDER_QUEUE_TEXT,
+                 LADDER_QUEUE_LONGTEXT, true )
+        change_integer_range( 1, 256 )
+    add_bool( SOUT_CFG_PREFIX "ladder-drop", false, LADDER_DROP_TEXT,
+              LADDER_DROP_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -227,6 +249,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "osd", "high-priority", "maxwidth", "maxheight",
+    "ladder", "ladder-queue", "ladder-drop",
     NULL
 };
 
@@ -237,6 +260,42 @@ static sout_stream_id_sys_t *Add( sout_stream_t *, const es_format_t * );
 static void              Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
 
+/*****************************************************************************
+ * ParseLadder: colon-separated list of WIDTHxHEIGHT@BITRATE rungs
+ *****************************************************************************/
+static void ParseLadder( sout_stream_t *p_stream, sout_stream_sys_t *p_sys,
+                         const char *psz_ladder )
+{
+    char *psz_dup = strdup( psz_ladder );
+    char *psz_save;
+
+    if( !psz_dup )
+        return;
+
+    for( char *psz = strtok_r( psz_dup, ":", &psz_save ); psz != NULL;
+         psz = strtok_r( NULL, ":", &psz_save ) )
+    {
+        transcode_rung_cfg_t cfg;
+
+        if( sscanf( psz, "%ux%u@%d", &cfg.i_width, &cfg.i_height,
+                    &cfg.i_bitrate ) != 3 ||
+            ( !cfg.i_width && !cfg.i_height ) || cfg.i_bitrate <= 0 )
+        {
+            msg_Warn( p_stream, "ignoring invalid ladder rung `%s'", psz );
+            continue;
+        }
+        if( cfg.i_bitrate < 16000 ) cfg.i_bitrate *= 1000;
+
+        transcode_rung_cfg_t *p_ladder =
+            realloc( p_sys->p_ladder, (p_sys->i_ladder + 1) * sizeof(cfg) );
+        if( !p_ladder )
+            break;
+        p_ladder[p_sys->i_ladder++] = cfg;
+        p_sys->p_ladder = p_ladder;
+    }
+    free( psz_dup );
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -358,6 +417,15 @@ static int Open( vlc_object_t *p_this )
         p_sys->psz_vf2 = NULL;
     free( psz_string );
 
+    p_sys->p_ladder = NULL;
+    p_sys->i_ladder = 0;
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "ladder" );
+    if( psz_string && *psz_string )
+        ParseLadder( p_stream, p_sys, psz_string );
+    free( psz_string );
+    p_sys->i_ladder_queue = var_GetInteger( p_stream, SOUT_CFG_PREFIX "ladder-queue" );
+    p_sys->b_ladder_drop = var_GetBool( p_stream, SOUT_CFG_PREFIX "ladder-drop" );
+
     p_sys->b_deinterlace = var_GetBool( p_stream, SOUT_CFG_PREFIX "deinterlace" );
 
     psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "deinterlace-module" );
@@ -381,6 +449,10 @@ static int Open( vlc_object_t *p_this )
         msg_Dbg( p_stream, "codec video=%4.4s %dx%d scaling: %f %dkb/s",
                  (char *)&p_sys->i_vcodec, p_sys->i_width, p_sys->i_height,
                  p_sys->f_scale, p_sys->i_vbitrate / 1000 );
+        for( unsigned i = 0; i < p_sys->i_ladder; i++ )
+            msg_Dbg( p_stream, "ladder rung %u: %ux%u %dkb/s", i,
+                     p_sys->p_ladder[i].i_width, p_sys->p_ladder[i].i_height,
+                     p_sys->p_ladder[i].i_bitrate / 1000 );
     }
 
     /* Subpictures transcoding parameters */
@@ -479,6 +551,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_ladder );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
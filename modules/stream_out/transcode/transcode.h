@@ -14,6 +14,16 @@
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
+/* Requested output of one rung of the encoding ladder */
+typedef struct
+{
+    unsigned int    i_width;
+    unsigned int    i_height;
+    int             i_bitrate;
+} transcode_rung_cfg_t;
+
+typedef struct transcode_rung_t transcode_rung_t;
+
 struct sout_stream_sys_t
 {
     sout_stream_id_sys_t *id_video;
@@ -53,6 +63,12 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    /* Encoding ladder */
+    transcode_rung_cfg_t *p_ladder;
+    unsigned int    i_ladder;
+    unsigned int    i_ladder_queue;
+    bool            b_ladder_drop;
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
@@ -92,6 +108,8 @@ struct sout_stream_id_sys_t
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
              video_format_t  fmt_input_video;
+             transcode_rung_t *p_rungs; /**< Encoding ladder */
+             unsigned int    i_rungs;
          };
          struct
          {
@@ -212,7 +212,8 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     }
     id->p_encoder->p_module = NULL;
 
-    if( p_sys->i_threads <= 0 )
+    /* The encoding ladder runs its own threads */
+    if( p_sys->i_threads <= 0 || p_sys->i_ladder )
         return VLC_SUCCESS;
 
     int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
@@ -337,7 +338,8 @@ static void conversion_video_filter_append( sout_stream_id_sys_t *id )
 }
 
 static void transcode_video_encoder_init( sout_stream_t *p_stream,
-                                          sout_stream_id_sys_t *id )
+                                          sout_stream_id_sys_t *id,
+                                          encoder_t *p_enc )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
 
@@ -377,8 +379,8 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
     msg_Dbg( p_stream, "source pixel aspect is %f:1", (double) f_aspect );
 
     /* Calculate scaling factor for specified parameters */
-    if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-        id->p_encoder->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
+    if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+        p_enc->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
     {
         /* Global scaling. Make sure width will remain a factor of 16 */
         float f_real_scale;
@@ -397,26 +399,26 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
         f_scale_width = f_real_scale;
         f_scale_height = (float) i_new_height / (float) i_src_visible_height;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height <= 0 )
+    else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+             p_enc->fmt_out.video.i_visible_height <= 0 )
     {
         /* Only width specified */
-        f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
+        f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
         f_scale_height = f_scale_width;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height > 0 )
+    else if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+             p_enc->fmt_out.video.i_visible_height > 0 )
     {
          /* Only height specified */
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
          f_scale_width = f_scale_height;
      }
-     else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-              id->p_encoder->fmt_out.video.i_visible_height > 0 )
+     else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+              p_enc->fmt_out.video.i_visible_height > 0 )
      {
          /* Width and height specified */
-         f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
      }
 
      /* check maxwidth and maxheight */
@@ -451,15 +453,15 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
      f_aspect = f_aspect * i_dst_visible_width / i_dst_visible_height;
 
      /* Store calculated values */
-     id->p_encoder->fmt_out.video.i_width = i_dst_width;
-     id->p_encoder->fmt_out.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_out.video.i_height = i_dst_height;
-     id->p_encoder->fmt_out.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_out.video.i_width = i_dst_width;
+     p_enc->fmt_out.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_out.video.i_height = i_dst_height;
+     p_enc->fmt_out.video.i_visible_height = i_dst_visible_height;
 
-     id->p_encoder->fmt_in.video.i_width = i_dst_width;
-     id->p_encoder->fmt_in.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_in.video.i_height = i_dst_height;
-     id->p_encoder->fmt_in.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_in.video.i_width = i_dst_width;
+     p_enc->fmt_in.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_in.video.i_height = i_dst_height;
+     p_enc->fmt_in.video.i_visible_height = i_dst_visible_height;
 
      msg_Dbg( p_stream, "source %ix%i, destination %ix%i",
          i_src_visible_width, i_src_visible_height,
@@ -467,73 +469,73 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
      );
 
     /* Handle frame rate conversion */
-    if( !id->p_encoder->fmt_out.video.i_frame_rate ||
-        !id->p_encoder->fmt_out.video.i_frame_rate_base )
+    if( !p_enc->fmt_out.video.i_frame_rate ||
+        !p_enc->fmt_out.video.i_frame_rate_base )
     {
         if( p_fmt_out->video.i_frame_rate &&
             p_fmt_out->video.i_frame_rate_base )
         {
-            id->p_encoder->fmt_out.video.i_frame_rate =
+            p_enc->fmt_out.video.i_frame_rate =
                 p_fmt_out->video.i_frame_rate;
-            id->p_encoder->fmt_out.video.i_frame_rate_base =
+            p_enc->fmt_out.video.i_frame_rate_base =
                 p_fmt_out->video.i_frame_rate_base;
         }
         else
         {
             /* Pick a sensible default value */
-            id->p_encoder->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
-            id->p_encoder->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
+            p_enc->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
+            p_enc->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
         }
     }
 
-    id->p_encoder->fmt_in.video.orientation =
-        id->p_encoder->fmt_out.video.orientation =
+    p_enc->fmt_in.video.orientation =
+        p_enc->fmt_out.video.orientation =
         id->p_decoder->fmt_in.video.orientation;
 
-    id->p_encoder->fmt_in.video.i_frame_rate =
-        id->p_encoder->fmt_out.video.i_frame_rate;
-    id->p_encoder->fmt_in.video.i_frame_rate_base =
-        id->p_encoder->fmt_out.video.i_frame_rate_base;
+    p_enc->fmt_in.video.i_frame_rate =
+        p_enc->fmt_out.video.i_frame_rate;
+    p_enc->fmt_in.video.i_frame_rate_base =
+        p_enc->fmt_out.video.i_frame_rate_base;
 
-    vlc_ureduce( &id->p_encoder->fmt_in.video.i_frame_rate,
-        &id->p_encoder->fmt_in.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base,
+    vlc_ureduce( &p_enc->fmt_in.video.i_frame_rate,
+        &p_enc->fmt_in.video.i_frame_rate_base,
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base,
         0 );
      msg_Dbg( p_stream, "source fps %u/%u, destination %u/%u",
         id->p_decoder->fmt_out.video.i_frame_rate,
         id->p_decoder->fmt_out.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base );
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base );
 
 
     /* Check whether a particular aspect ratio was requested */
-    if( id->p_encoder->fmt_out.video.i_sar_num <= 0 ||
-        id->p_encoder->fmt_out.video.i_sar_den <= 0 )
+    if( p_enc->fmt_out.video.i_sar_num <= 0 ||
+        p_enc->fmt_out.video.i_sar_den <= 0 )
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
                      (uint64_t)p_fmt_out->video.i_sar_num * i_src_visible_width  * i_dst_visible_height,
                      (uint64_t)p_fmt_out->video.i_sar_den * i_src_visible_height * i_dst_visible_width,
                      0 );
     }
     else
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
-                     id->p_encoder->fmt_out.video.i_sar_num,
-                     id->p_encoder->fmt_out.video.i_sar_den,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
+                     p_enc->fmt_out.video.i_sar_num,
+                     p_enc->fmt_out.video.i_sar_den,
                      0 );
     }
 
-    id->p_encoder->fmt_in.video.i_sar_num =
-        id->p_encoder->fmt_out.video.i_sar_num;
-    id->p_encoder->fmt_in.video.i_sar_den =
-        id->p_encoder->fmt_out.video.i_sar_den;
+    p_enc->fmt_in.video.i_sar_num =
+        p_enc->fmt_out.video.i_sar_num;
+    p_enc->fmt_in.video.i_sar_den =
+        p_enc->fmt_out.video.i_sar_den;
 
     msg_Dbg( p_stream, "encoder aspect is %i:%i",
-             id->p_encoder->fmt_out.video.i_sar_num * id->p_encoder->fmt_out.video.i_width,
-             id->p_encoder->fmt_out.video.i_sar_den * id->p_encoder->fmt_out.video.i_height );
+             p_enc->fmt_out.video.i_sar_num * p_enc->fmt_out.video.i_width,
+             p_enc->fmt_out.video.i_sar_den * p_enc->fmt_out.video.i_height );
 
 }
 
@@ -573,10 +575,459 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
+/*
+ * Encoding ladder: pictures are decoded and filtered once, then handed
+ * to one thread per rung which scales and encodes them for its own
+ * output stream. Each rung has a bounded queue so that a slow encoder
+ * either holds the others back or, if allowed, misses pictures.
+ */
+struct transcode_rung_t
+{
+    encoder_t       *p_encoder;
+    filter_chain_t  *p_chain; /**< Scaling and chroma conversion */
+    void            *id;      /**< id of the out stream */
+
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait;     /**< a picture was queued */
+    vlc_cond_t      room;     /**< a picture was dequeued or encoded */
+    picture_t       **pp_queue;
+    unsigned int    i_size;
+    unsigned int    i_first;
+    unsigned int    i_queued;
+    bool            b_busy;
+    bool            b_abort;
+    block_t         *p_out;
+
+    unsigned int    i_encoded;
+    unsigned int    i_dropped;
+};
+
+static const es_format_t *transcode_ladder_fmt( sout_stream_id_sys_t *id )
+{
+    if( id->p_uf_chain )
+        return filter_chain_GetFmtOut( id->p_uf_chain );
+    if( id->p_f_chain )
+        return filter_chain_GetFmtOut( id->p_f_chain );
+    return &id->p_decoder->fmt_out;
+}
+
+static void* RungThread( void *obj )
+{
+    transcode_rung_t *p_rung = obj;
+    int canc = vlc_savecancel ();
+    block_t *p_block;
+
+    vlc_mutex_lock( &p_rung->lock );
+
+    /* Keep going on abort until the queue is empty */
+    for( ;; )
+    {
+        if( p_rung->i_queued == 0 )
+        {
+            if( p_rung->b_abort )
+                break;
+            vlc_cond_wait( &p_rung->wait, &p_rung->lock );
+            continue;
+        }
+
+        picture_t *p_pic = p_rung->pp_queue[p_rung->i_first];
+        p_rung->i_first = (p_rung->i_first + 1) % p_rung->i_size;
+        p_rung->i_queued--;
+        p_rung->b_busy = true;
+        vlc_cond_signal( &p_rung->room );
+
+        /* release lock while scaling and encoding */
+        vlc_mutex_unlock( &p_rung->lock );
+        p_block = NULL;
+        if( p_rung->p_chain )
+            p_pic = filter_chain_VideoFilter( p_rung->p_chain, p_pic );
+        if( p_pic )
+        {
+            p_block = p_rung->p_encoder->pf_encode_video( p_rung->p_encoder, p_pic );
+            picture_Release( p_pic );
+        }
+        vlc_mutex_lock( &p_rung->lock );
+
+        block_ChainAppend( &p_rung->p_out, p_block );
+        p_rung->i_encoded++;
+        var_SetInteger( p_rung->p_encoder, "ladder-encoded", p_rung->i_encoded );
+        p_rung->b_busy = false;
+        vlc_cond_signal( &p_rung->room );
+    }
+
+    /*Now flush encoder*/
+    do {
+        p_block = p_rung->p_encoder->pf_encode_video( p_rung->p_encoder, NULL );
+        block_ChainAppend( &p_rung->p_out, p_block );
+    } while( p_block );
+
+    vlc_mutex_unlock( &p_rung->lock );
+
+    vlc_restorecancel (canc);
+
+    return NULL;
+}
+
+/* (Re)build the conversion from the filtered pictures to the rung encoder */
+static int transcode_rung_chain_init( sout_stream_t *p_stream,
+                                      sout_stream_id_sys_t *id,
+                                      transcode_rung_t *p_rung )
+{
+    const es_format_t *p_fmt_out = transcode_ladder_fmt( id );
+    const es_format_t *p_fmt_enc = &p_rung->p_encoder->fmt_in;
+
+    if( p_rung->p_chain )
+        filter_chain_Delete( p_rung->p_chain );
+    p_rung->p_chain = NULL;
+
+    if( p_fmt_out->video.i_chroma == p_fmt_enc->video.i_chroma &&
+        p_fmt_out->video.i_width == p_fmt_enc->video.i_width &&
+        p_fmt_out->video.i_height == p_fmt_enc->video.i_height )
+        return VLC_SUCCESS;
+
+    filter_owner_t owner = {
+        .sys = p_stream->p_sys,
+        .video = {
+            .buffer_new = transcode_video_filter_buffer_new,
+        },
+    };
+    p_rung->p_chain = filter_chain_NewVideo( p_stream, false, &owner );
+    if( !p_rung->p_chain )
+        return VLC_ENOMEM;
+    filter_chain_Reset( p_rung->p_chain, p_fmt_out, p_fmt_enc );
+    if( filter_chain_AppendFilter( p_rung->p_chain, NULL, NULL,
+                                   p_fmt_out, p_fmt_enc ) == NULL )
+    {
+        msg_Err( p_stream, "cannot convert %4.4s %ux%u to %4.4s %ux%u",
+                 (const char *)&p_fmt_out->video.i_chroma,
+                 p_fmt_out->video.i_width, p_fmt_out->video.i_height,
+                 (const char *)&p_fmt_enc->video.i_chroma,
+                 p_fmt_enc->video.i_width, p_fmt_enc->video.i_height );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int transcode_rung_open( sout_stream_t *p_stream,
+                                sout_stream_id_sys_t *id,
+                                transcode_rung_t *p_rung, unsigned i_rung )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const transcode_rung_cfg_t *p_cfg = &p_sys->p_ladder[i_rung];
+
+    vlc_mutex_init( &p_rung->lock );
+    vlc_cond_init( &p_rung->wait );
+    vlc_cond_init( &p_rung->room );
+    p_rung->b_abort = true; /* no thread yet */
+    p_rung->i_size = p_sys->i_ladder_queue;
+    p_rung->pp_queue = malloc( p_rung->i_size * sizeof(picture_t *) );
+    p_rung->p_encoder = sout_EncoderCreate( p_stream );
+    if( !p_rung->pp_queue || !p_rung->p_encoder )
+        return VLC_ENOMEM;
+
+    encoder_t *p_enc = p_rung->p_encoder;
+    p_enc->p_module = NULL;
+    /* Live statistics of the rung */
+    var_Create( p_enc, "ladder-encoded", VLC_VAR_INTEGER );
+    var_Create( p_enc, "ladder-dropped", VLC_VAR_INTEGER );
+
+    const es_format_t *p_fmt_out = transcode_ladder_fmt( id );
+    es_format_Init( &p_enc->fmt_in, VIDEO_ES, p_fmt_out->i_codec );
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+
+    /* Only the first rung takes over the id of the elementary stream */
+    es_format_Init( &p_enc->fmt_out, VIDEO_ES, p_sys->i_vcodec );
+    if( i_rung == 0 )
+        p_enc->fmt_out.i_id = id->p_encoder->fmt_out.i_id;
+    p_enc->fmt_out.i_group = id->p_encoder->fmt_out.i_group;
+    if( id->p_encoder->fmt_out.psz_language )
+        p_enc->fmt_out.psz_language = strdup( id->p_encoder->fmt_out.psz_language );
+    p_enc->fmt_out.i_bitrate = p_cfg->i_bitrate;
+    p_enc->fmt_out.video.i_visible_width  = p_cfg->i_width & ~1;
+    p_enc->fmt_out.video.i_visible_height = p_cfg->i_height & ~1;
+    p_enc->fmt_out.video.i_frame_rate = id->p_encoder->fmt_out.video.i_frame_rate;
+    p_enc->fmt_out.video.i_frame_rate_base = id->p_encoder->fmt_out.video.i_frame_rate_base;
+
+    p_enc->i_threads = p_sys->i_threads;
+    p_enc->p_cfg = p_sys->p_video_cfg;
+
+    transcode_video_encoder_init( p_stream, id, p_enc );
+
+    p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+    if( !p_enc->p_module )
+    {
+        msg_Err( p_stream, "cannot find video encoder (module:%s fourcc:%4.4s)",
+                 p_sys->psz_venc ? p_sys->psz_venc : "any",
+                 (char *)&p_sys->i_vcodec );
+        return VLC_EGENERIC;
+    }
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+    p_enc->fmt_out.i_codec = vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
+
+    /* Convert to what the encoder eventually takes */
+    if( transcode_rung_chain_init( p_stream, id, p_rung ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+    p_rung->id = sout_StreamIdAdd( p_stream->p_next, &p_enc->fmt_out );
+    if( !p_rung->id )
+    {
+        msg_Err( p_stream, "cannot add this stream" );
+        return VLC_EGENERIC;
+    }
+
+    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                       VLC_THREAD_PRIORITY_VIDEO;
+    p_rung->b_abort = false;
+    if( vlc_clone( &p_rung->thread, RungThread, p_rung, i_priority ) )
+    {
+        msg_Err( p_stream, "cannot spawn encoder thread" );
+        p_rung->b_abort = true;
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_stream, "ladder rung %u: %ux%u %dkb/s", i_rung,
+             p_enc->fmt_out.video.i_visible_width,
+             p_enc->fmt_out.video.i_visible_height,
+             p_enc->fmt_out.i_bitrate / 1000 );
+    return VLC_SUCCESS;
+}
+
+/* Encode what is queued, flush the encoders and wait for the threads */
+static void transcode_ladder_stop( sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+
+        vlc_mutex_lock( &p_rung->lock );
+        bool b_running = !p_rung->b_abort;
+        p_rung->b_abort = true;
+        vlc_cond_signal( &p_rung->wait );
+        vlc_mutex_unlock( &p_rung->lock );
+
+        if( b_running )
+            vlc_join( p_rung->thread, NULL );
+    }
+}
+
+static void transcode_ladder_close( sout_stream_t *p_stream,
+                                    sout_stream_id_sys_t *id )
+{
+    transcode_ladder_stop( id );
+
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+
+        msg_Dbg( p_stream, "ladder rung %u: %u pictures encoded, %u dropped",
+                 i, p_rung->i_encoded, p_rung->i_dropped );
+
+        block_ChainRelease( p_rung->p_out );
+        for( unsigned j = 0; j < p_rung->i_queued; j++ )
+            picture_Release( p_rung->pp_queue[(p_rung->i_first + j) % p_rung->i_size] );
+        free( p_rung->pp_queue );
+        if( p_rung->p_chain )
+            filter_chain_Delete( p_rung->p_chain );
+        if( p_rung->id )
+            sout_StreamIdDel( p_stream->p_next, p_rung->id );
+        if( p_rung->p_encoder )
+        {
+            if( p_rung->p_encoder->p_module )
+                module_unneed( p_rung->p_encoder, p_rung->p_encoder->p_module );
+            es_format_Clean( &p_rung->p_encoder->fmt_out );
+            vlc_object_release( p_rung->p_encoder );
+        }
+        vlc_cond_destroy( &p_rung->room );
+        vlc_cond_destroy( &p_rung->wait );
+        vlc_mutex_destroy( &p_rung->lock );
+    }
+    if( id->p_rungs )
+        var_Destroy( p_stream, "ladder-dropped" );
+    free( id->p_rungs );
+    id->p_rungs = NULL;
+    id->i_rungs = 0;
+}
+
+static int transcode_ladder_open( sout_stream_t *p_stream,
+                                  sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( id->p_f_chain )
+        filter_chain_Delete( id->p_f_chain );
+    if( id->p_uf_chain )
+        filter_chain_Delete( id->p_uf_chain );
+    id->p_f_chain = id->p_uf_chain = NULL;
+
+    transcode_video_filter_init( p_stream, id );
+    memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
+
+    if( p_sys->p_spu )
+        msg_Warn( p_stream, "overlays are not rendered on the encoding ladder" );
+
+    id->p_rungs = calloc( p_sys->i_ladder, sizeof(*id->p_rungs) );
+    if( !id->p_rungs )
+        return VLC_ENOMEM;
+
+    /* Pictures dropped by all rungs so far */
+    var_Create( p_stream, "ladder-dropped", VLC_VAR_INTEGER );
+
+    for( unsigned i = 0; i < p_sys->i_ladder; i++ )
+    {
+        id->i_rungs++;
+        if( transcode_rung_open( p_stream, id, &id->p_rungs[i], i ) != VLC_SUCCESS )
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/* The decoded format changed: let the rungs go idle, then rebuild the
+ * filters. The rungs keep their output dimensions. */
+static void transcode_ladder_reset( sout_stream_t *p_stream,
+                                    sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+
+        vlc_mutex_lock( &p_rung->lock );
+        while( p_rung->i_queued || p_rung->b_busy )
+            vlc_cond_wait( &p_rung->room, &p_rung->lock );
+        vlc_mutex_unlock( &p_rung->lock );
+    }
+
+    if( id->p_f_chain )
+        filter_chain_Delete( id->p_f_chain );
+    if( id->p_uf_chain )
+        filter_chain_Delete( id->p_uf_chain );
+    id->p_f_chain = id->p_uf_chain = NULL;
+
+    transcode_video_filter_init( p_stream, id );
+    memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
+
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+        transcode_rung_chain_init( p_stream, id, &id->p_rungs[i] );
+}
+
+static void transcode_ladder_push( sout_stream_t *p_stream,
+                                   sout_stream_id_sys_t *id, picture_t *p_pic )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+
+        vlc_mutex_lock( &p_rung->lock );
+        if( !p_sys->b_ladder_drop )
+            while( !p_rung->b_abort && p_rung->i_queued == p_rung->i_size )
+                vlc_cond_wait( &p_rung->room, &p_rung->lock );
+
+        if( !p_rung->b_abort && p_rung->i_queued < p_rung->i_size )
+        {
+            p_rung->pp_queue[(p_rung->i_first + p_rung->i_queued) % p_rung->i_size] =
+                picture_Hold( p_pic );
+            p_rung->i_queued++;
+            vlc_cond_signal( &p_rung->wait );
+        }
+        else
+        {
+            p_rung->i_dropped++;
+            var_SetInteger( p_rung->p_encoder, "ladder-dropped", p_rung->i_dropped );
+            var_IncInteger( p_stream, "ladder-dropped" );
+        }
+        vlc_mutex_unlock( &p_rung->lock );
+    }
+    picture_Release( p_pic );
+}
+
+/* Pick up what the rungs have encoded so far */
+static void transcode_ladder_send( sout_stream_t *p_stream,
+                                   sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+
+        vlc_mutex_lock( &p_rung->lock );
+        block_t *p_out = p_rung->p_out;
+        p_rung->p_out = NULL;
+        vlc_mutex_unlock( &p_rung->lock );
+
+        if( p_out )
+            sout_StreamIdSend( p_stream->p_next, p_rung->id, p_out );
+    }
+}
+
+static int transcode_ladder_process( sout_stream_t *p_stream,
+                                     sout_stream_id_sys_t *id, block_t *in )
+{
+    picture_t *p_pic;
+
+    if( unlikely( in == NULL ) )
+    {
+        msg_Dbg( p_stream, "Flushing ladder");
+        transcode_ladder_stop( id );
+        transcode_ladder_send( p_stream, id );
+        return VLC_SUCCESS;
+    }
+
+    while( (p_pic = id->p_decoder->pf_decode_video( id->p_decoder, &in )) )
+    {
+        if( unlikely( id->p_rungs == NULL ) )
+        {
+            if( transcode_ladder_open( p_stream, id ) != VLC_SUCCESS )
+            {
+                picture_Release( p_pic );
+                transcode_video_close( p_stream, id );
+                id->b_transcode = false;
+                return VLC_EGENERIC;
+            }
+        }
+        else if( unlikely( !video_format_IsSimilar( &id->fmt_input_video,
+                                                    &id->p_decoder->fmt_out.video ) ) )
+        {
+            msg_Info( p_stream, "video format changed, reiniting the ladder" );
+            transcode_ladder_reset( p_stream, id );
+        }
+
+        for ( ;; ) {
+            picture_t *p_filtered_pic = p_pic;
+
+            if( id->p_f_chain )
+                p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
+            if( !p_filtered_pic )
+                break;
+
+            for ( ;; ) {
+                picture_t *p_user_filtered_pic = p_filtered_pic;
+
+                if( id->p_uf_chain )
+                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+                if( !p_user_filtered_pic )
+                    break;
+
+                transcode_ladder_push( p_stream, id, p_user_filtered_pic );
+
+                p_filtered_pic = NULL;
+            }
+
+            p_pic = NULL;
+        }
+    }
+
+    transcode_ladder_send( p_stream, id );
+
+    return VLC_SUCCESS;
+}
+
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
+    if( p_stream->p_sys->i_ladder )
+        transcode_ladder_close( p_stream, id );
+    else if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
     {
         vlc_mutex_lock( &p_stream->p_sys->lock_out );
         p_stream->p_sys->b_abort = true;
@@ -589,7 +1040,7 @@ void transcode_video_close( sout_stream_t *p_stream,
         block_ChainRelease( p_stream->p_sys->p_buffers );
     }
 
-    if( p_stream->p_sys->i_threads >= 1 )
+    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->i_ladder )
     {
         vlc_mutex_destroy( &p_stream->p_sys->lock_out );
         vlc_cond_destroy( &p_stream->p_sys->cond );
@@ -690,6 +1141,9 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     picture_t *p_pic = NULL;
     *out = NULL;
 
+    if( p_sys->i_ladder )
+        return transcode_ladder_process( p_stream, id, in );
+
     if( unlikely( in == NULL ) )
     {
         if( p_sys->i_threads == 0 )
@@ -747,7 +1201,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             id->p_encoder->fmt_out.video.i_sar_num = id->p_encoder->fmt_out.video.i_sar_den = 0;
 
             transcode_video_filter_init( p_stream, id );
-            transcode_video_encoder_init( p_stream, id );
+            transcode_video_encoder_init( p_stream, id, id->p_encoder );
             conversion_video_filter_append( id );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
         }
@@ -762,7 +1216,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             id->p_f_chain = id->p_uf_chain = NULL;
 
             transcode_video_filter_init( p_stream, id );
-            transcode_video_encoder_init( p_stream, id );
+            transcode_video_encoder_init( p_stream, id, id->p_encoder );
             conversion_video_filter_append( id );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
 
@@ -0,0 +1,277 @@
+/*****************************************************************************
+ * glyph_cache.c : Cache of loaded and rendered glyphs
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+
+#include "glyph_cache.h"
+
+#define GLYPH_CACHE_BUCKETS 1024
+
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    glyph_cache_key_t    key;
+    int                  i_kind;
+    FT_Vector            subpixel;      /* origin modulo one pixel */
+    FT_Vector            advance;
+    FT_Glyph             p_glyph;
+    size_t               i_size;
+
+    glyph_cache_entry_t *p_next;        /* hash chain */
+    glyph_cache_entry_t *p_prev_used;   /* LRU list, most recent first */
+    glyph_cache_entry_t *p_next_used;
+};
+
+struct glyph_cache_t
+{
+    glyph_cache_entry_t *pp_buckets[ GLYPH_CACHE_BUCKETS ];
+    glyph_cache_entry_t *p_first_used;
+    glyph_cache_entry_t *p_last_used;
+
+    size_t               i_size;
+    size_t               i_max_size;
+
+    unsigned             i_hits;
+    unsigned             i_misses;
+    unsigned             i_evictions;
+};
+
+static bool IsBitmapKind( int i_kind )
+{
+    return i_kind == GLYPH_CACHE_GLYPH_BITMAP
+        || i_kind == GLYPH_CACHE_BORDER_BITMAP;
+}
+
+static void MakeKey( glyph_cache_entry_t *p_entry, const glyph_cache_key_t *p_key,
+                     int i_kind, const FT_Vector *p_origin )
+{
+    p_entry->key = *p_key;
+    /* The stroker radius only matters to borders */
+    if( i_kind == GLYPH_CACHE_GLYPH || i_kind == GLYPH_CACHE_GLYPH_BITMAP )
+        p_entry->key.i_radius = 0;
+    p_entry->i_kind = i_kind;
+    if( IsBitmapKind( i_kind ) && p_origin )
+    {
+        p_entry->subpixel.x = p_origin->x & 63;
+        p_entry->subpixel.y = p_origin->y & 63;
+    }
+    else
+        p_entry->subpixel.x = p_entry->subpixel.y = 0;
+}
+
+static unsigned Hash( const glyph_cache_entry_t *p_entry )
+{
+    uintptr_t h = (uintptr_t) p_entry->key.p_face;
+    h = h * 31 + p_entry->key.i_glyph_index;
+    h = h * 31 + p_entry->key.i_flags;
+    h = h * 31 + (uintptr_t) p_entry->key.i_radius;
+    h = h * 31 + p_entry->i_kind;
+    h = h * 31 + (uintptr_t)( p_entry->subpixel.x << 6 | p_entry->subpixel.y );
+    h ^= h >> 15;
+    return h % GLYPH_CACHE_BUCKETS;
+}
+
+static bool Equals( const glyph_cache_entry_t *a, const glyph_cache_entry_t *b )
+{
+    return a->key.p_face == b->key.p_face
+        && a->key.i_glyph_index == b->key.i_glyph_index
+        && a->key.i_flags == b->key.i_flags
+        && a->key.i_radius == b->key.i_radius
+        && a->i_kind == b->i_kind
+        && a->subpixel.x == b->subpixel.x
+        && a->subpixel.y == b->subpixel.y;
+}
+
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph) p_glyph)->bitmap;
+        return sizeof( FT_BitmapGlyphRec )
+             + p_bitmap->rows * (size_t) abs( p_bitmap->pitch );
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &((FT_OutlineGlyph) p_glyph)->outline;
+        return sizeof( FT_OutlineGlyphRec )
+             + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+             + p_outline->n_contours * sizeof( short );
+    }
+    return sizeof( FT_GlyphRec );
+}
+
+static void Unuse( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev_used )
+        p_entry->p_prev_used->p_next_used = p_entry->p_next_used;
+    else
+        p_cache->p_first_used = p_entry->p_next_used;
+
+    if( p_entry->p_next_used )
+        p_entry->p_next_used->p_prev_used = p_entry->p_prev_used;
+    else
+        p_cache->p_last_used = p_entry->p_prev_used;
+}
+
+static void Use( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    p_entry->p_prev_used = NULL;
+    p_entry->p_next_used = p_cache->p_first_used;
+    if( p_cache->p_first_used )
+        p_cache->p_first_used->p_prev_used = p_entry;
+    else
+        p_cache->p_last_used = p_entry;
+    p_cache->p_first_used = p_entry;
+}
+
+static void Evict( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp_entry = &p_cache->pp_buckets[ Hash( p_entry ) ];
+    while( *pp_entry != p_entry )
+        pp_entry = &(*pp_entry)->p_next;
+    *pp_entry = p_entry->p_next;
+
+    Unuse( p_cache, p_entry );
+
+    p_cache->i_size -= p_entry->i_size;
+    FT_Done_Glyph( p_entry->p_glyph );
+    free( p_entry );
+}
+
+glyph_cache_t *GlyphCacheNew( size_t i_max_size )
+{
+    glyph_cache_t *p_cache = calloc( 1, sizeof( *p_cache ) );
+    if( unlikely( !p_cache ) )
+        return NULL;
+
+    p_cache->i_max_size = i_max_size;
+    return p_cache;
+}
+
+void GlyphCacheDelete( vlc_object_t *p_obj, glyph_cache_t *p_cache )
+{
+    msg_Dbg( p_obj, "glyph cache: %u hits, %u misses, %u evictions, %zu bytes",
+             p_cache->i_hits, p_cache->i_misses, p_cache->i_evictions,
+             p_cache->i_size );
+
+    while( p_cache->p_last_used )
+        Evict( p_cache, p_cache->p_last_used );
+    free( p_cache );
+}
+
+FT_Glyph GlyphCacheGet( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                        int i_kind, const FT_Vector *p_origin,
+                        FT_Vector *p_advance )
+{
+    glyph_cache_entry_t wanted;
+    MakeKey( &wanted, p_key, i_kind, p_origin );
+
+    glyph_cache_entry_t *p_entry = p_cache->pp_buckets[ Hash( &wanted ) ];
+    while( p_entry && !Equals( p_entry, &wanted ) )
+        p_entry = p_entry->p_next;
+
+    FT_Glyph p_glyph;
+    if( !p_entry || FT_Glyph_Copy( p_entry->p_glyph, &p_glyph ) )
+    {
+        p_cache->i_misses++;
+        return NULL;
+    }
+    p_cache->i_hits++;
+
+    Unuse( p_cache, p_entry );
+    Use( p_cache, p_entry );
+
+    /* Bitmaps are stored relative to the pixel holding the origin */
+    if( IsBitmapKind( i_kind ) && p_origin )
+    {
+        FT_BitmapGlyph p_bitmap = (FT_BitmapGlyph) p_glyph;
+        p_bitmap->left += FT_FLOOR( p_origin->x );
+        p_bitmap->top  += FT_FLOOR( p_origin->y );
+    }
+    if( p_advance )
+        *p_advance = p_entry->advance;
+
+    return p_glyph;
+}
+
+void GlyphCachePut( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                    int i_kind, const FT_Vector *p_origin,
+                    FT_Glyph p_glyph, const FT_Vector *p_advance )
+{
+    size_t i_size = sizeof( glyph_cache_entry_t ) + GlyphSize( p_glyph );
+    if( i_size > p_cache->i_max_size )
+        return;
+
+    glyph_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) );
+    if( unlikely( !p_entry ) )
+        return;
+
+    MakeKey( p_entry, p_key, i_kind, p_origin );
+    if( FT_Glyph_Copy( p_glyph, &p_entry->p_glyph ) )
+    {
+        free( p_entry );
+        return;
+    }
+
+    if( IsBitmapKind( i_kind ) && p_origin )
+    {
+        FT_BitmapGlyph p_bitmap = (FT_BitmapGlyph) p_entry->p_glyph;
+        p_bitmap->left -= FT_FLOOR( p_origin->x );
+        p_bitmap->top  -= FT_FLOOR( p_origin->y );
+    }
+    if( p_advance )
+        p_entry->advance = *p_advance;
+    else
+        p_entry->advance.x = p_entry->advance.y = 0;
+    p_entry->i_size = i_size;
+
+    unsigned i_bucket = Hash( p_entry );
+    for( glyph_cache_entry_t *p_old = p_cache->pp_buckets[ i_bucket ];
+         p_old; p_old = p_old->p_next )
+    {
+        if( Equals( p_old, p_entry ) )
+        {
+            Evict( p_cache, p_old );
+            break;
+        }
+    }
+
+    while( p_cache->i_size + i_size > p_cache->i_max_size )
+    {
+        Evict( p_cache, p_cache->p_last_used );
+        p_cache->i_evictions++;
+    }
+
+    p_entry->p_next = p_cache->pp_buckets[ i_bucket ];
+    p_cache->pp_buckets[ i_bucket ] = p_entry;
+    Use( p_cache, p_entry );
+    p_cache->i_size += i_size;
+}
@@ -0,0 +1,91 @@
+/*****************************************************************************
+ * glyph_cache.h : Cache of loaded and rendered glyphs
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph cache
+ *
+ * Subtitles keep rendering the same few glyphs over and over. This caches
+ * the loaded (and possibly emboldened, slanted and stroked) outlines as well
+ * as their rasterized bitmaps, so that layout only needs copies of them.
+ */
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include "freetype.h"
+
+/**
+ * Identifies a glyph outline. Faces are created for a given pixel size
+ * and are kept for the whole lifetime of the filter, so the face handle
+ * also stands for the size.
+ */
+typedef struct
+{
+    FT_Face     p_face;
+    FT_UInt     i_glyph_index;
+    int         i_flags;    /**< STYLE_BOLD/STYLE_ITALIC, when synthesized */
+    FT_Fixed    i_radius;   /**< stroker radius, for outline borders */
+} glyph_cache_key_t;
+
+enum glyph_cache_kind_e
+{
+    GLYPH_CACHE_GLYPH,          /**< outline glyph as loaded */
+    GLYPH_CACHE_BORDER,         /**< stroked border of the glyph */
+    GLYPH_CACHE_GLYPH_BITMAP,   /**< rasterized glyph */
+    GLYPH_CACHE_BORDER_BITMAP,  /**< rasterized border */
+};
+
+/**
+ * Creates a glyph cache.
+ *
+ * \param i_max_size maximum amount of glyph data to keep, in bytes
+ */
+glyph_cache_t *GlyphCacheNew( size_t i_max_size );
+
+/**
+ * Destroys a glyph cache, printing its statistics.
+ */
+void GlyphCacheDelete( vlc_object_t *p_obj, glyph_cache_t *p_cache );
+
+/**
+ * Looks up a glyph.
+ *
+ * Bitmaps depend on the subpixel part of the origin they are rendered at,
+ * which is part of the key. Their position is adjusted to \p p_origin.
+ *
+ * \param p_origin rendering origin, for bitmap kinds [IN]
+ * \param p_advance advance of the glyph, for GLYPH_CACHE_GLYPH, or NULL [OUT]
+ * \return a copy of the cached glyph, owned by the caller, or NULL
+ */
+FT_Glyph GlyphCacheGet( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                        int i_kind, const FT_Vector *p_origin,
+                        FT_Vector *p_advance );
+
+/**
+ * Stores a copy of a glyph. \p p_origin is the origin a bitmap glyph was
+ * rendered at, and \p p_advance the advance of a GLYPH_CACHE_GLYPH.
+ */
+void GlyphCachePut( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                    int i_kind, const FT_Vector *p_origin,
+                    FT_Glyph p_glyph, const FT_Vector *p_advance );
+
+#endif
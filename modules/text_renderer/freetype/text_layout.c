@@ -65,6 +65,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "glyph_cache.h"
 
 /* Win32 */
 #ifdef _WIN32
@@ -132,6 +133,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t cache_key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -957,18 +959,27 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
         }
 
+        int i_synthetic_flags = 0;
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            i_synthetic_flags |= STYLE_BOLD;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            i_synthetic_flags |= STYLE_ITALIC;
+
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
         {
             int i_glyph_index;
@@ -1019,29 +1030,57 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            p_bitmaps->cache_key = (glyph_cache_key_t) {
+                .p_face = p_face,
+                .i_glyph_index = i_glyph_index,
+                .i_flags = i_synthetic_flags,
+                .i_radius = i_radius,
+            };
+
+            FT_Vector advance;
+            p_bitmaps->p_glyph = p_sys->p_glyph_cache ?
+                GlyphCacheGet( p_sys->p_glyph_cache, &p_bitmaps->cache_key,
+                               GLYPH_CACHE_GLYPH, NULL, &advance ) : NULL;
+            if( !p_bitmaps->p_glyph )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+                if( i_synthetic_flags & STYLE_BOLD )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( i_synthetic_flags & STYLE_ITALIC )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
+
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                advance = p_face->glyph->advance;
+                if( p_sys->p_glyph_cache )
+                    GlyphCachePut( p_sys->p_glyph_cache, &p_bitmaps->cache_key,
+                                   GLYPH_CACHE_GLYPH, NULL, p_bitmaps->p_glyph,
+                                   &advance );
+            }
 
 #undef SKIP_GLYPH
 
-            if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
+            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
             {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_filter->p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                p_bitmaps->p_outline = p_sys->p_glyph_cache ?
+                    GlyphCacheGet( p_sys->p_glyph_cache, &p_bitmaps->cache_key,
+                                   GLYPH_CACHE_BORDER, NULL, NULL ) : NULL;
+                if( !p_bitmaps->p_outline )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                    else if( p_sys->p_glyph_cache )
+                        GlyphCachePut( p_sys->p_glyph_cache,
+                                       &p_bitmaps->cache_key, GLYPH_CACHE_BORDER,
+                                       NULL, p_bitmaps->p_outline, NULL );
+                }
             }
 
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
@@ -1050,8 +1089,8 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
         }
 
@@ -1062,6 +1101,40 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
     return VLC_SUCCESS;
 }
 
+/**
+ * Same as FT_Glyph_To_Bitmap(), going through the glyph cache if enabled.
+ */
+static FT_Error RenderGlyph( filter_t *p_filter, const glyph_bitmaps_t *p_bitmaps,
+                             FT_Glyph *pp_glyph, int i_kind,
+                             FT_Vector *p_origin, FT_Bool b_destroy )
+{
+    glyph_cache_t *p_cache = p_filter->p_sys->p_glyph_cache;
+
+    /* Embedded bitmaps are not rendered, nor moved to the origin */
+    if( (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+        p_cache = NULL;
+
+    if( p_cache )
+    {
+        FT_Glyph p_bitmap = GlyphCacheGet( p_cache, &p_bitmaps->cache_key,
+                                           i_kind, p_origin, NULL );
+        if( p_bitmap )
+        {
+            if( b_destroy )
+                FT_Done_Glyph( *pp_glyph );
+            *pp_glyph = p_bitmap;
+            return 0;
+        }
+    }
+
+    FT_Error i_error = FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                           p_origin, b_destroy );
+    if( !i_error && p_cache )
+        GlyphCachePut( p_cache, &p_bitmaps->cache_key, i_kind, p_origin,
+                       *pp_glyph, NULL );
+    return i_error;
+}
+
 static int LayoutLine( filter_t *p_filter,
                        paragraph_t *p_paragraph,
                        int i_start_offset, int i_end_offset,
@@ -1152,8 +1225,10 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            int i_kind = p_bitmaps->p_shadow == p_bitmaps->p_outline ?
+                         GLYPH_CACHE_BORDER_BITMAP : GLYPH_CACHE_GLYPH_BITMAP;
+            if( RenderGlyph( p_filter, p_bitmaps, &p_bitmaps->p_shadow, i_kind,
+                             &pen_shadow, 0 ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1161,8 +1236,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, p_bitmaps, &p_bitmaps->p_glyph,
+                             GLYPH_CACHE_GLYPH_BITMAP, &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1178,8 +1253,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, p_bitmaps, &p_bitmaps->p_outline,
+                             GLYPH_CACHE_BORDER_BITMAP, &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
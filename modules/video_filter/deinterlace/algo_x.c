@@ -34,8 +34,10 @@
 #include <vlc_common.h>
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 
 #include "deinterlace.h" /* filter_sys_t */
+#include "slices.h"
 
 #include "algo_x.h"
 
@@ -537,8 +539,18 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-void RenderX( picture_t *p_outpic, picture_t *p_pic )
+typedef struct
 {
+    picture_t *p_outpic;
+    picture_t *p_pic;
+} x_slice_t;
+
+/* Renders a band of 8 lines high blocks of every plane. */
+static void RenderXSlice( void *p_data, int i_slice, int i_slices )
+{
+    const x_slice_t *p_ctx = p_data;
+    picture_t *p_outpic = p_ctx->p_outpic;
+    picture_t *p_pic = p_ctx->p_pic;
     int i_plane;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
@@ -556,9 +568,12 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
         const int i_dst = p_outpic->p[i_plane].i_pitch;
         const int i_src = p_pic->p[i_plane].i_pitch;
 
+        const int i_mby_start = SliceStart( i_mby, i_slice, i_slices );
+        const int i_mby_end = SliceStart( i_mby, i_slice + 1, i_slices );
+
         int y, x;
 
-        for( y = 0; y < i_mby; y++ )
+        for( y = i_mby_start; y < i_mby_end; y++ )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -571,8 +586,8 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
                 XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
         }
 
-        /* Last line (C only)*/
-        if( i_mody )
+        /* Last line (C only), with the last band */
+        if( i_mody && i_slice == i_slices - 1 )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -595,3 +610,12 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
         emms();
 #endif
 }
+
+void RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    x_slice_t ctx = {
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+    };
+    SlicesRun( p_filter->p_sys->p_slices, RenderXSlice, &ctx );
+}
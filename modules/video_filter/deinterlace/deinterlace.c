@@ -85,6 +85,11 @@
                                     "Best simulation, but requires more CPU "\
                                     "and memory bandwidth.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads rendering each frame with " \
+                            "the X and Yadif algorithms, in horizontal " \
+                            "bands. 0 uses one thread per CPU, up to 16.")
+
 #define PHOSPHOR_DIMMER_TEXT N_("Phosphor old field dimmer strength")
 #define PHOSPHOR_DIMMER_LONGTEXT N_("This controls the strength of the "\
                                     "darkening filter that simulates CRT TV "\
@@ -111,6 +116,8 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "threads", 0, 0, SLICES_MAX_THREADS,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -126,7 +133,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -438,6 +445,7 @@ picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
     assert( i_nb_fields > 2  ||  p_dst[2] == NULL );
 
     /* Render */
+    const mtime_t i_render_start = mdate();
     switch( p_sys->i_mode )
     {
         case DEINTERLACE_DISCARD:
@@ -469,7 +477,7 @@ picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
             break;
 
         case DEINTERLACE_X:
-            RenderX( p_dst[0], p_pic );
+            RenderX( p_filter, p_dst[0], p_pic );
             break;
 
         case DEINTERLACE_YADIF:
@@ -505,6 +513,10 @@ picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
                 goto drop;
             break;
     }
+    const mtime_t i_render_time = mdate() - i_render_start;
+    p_sys->i_render_time += i_render_time;
+    p_sys->i_render_count++;
+    var_SetInteger( p_filter, "deinterlace-render-time", i_render_time );
 
     /* Set output timestamps, if the algorithm didn't request CUSTOM_PTS
        for this frame. */
@@ -663,6 +675,22 @@ notsupp:
 
     IVTCClearState( p_filter );
 
+    p_sys->p_slices = NULL;
+    p_sys->i_render_time = 0;
+    p_sys->i_render_count = 0;
+    /* Rendering time of the last frame, in microseconds */
+    var_Create( p_filter, "deinterlace-render-time", VLC_VAR_INTEGER );
+    if( p_sys->i_mode == DEINTERLACE_X || p_sys->i_mode == DEINTERLACE_YADIF
+     || p_sys->i_mode == DEINTERLACE_YADIF2X )
+    {
+        int i_threads = var_InheritInteger( p_filter,
+                                            FILTER_CFG_PREFIX "threads" );
+        if( i_threads <= 0 )
+            i_threads = vlc_GetCPUCount();
+        p_sys->p_slices = SlicesNew( p_this,
+                                     __MIN( i_threads, SLICES_MAX_THREADS ) );
+    }
+
 #if defined(CAN_COMPILE_C_ALTIVEC)
     if( pixel_size == 1 && vlc_CPU_ALTIVEC() )
         p_sys->pf_merge = MergeAltivec;
@@ -772,7 +800,14 @@ notsupp:
 void Close( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->i_render_count > 0 )
+        msg_Dbg( p_filter, "rendered %u frames, %"PRId64" us per frame",
+                 p_sys->i_render_count,
+                 p_sys->i_render_time / p_sys->i_render_count );
 
     Flush( p_filter );
-    free( p_filter->p_sys );
+    SlicesDelete( p_sys->p_slices );
+    free( p_sys );
 }
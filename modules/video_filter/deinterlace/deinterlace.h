@@ -42,6 +42,7 @@ struct vlc_object_t;
 #include "algo_yadif.h"
 #include "algo_phosphor.h"
 #include "algo_ivtc.h"
+#include "slices.h"
 
 /*****************************************************************************
  * Local data
@@ -121,6 +122,13 @@ struct filter_sys_t
     /* Algorithm-specific substructures */
     phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
     ivtc_sys_t ivtc;         /**< IVTC algorithm state. */
+
+    /** Worker pool for slice-parallel algorithms, NULL if single-threaded */
+    deint_slices_t *p_slices;
+
+    /* Rendering time statistics, reported when closing */
+    mtime_t  i_render_time;
+    unsigned i_render_count;
 };
 
 /*****************************************************************************
@@ -0,0 +1,182 @@
+/*****************************************************************************
+ * slices.c : Slice-parallel rendering for the vlc deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <stdint.h>
+
+#include <vlc_common.h>
+
+#include "slices.h"
+
+struct deint_slices_t
+{
+    vlc_mutex_t    lock;
+    vlc_cond_t     wait;        /**< signaled when a frame is submitted */
+    vlc_cond_t     done;        /**< signaled when the last band is done */
+
+    vlc_thread_t  *p_threads;
+    int            i_threads;   /**< worker threads, without the caller */
+
+    /* Current frame */
+    deint_slice_cb pf_slice;
+    void          *p_data;
+    int            i_slices;
+    int            i_next;      /**< next band to render */
+    int            i_pending;   /**< bands not rendered yet */
+    unsigned       i_frame;     /**< frame counter, wakes the workers up */
+
+    bool           b_quit;
+};
+
+/**
+ * Renders the remaining bands of the current frame.
+ * Called with the lock held.
+ */
+static void RenderBands( deint_slices_t *p_slices )
+{
+    while( p_slices->i_next < p_slices->i_slices )
+    {
+        const int i_slice = p_slices->i_next++;
+
+        vlc_mutex_unlock( &p_slices->lock );
+        p_slices->pf_slice( p_slices->p_data, i_slice, p_slices->i_slices );
+        vlc_mutex_lock( &p_slices->lock );
+
+        if( --p_slices->i_pending == 0 )
+            vlc_cond_signal( &p_slices->done );
+    }
+}
+
+static void *Thread( void *p_data )
+{
+    deint_slices_t *p_slices = p_data;
+    unsigned i_frame = 0;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        while( !p_slices->b_quit && i_frame == p_slices->i_frame )
+            vlc_cond_wait( &p_slices->wait, &p_slices->lock );
+        if( p_slices->b_quit )
+            break;
+
+        i_frame = p_slices->i_frame;
+        RenderBands( p_slices );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+
+    return NULL;
+}
+
+deint_slices_t *SlicesNew( vlc_object_t *p_obj, int i_threads )
+{
+    if( i_threads < 2 )
+        return NULL;
+
+    deint_slices_t *p_slices = malloc( sizeof( *p_slices ) );
+    if( !p_slices )
+        return NULL;
+
+    p_slices->p_threads = calloc( i_threads - 1,
+                                  sizeof( *p_slices->p_threads ) );
+    if( !p_slices->p_threads )
+    {
+        free( p_slices );
+        return NULL;
+    }
+
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait );
+    vlc_cond_init( &p_slices->done );
+    p_slices->i_slices = 0;
+    p_slices->i_next = 0;
+    p_slices->i_pending = 0;
+    p_slices->i_frame = 0;
+    p_slices->b_quit = false;
+
+    p_slices->i_threads = 0;
+    while( p_slices->i_threads < i_threads - 1 )
+    {
+        if( vlc_clone( &p_slices->p_threads[p_slices->i_threads], Thread,
+                       p_slices, VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            msg_Warn( p_obj, "cannot start rendering thread %d",
+                      p_slices->i_threads + 1 );
+            break;
+        }
+        p_slices->i_threads++;
+    }
+
+    if( p_slices->i_threads == 0 )
+    {
+        SlicesDelete( p_slices );
+        return NULL;
+    }
+
+    msg_Dbg( p_obj, "rendering with %d threads", p_slices->i_threads + 1 );
+    return p_slices;
+}
+
+void SlicesDelete( deint_slices_t *p_slices )
+{
+    if( !p_slices )
+        return;
+
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->b_quit = true;
+    vlc_cond_broadcast( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( int i = 0; i < p_slices->i_threads; i++ )
+        vlc_join( p_slices->p_threads[i], NULL );
+
+    vlc_cond_destroy( &p_slices->done );
+    vlc_cond_destroy( &p_slices->wait );
+    vlc_mutex_destroy( &p_slices->lock );
+    free( p_slices->p_threads );
+    free( p_slices );
+}
+
+void SlicesRun( deint_slices_t *p_slices, deint_slice_cb pf_slice,
+                void *p_data )
+{
+    if( !p_slices )
+    {
+        pf_slice( p_data, 0, 1 );
+        return;
+    }
+
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->pf_slice = pf_slice;
+    p_slices->p_data = p_data;
+    p_slices->i_slices = p_slices->i_threads + 1;
+    p_slices->i_next = 0;
+    p_slices->i_pending = p_slices->i_slices;
+    p_slices->i_frame++;
+    vlc_cond_broadcast( &p_slices->wait );
+
+    RenderBands( p_slices );
+    while( p_slices->i_pending > 0 )
+        vlc_cond_wait( &p_slices->done, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+}
@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * slices.h : Slice-parallel rendering for the vlc deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEINTERLACE_SLICES_H
+#define VLC_DEINTERLACE_SLICES_H 1
+
+/**
+ * \file
+ * Small worker pool rendering horizontal bands of a frame in parallel.
+ *
+ * Algorithms which only read their input pictures and write each output
+ * line once can split the frame into bands and render them independently.
+ */
+
+/* Forward declarations */
+struct vlc_object_t;
+
+typedef struct deint_slices_t deint_slices_t;
+
+/** Most threads rendering a frame */
+#define SLICES_MAX_THREADS 16
+
+/**
+ * Renders band i_slice out of i_slices.
+ *
+ * @see SliceStart()
+ */
+typedef void (*deint_slice_cb)( void *p_data, int i_slice, int i_slices );
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * Starts a worker pool.
+ *
+ * @param p_obj Object used for logging and thread creation.
+ * @param i_threads Number of threads rendering a frame, including the caller.
+ * @return The pool, or NULL if i_threads is below 2 or nothing could
+ *         be started. A NULL pool renders in the calling thread.
+ */
+deint_slices_t *SlicesNew( vlc_object_t *p_obj, int i_threads );
+
+/**
+ * Stops the worker threads and frees the pool. Accepts NULL.
+ */
+void SlicesDelete( deint_slices_t *p_slices );
+
+/**
+ * Renders all the bands of a frame, using the worker threads and the
+ * calling thread, and returns once all of them are done.
+ *
+ * @param p_slices The pool, or NULL to render a single band in place.
+ */
+void SlicesRun( deint_slices_t *p_slices, deint_slice_cb pf_slice,
+                void *p_data );
+
+/**
+ * Returns the first of the i_lines lines (or rows of blocks) rendered by
+ * band i_slice out of i_slices. The band ends where band i_slice + 1 starts.
+ */
+static inline int SliceStart( int i_lines, int i_slice, int i_slices )
+{
+    return (int64_t)i_lines * i_slice / i_slices;
+}
+
+#endif
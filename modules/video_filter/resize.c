@@ -0,0 +1,636 @@
+/*****************************************************************************
+ * resize.c: video scaling module for planar YUV and packed RGB pictures
+ *  Uses separable bilinear or bicubic interpolation.
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+# include <arm_neon.h>
+# define CAN_COMPILE_NEON_INTRINSICS
+#endif
+
+/****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static int  OpenFilter ( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define METHOD_TEXT N_("Interpolation method")
+#define METHOD_LONGTEXT N_( \
+    "Bicubic interpolation is sharper, bilinear interpolation is faster." )
+
+static const char *const method_list[] = { "bilinear", "bicubic" };
+static const char *const method_list_text[] = { N_("Bilinear"), N_("Bicubic") };
+
+vlc_module_begin ()
+    set_description( N_("Bilinear and bicubic video scaling filter") )
+    set_shortname( N_("Resize") )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter2", 20 )
+    add_string( "resize-method", "bilinear", METHOD_TEXT, METHOD_LONGTEXT,
+                true )
+        change_string_list( method_list, method_list_text )
+    set_callbacks( OpenFilter, CloseFilter )
+vlc_module_end ()
+
+/* Coefficients are 2.14 fixed point. The vertical pass keeps 6 fractional
+ * bits in 16-bit intermediate samples, the horizontal pass drops them. */
+#define COEF_BITS 14
+#define V_SHIFT   (COEF_BITS - 6)
+#define H_SHIFT   (COEF_BITS + 6)
+
+/* Filter of one dimension of one plane */
+typedef struct
+{
+    unsigned  i_src;
+    unsigned  i_dst;
+    unsigned  i_taps;
+    unsigned  i_stride;  /* coefficients per destination sample, padded */
+    int      *pi_start;  /* first source sample of every destination sample */
+    int16_t  *pi_coef;
+} resize_table_t;
+
+typedef void (*resize_vertical_t)( int16_t *, const uint8_t *const *,
+                                   const int16_t *, unsigned, unsigned );
+typedef void (*resize_horizontal_t)( uint8_t *, const int16_t *,
+                                     const resize_table_t *, unsigned );
+
+struct filter_sys_t
+{
+    double (*pf_kernel)( double );
+    double f_radius;
+
+    resize_table_t h[PICTURE_PLANE_MAX];
+    resize_table_t v[PICTURE_PLANE_MAX];
+
+    resize_vertical_t   pf_vertical;
+    resize_horizontal_t pf_horizontal;
+
+    int16_t        *p_line;
+    size_t          i_line;
+    const uint8_t **pp_rows;
+    size_t          i_rows;
+};
+
+static const vlc_fourcc_t pi_chromas[] = {
+    VLC_CODEC_I410, VLC_CODEC_I411, VLC_CODEC_I420, VLC_CODEC_J420,
+    VLC_CODEC_YV12, VLC_CODEC_I422, VLC_CODEC_J422, VLC_CODEC_I440,
+    VLC_CODEC_J440, VLC_CODEC_I444, VLC_CODEC_J444, VLC_CODEC_YUVA,
+    VLC_CODEC_GREY, VLC_CODEC_RGB24, VLC_CODEC_RGB32, VLC_CODEC_RGBA,
+    VLC_CODEC_ARGB, VLC_CODEC_BGRA, 0
+};
+
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************/
+static double KernelBilinear( double x )
+{
+    x = fabs( x );
+    return x < 1. ? 1. - x : 0.;
+}
+
+/* Keys cubic convolution, a = -0.5 */
+static double KernelBicubic( double x )
+{
+    x = fabs( x );
+    if( x < 1. )
+        return ( 1.5 * x - 2.5 ) * x * x + 1.;
+    if( x < 2. )
+        return ( ( -0.5 * x + 2.5 ) * x - 4. ) * x + 2.;
+    return 0.;
+}
+
+static void TableClean( resize_table_t *p_table )
+{
+    free( p_table->pi_start );
+    free( p_table->pi_coef );
+    memset( p_table, 0, sizeof(*p_table) );
+}
+
+/* Computes the taps of every destination sample. The kernel is stretched
+ * when downscaling so that every source sample contributes. Taps falling
+ * outside of the source are folded onto the edges. */
+static int TableInit( filter_sys_t *p_sys, resize_table_t *p_table,
+                      unsigned i_src, unsigned i_dst )
+{
+    if( p_table->i_src == i_src && p_table->i_dst == i_dst )
+        return VLC_SUCCESS;
+    TableClean( p_table );
+
+    const double f_scale = (double)i_src / i_dst;
+    const double f_support = f_scale > 1. ? f_scale : 1.;
+    const int i_half = ceil( p_sys->f_radius * f_support );
+    unsigned i_taps = __MIN( 2 * (unsigned)i_half, i_src );
+    unsigned i_stride = ( i_taps + 7 ) & ~7;
+
+    p_table->pi_start = malloc( i_dst * sizeof(*p_table->pi_start) );
+    p_table->pi_coef = calloc( i_dst * i_stride, sizeof(*p_table->pi_coef) );
+    double *pf_weight = malloc( i_taps * sizeof(*pf_weight) );
+    if( !p_table->pi_start || !p_table->pi_coef || !pf_weight )
+    {
+        free( pf_weight );
+        TableClean( p_table );
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned i = 0; i < i_dst; i++ )
+    {
+        const double f_center = ( i + .5 ) * f_scale - .5;
+        const int i_first = floor( f_center ) - i_half + 1;
+        const int i_start = VLC_CLIP( i_first, 0, (int)(i_src - i_taps) );
+        double f_sum = 0.;
+
+        for( unsigned k = 0; k < i_taps; k++ )
+            pf_weight[k] = 0.;
+        for( int k = 0; k < 2 * i_half; k++ )
+        {
+            const int i_pos = VLC_CLIP( i_first + k, 0, (int)i_src - 1 );
+            const double f_weight =
+                p_sys->pf_kernel( ( i_first + k - f_center ) / f_support );
+            pf_weight[i_pos - i_start] += f_weight;
+            f_sum += f_weight;
+        }
+
+        /* Quantize, and put the rounding error on the largest tap */
+        int16_t *pi_coef = &p_table->pi_coef[i * i_stride];
+        int i_total = 0;
+        unsigned i_max = 0;
+        for( unsigned k = 0; k < i_taps; k++ )
+        {
+            pi_coef[k] = lround( pf_weight[k] / f_sum * ( 1 << COEF_BITS ) );
+            i_total += pi_coef[k];
+            if( pi_coef[k] > pi_coef[i_max] )
+                i_max = k;
+        }
+        pi_coef[i_max] += ( 1 << COEF_BITS ) - i_total;
+        p_table->pi_start[i] = i_start;
+    }
+    free( pf_weight );
+
+    p_table->i_src = i_src;
+    p_table->i_dst = i_dst;
+    p_table->i_taps = i_taps;
+    p_table->i_stride = i_stride;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Vertical pass: i_width source samples of i_taps rows to one line
+ *****************************************************************************/
+static void VerticalTail( int16_t *p_line, const uint8_t *const *pp_rows,
+                          const int16_t *pi_coef, unsigned i_taps,
+                          unsigned i, unsigned i_width )
+{
+    for( ; i < i_width; i++ )
+    {
+        int i_sum = 1 << ( V_SHIFT - 1 );
+        for( unsigned k = 0; k < i_taps; k++ )
+            i_sum += pi_coef[k] * pp_rows[k][i];
+        p_line[i] = i_sum >> V_SHIFT;
+    }
+}
+
+static void VerticalC( int16_t *p_line, const uint8_t *const *pp_rows,
+                       const int16_t *pi_coef, unsigned i_taps,
+                       unsigned i_width )
+{
+    VerticalTail( p_line, pp_rows, pi_coef, i_taps, 0, i_width );
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* Taps are processed by pairs, with interleaved samples of two rows */
+__attribute__ ((__target__ ("sse2")))
+static void VerticalSSE2( int16_t *p_line, const uint8_t *const *pp_rows,
+                          const int16_t *pi_coef, unsigned i_taps,
+                          unsigned i_width )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32( 1 << ( V_SHIFT - 1 ) );
+    unsigned i = 0;
+
+    for( ; i + 8 <= i_width; i += 8 )
+    {
+        __m128i lo = round, hi = round;
+        unsigned k = 0;
+
+        for( ; k + 2 <= i_taps; k += 2 )
+        {
+            const __m128i a = _mm_unpacklo_epi8(
+                _mm_loadl_epi64( (const __m128i *)&pp_rows[k][i] ), zero );
+            const __m128i b = _mm_unpacklo_epi8(
+                _mm_loadl_epi64( (const __m128i *)&pp_rows[k + 1][i] ), zero );
+            const __m128i c = _mm_set1_epi32( (uint16_t)pi_coef[k] |
+                                              ( (uint32_t)pi_coef[k + 1] << 16 ) );
+            lo = _mm_add_epi32( lo, _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), c ) );
+            hi = _mm_add_epi32( hi, _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), c ) );
+        }
+        if( k < i_taps )
+        {
+            const __m128i a = _mm_unpacklo_epi8(
+                _mm_loadl_epi64( (const __m128i *)&pp_rows[k][i] ), zero );
+            const __m128i c = _mm_set1_epi32( (uint16_t)pi_coef[k] );
+            lo = _mm_add_epi32( lo, _mm_madd_epi16( _mm_unpacklo_epi16( a, zero ), c ) );
+            hi = _mm_add_epi32( hi, _mm_madd_epi16( _mm_unpackhi_epi16( a, zero ), c ) );
+        }
+        lo = _mm_srai_epi32( lo, V_SHIFT );
+        hi = _mm_srai_epi32( hi, V_SHIFT );
+        _mm_storeu_si128( (__m128i *)&p_line[i], _mm_packs_epi32( lo, hi ) );
+    }
+    VerticalTail( p_line, pp_rows, pi_coef, i_taps, i, i_width );
+}
+
+/* Same as SSE2, 16 samples at a time. The 128-bit lanes are interleaved
+ * by the unpacks, and put back in order by the final pack. */
+__attribute__ ((__target__ ("avx2")))
+static void VerticalAVX2( int16_t *p_line, const uint8_t *const *pp_rows,
+                          const int16_t *pi_coef, unsigned i_taps,
+                          unsigned i_width )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32( 1 << ( V_SHIFT - 1 ) );
+    unsigned i = 0;
+
+    for( ; i + 16 <= i_width; i += 16 )
+    {
+        __m256i lo = round, hi = round;
+        unsigned k = 0;
+
+        for( ; k + 2 <= i_taps; k += 2 )
+        {
+            const __m256i a = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128( (const __m128i *)&pp_rows[k][i] ) );
+            const __m256i b = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128( (const __m128i *)&pp_rows[k + 1][i] ) );
+            const __m256i c = _mm256_set1_epi32( (uint16_t)pi_coef[k] |
+                                                 ( (uint32_t)pi_coef[k + 1] << 16 ) );
+            lo = _mm256_add_epi32( lo, _mm256_madd_epi16( _mm256_unpacklo_epi16( a, b ), c ) );
+            hi = _mm256_add_epi32( hi, _mm256_madd_epi16( _mm256_unpackhi_epi16( a, b ), c ) );
+        }
+        if( k < i_taps )
+        {
+            const __m256i a = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128( (const __m128i *)&pp_rows[k][i] ) );
+            const __m256i c = _mm256_set1_epi32( (uint16_t)pi_coef[k] );
+            lo = _mm256_add_epi32( lo, _mm256_madd_epi16( _mm256_unpacklo_epi16( a, zero ), c ) );
+            hi = _mm256_add_epi32( hi, _mm256_madd_epi16( _mm256_unpackhi_epi16( a, zero ), c ) );
+        }
+        lo = _mm256_srai_epi32( lo, V_SHIFT );
+        hi = _mm256_srai_epi32( hi, V_SHIFT );
+        _mm256_storeu_si256( (__m256i *)&p_line[i], _mm256_packs_epi32( lo, hi ) );
+    }
+    VerticalTail( p_line, pp_rows, pi_coef, i_taps, i, i_width );
+}
+#endif
+
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+static void VerticalNEON( int16_t *p_line, const uint8_t *const *pp_rows,
+                          const int16_t *pi_coef, unsigned i_taps,
+                          unsigned i_width )
+{
+    unsigned i = 0;
+
+    for( ; i + 8 <= i_width; i += 8 )
+    {
+        int32x4_t lo = vdupq_n_s32( 1 << ( V_SHIFT - 1 ) ), hi = lo;
+
+        for( unsigned k = 0; k < i_taps; k++ )
+        {
+            const int16x8_t a =
+                vreinterpretq_s16_u16( vmovl_u8( vld1_u8( &pp_rows[k][i] ) ) );
+            lo = vmlal_n_s16( lo, vget_low_s16( a ), pi_coef[k] );
+            hi = vmlal_n_s16( hi, vget_high_s16( a ), pi_coef[k] );
+        }
+        vst1q_s16( &p_line[i], vcombine_s16( vqshrn_n_s32( lo, V_SHIFT ),
+                                             vqshrn_n_s32( hi, V_SHIFT ) ) );
+    }
+    VerticalTail( p_line, pp_rows, pi_coef, i_taps, i, i_width );
+}
+#endif
+
+/*****************************************************************************
+ * Horizontal pass: one line to i_dst destination pixels
+ *****************************************************************************/
+static void HorizontalC( uint8_t *p_dst, const int16_t *p_line,
+                         const resize_table_t *p_table, unsigned i_pixel )
+{
+    for( unsigned i = 0; i < p_table->i_dst; i++ )
+    {
+        const int16_t *p_src = &p_line[p_table->pi_start[i] * i_pixel];
+        const int16_t *pi_coef = &p_table->pi_coef[i * p_table->i_stride];
+
+        for( unsigned c = 0; c < i_pixel; c++ )
+        {
+            int i_sum = 1 << ( H_SHIFT - 1 );
+            for( unsigned k = 0; k < p_table->i_taps; k++ )
+                i_sum += pi_coef[k] * p_src[k * i_pixel + c];
+            p_dst[i * i_pixel + c] = VLC_CLIP( i_sum >> H_SHIFT, 0, 255 );
+        }
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* Single component planes: one multiply-add per 8 taps and pixel, then the
+ * partial sums of 4 pixels are transposed and added together. */
+__attribute__ ((__target__ ("sse2")))
+static void HorizontalPlaneSSE2( uint8_t *p_dst, const int16_t *p_line,
+                                 const resize_table_t *p_table )
+{
+    const __m128i round = _mm_set1_epi32( 1 << ( H_SHIFT - 1 ) );
+    const unsigned i_stride = p_table->i_stride;
+    unsigned i = 0;
+
+    for( ; i + 4 <= p_table->i_dst; i += 4 )
+    {
+        __m128i p[4];
+        for( unsigned j = 0; j < 4; j++ )
+        {
+            const int16_t *p_src = &p_line[p_table->pi_start[i + j]];
+            const int16_t *pi_coef = &p_table->pi_coef[(i + j) * i_stride];
+
+            p[j] = _mm_madd_epi16( _mm_loadu_si128( (const __m128i *)p_src ),
+                                   _mm_loadu_si128( (const __m128i *)pi_coef ) );
+            for( unsigned k = 8; k < i_stride; k += 8 )
+                p[j] = _mm_add_epi32( p[j], _mm_madd_epi16(
+                    _mm_loadu_si128( (const __m128i *)&p_src[k] ),
+                    _mm_loadu_si128( (const __m128i *)&pi_coef[k] ) ) );
+        }
+
+        const __m128i t0 = _mm_add_epi32( _mm_unpacklo_epi32( p[0], p[1] ),
+                                          _mm_unpackhi_epi32( p[0], p[1] ) );
+        const __m128i t1 = _mm_add_epi32( _mm_unpacklo_epi32( p[2], p[3] ),
+                                          _mm_unpackhi_epi32( p[2], p[3] ) );
+        __m128i sum = _mm_add_epi32( _mm_unpacklo_epi64( t0, t1 ),
+                                     _mm_unpackhi_epi64( t0, t1 ) );
+        sum = _mm_srai_epi32( _mm_add_epi32( sum, round ), H_SHIFT );
+        sum = _mm_packs_epi32( sum, sum );
+        sum = _mm_packus_epi16( sum, sum );
+        const uint32_t i_out = _mm_cvtsi128_si32( sum );
+        memcpy( &p_dst[i], &i_out, 4 );
+    }
+
+    for( ; i < p_table->i_dst; i++ )
+    {
+        const int16_t *p_src = &p_line[p_table->pi_start[i]];
+        const int16_t *pi_coef = &p_table->pi_coef[i * i_stride];
+        int i_sum = 1 << ( H_SHIFT - 1 );
+        for( unsigned k = 0; k < p_table->i_taps; k++ )
+            i_sum += pi_coef[k] * p_src[k];
+        p_dst[i] = VLC_CLIP( i_sum >> H_SHIFT, 0, 255 );
+    }
+}
+
+/* Packed RGB of 3 or 4 bytes per pixel: the components of two neighbouring
+ * taps are interleaved, so that one multiply-add sums both for all four
+ * components. With 3 bytes, the fourth lane holds the next pixel and is
+ * not stored. */
+__attribute__ ((__target__ ("sse2")))
+static void HorizontalPackedSSE2( uint8_t *p_dst, const int16_t *p_line,
+                                  const resize_table_t *p_table,
+                                  unsigned i_pixel )
+{
+    const __m128i round = _mm_set1_epi32( 1 << ( H_SHIFT - 1 ) );
+
+    for( unsigned i = 0; i < p_table->i_dst; i++ )
+    {
+        const int16_t *p_src = &p_line[p_table->pi_start[i] * i_pixel];
+        const int16_t *pi_coef = &p_table->pi_coef[i * p_table->i_stride];
+        __m128i sum = round;
+
+        /* An odd number of taps reads one pixel past the last tap, with a
+         * zero coefficient, which the line padding allows for */
+        for( unsigned k = 0; k < p_table->i_taps; k += 2 )
+        {
+            const __m128i px = _mm_unpacklo_epi16(
+                _mm_loadl_epi64( (const __m128i *)&p_src[k * i_pixel] ),
+                _mm_loadl_epi64( (const __m128i *)&p_src[(k + 1) * i_pixel] ) );
+            int32_t i_coefs;
+            memcpy( &i_coefs, &pi_coef[k], 4 );
+            sum = _mm_add_epi32( sum, _mm_madd_epi16( px,
+                                                      _mm_set1_epi32( i_coefs ) ) );
+        }
+
+        sum = _mm_srai_epi32( sum, H_SHIFT );
+        sum = _mm_packs_epi32( sum, sum );
+        sum = _mm_packus_epi16( sum, sum );
+        const uint32_t i_out = _mm_cvtsi128_si32( sum );
+        memcpy( &p_dst[i * i_pixel], &i_out, i_pixel );
+    }
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void HorizontalSSE2( uint8_t *p_dst, const int16_t *p_line,
+                            const resize_table_t *p_table, unsigned i_pixel )
+{
+    if( i_pixel == 1 )
+        HorizontalPlaneSSE2( p_dst, p_line, p_table );
+    else if( i_pixel == 3 || i_pixel == 4 )
+        HorizontalPackedSSE2( p_dst, p_line, p_table, i_pixel );
+    else
+        HorizontalC( p_dst, p_line, p_table, i_pixel );
+}
+#endif
+
+/*****************************************************************************
+ * OpenFilter: probe the filter and return score
+ *****************************************************************************/
+static int OpenFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys;
+    unsigned i;
+
+    for( i = 0; pi_chromas[i]; i++ )
+        if( p_filter->fmt_in.video.i_chroma == pi_chromas[i] )
+            break;
+    if( !pi_chromas[i] ||
+        p_filter->fmt_in.video.i_chroma != p_filter->fmt_out.video.i_chroma )
+        return VLC_EGENERIC;
+
+    if( p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation )
+        return VLC_EGENERIC;
+
+    p_sys = p_filter->p_sys = calloc( 1, sizeof(*p_sys) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    char *psz_method = var_InheritString( p_filter, "resize-method" );
+    if( psz_method && !strcmp( psz_method, "bicubic" ) )
+    {
+        p_sys->pf_kernel = KernelBicubic;
+        p_sys->f_radius = 2.;
+    }
+    else
+    {
+        p_sys->pf_kernel = KernelBilinear;
+        p_sys->f_radius = 1.;
+    }
+
+    p_sys->pf_vertical = VerticalC;
+    p_sys->pf_horizontal = HorizontalC;
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+    {
+        p_sys->pf_vertical = VerticalSSE2;
+        p_sys->pf_horizontal = HorizontalSSE2;
+    }
+    if( vlc_CPU_AVX2() )
+        p_sys->pf_vertical = VerticalAVX2;
+#endif
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    p_sys->pf_vertical = VerticalNEON;
+#endif
+
+    video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
+    p_filter->pf_video_filter = Filter;
+
+    msg_Dbg( p_filter, "%ix%i -> %ix%i (%s)", p_filter->fmt_in.video.i_width,
+             p_filter->fmt_in.video.i_height, p_filter->fmt_out.video.i_width,
+             p_filter->fmt_out.video.i_height,
+             psz_method ? psz_method : "bilinear" );
+    free( psz_method );
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * CloseFilter: clean up the filter
+ *****************************************************************************/
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( unsigned i = 0; i < PICTURE_PLANE_MAX; i++ )
+    {
+        TableClean( &p_sys->h[i] );
+        TableClean( &p_sys->v[i] );
+    }
+    free( p_sys->p_line );
+    free( p_sys->pp_rows );
+    free( p_sys );
+}
+
+static int ResizePlane( filter_sys_t *p_sys, unsigned i_plane,
+                        plane_t *p_dst, const plane_t *p_src )
+{
+    const unsigned i_pixel = p_src->i_pixel_pitch;
+    const unsigned i_src_width = p_src->i_visible_pitch / i_pixel;
+    const unsigned i_dst_width = p_dst->i_visible_pitch / i_pixel;
+    resize_table_t *h = &p_sys->h[i_plane];
+    resize_table_t *v = &p_sys->v[i_plane];
+
+    if( !i_src_width || !i_dst_width ||
+        !p_src->i_visible_lines || !p_dst->i_visible_lines )
+        return VLC_EGENERIC;
+
+    if( TableInit( p_sys, h, i_src_width, i_dst_width ) ||
+        TableInit( p_sys, v, p_src->i_visible_lines, p_dst->i_visible_lines ) )
+        return VLC_ENOMEM;
+
+    /* The SIMD horizontal pass reads a whole stride past every start */
+    const size_t i_line = i_src_width * i_pixel + h->i_stride;
+    if( i_line > p_sys->i_line )
+    {
+        free( p_sys->p_line );
+        p_sys->p_line = calloc( i_line, sizeof(*p_sys->p_line) );
+        p_sys->i_line = p_sys->p_line ? i_line : 0;
+        if( !p_sys->p_line )
+            return VLC_ENOMEM;
+    }
+    if( v->i_taps > p_sys->i_rows )
+    {
+        free( p_sys->pp_rows );
+        p_sys->pp_rows = malloc( v->i_taps * sizeof(*p_sys->pp_rows) );
+        p_sys->i_rows = p_sys->pp_rows ? v->i_taps : 0;
+        if( !p_sys->pp_rows )
+            return VLC_ENOMEM;
+    }
+
+    for( int y = 0; y < p_dst->i_visible_lines; y++ )
+    {
+        const uint8_t *p_first = &p_src->p_pixels[v->pi_start[y] * p_src->i_pitch];
+        for( unsigned k = 0; k < v->i_taps; k++ )
+            p_sys->pp_rows[k] = &p_first[k * p_src->i_pitch];
+
+        p_sys->pf_vertical( p_sys->p_line, p_sys->pp_rows,
+                            &v->pi_coef[y * v->i_stride], v->i_taps,
+                            i_src_width * i_pixel );
+        p_sys->pf_horizontal( &p_dst->p_pixels[y * p_dst->i_pitch],
+                              p_sys->p_line, h, i_pixel );
+    }
+    return VLC_SUCCESS;
+}
+
+/****************************************************************************
+ * Filter: the whole thing
+ ****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_pic_dst;
+
+    if( !p_pic ) return NULL;
+
+    video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
+
+    /* Request output picture */
+    p_pic_dst = filter_NewPicture( p_filter );
+    if( !p_pic_dst )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    for( int i_plane = 0; i_plane < p_pic_dst->i_planes; i_plane++ )
+    {
+        if( ResizePlane( p_sys, i_plane, &p_pic_dst->p[i_plane],
+                         &p_pic->p[i_plane] ) )
+        {
+            picture_Release( p_pic_dst );
+            picture_Release( p_pic );
+            return NULL;
+        }
+    }
+
+    picture_CopyProperties( p_pic_dst, p_pic );
+    picture_Release( p_pic );
+    return p_pic_dst;
+}
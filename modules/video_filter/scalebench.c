@@ -0,0 +1,261 @@
+/*****************************************************************************
+ * scalebench.c : scaling benchmark plugin for vlc
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_modules.h>
+
+#include <vlc_filter.h>
+#include <vlc_image.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Create( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+
+#define LOOPS_TEXT N_("Number of time to scale")
+#define LOOPS_LONGTEXT N_("The number of time the scaling will be performed")
+
+#define MODULES_TEXT N_("Scaling modules")
+#define MODULES_LONGTEXT N_("Colon-separated list of the scaling modules " \
+                            "to compare")
+
+#define IMAGE_TEXT N_("Image to be scaled")
+#define IMAGE_LONGTEXT N_("The image which will be scaled. The first video " \
+                          "picture is used if none is given")
+
+#define CHROMA_TEXT N_("Chroma for the image")
+#define CHROMA_LONGTEXT N_("Chroma which the image will be loaded in")
+
+#define WIDTH_TEXT N_("Destination width")
+#define WIDTH_LONGTEXT N_("Width of the scaled image")
+
+#define HEIGHT_TEXT N_("Destination height")
+#define HEIGHT_LONGTEXT N_("Height of the scaled image")
+
+#define CFG_PREFIX "scalebench-"
+
+vlc_module_begin ()
+    set_description( N_("Scaling benchmark filter") )
+    set_shortname( N_("Scalebench" ))
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter2", 0 )
+
+    set_section( N_("Benchmarking"), NULL )
+    add_integer( CFG_PREFIX "loops", 100, LOOPS_TEXT,
+              LOOPS_LONGTEXT, false )
+    add_string( CFG_PREFIX "modules", "resize:swscale:scale", MODULES_TEXT,
+              MODULES_LONGTEXT, false )
+
+    set_section( N_("Image"), NULL )
+    add_loadfile( CFG_PREFIX "image", NULL, IMAGE_TEXT,
+                  IMAGE_LONGTEXT, false )
+    add_string( CFG_PREFIX "chroma", "I420", CHROMA_TEXT,
+              CHROMA_LONGTEXT, false )
+    add_integer( CFG_PREFIX "width", 1280, WIDTH_TEXT,
+              WIDTH_LONGTEXT, false )
+    add_integer( CFG_PREFIX "height", 720, HEIGHT_TEXT,
+              HEIGHT_LONGTEXT, false )
+
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "loops", "modules", "image", "chroma", "width", "height", NULL
+};
+
+/*****************************************************************************
+ * filter_sys_t: filter method descriptor
+ *****************************************************************************/
+struct filter_sys_t
+{
+    bool b_done;
+    int i_loops;
+    unsigned i_width, i_height;
+    char *psz_modules;
+
+    picture_t *p_image;
+};
+
+static picture_t *scalebench_NewPicture( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+/*****************************************************************************
+ * Create: allocates video thread output method
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+    char *psz_temp, *psz_cmd;
+
+    /* Allocate structure */
+    p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_filter->p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys = p_filter->p_sys;
+    p_sys->b_done = false;
+    p_sys->p_image = NULL;
+
+    p_filter->pf_video_filter = Filter;
+
+    /* needed to get options passed in transcode using the
+     * scalebench{name=value} syntax */
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    p_sys->i_loops = var_CreateGetInteger( p_filter, CFG_PREFIX "loops" );
+    p_sys->i_width = var_CreateGetInteger( p_filter, CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetInteger( p_filter, CFG_PREFIX "height" );
+    p_sys->psz_modules = var_CreateGetString( p_filter, CFG_PREFIX "modules" );
+
+    psz_cmd = var_CreateGetNonEmptyString( p_filter, CFG_PREFIX "image" );
+    if( psz_cmd )
+    {
+        image_handler_t *p_image;
+        video_format_t fmt_in, fmt_out;
+
+        psz_temp = var_CreateGetString( p_filter, CFG_PREFIX "chroma" );
+        video_format_Init( &fmt_in, 0 );
+        video_format_Init( &fmt_out, vlc_fourcc_GetCodecFromString( VIDEO_ES,
+                                                                    psz_temp ) );
+        free( psz_temp );
+
+        p_image = image_HandlerCreate( p_this );
+        p_sys->p_image = image_ReadUrl( p_image, psz_cmd, &fmt_in, &fmt_out );
+        image_HandlerDelete( p_image );
+        free( psz_cmd );
+
+        if( p_sys->p_image == NULL )
+        {
+            msg_Err( p_filter, "Unable to load image" );
+            free( p_sys->psz_modules );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+    }
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy video thread output method
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_image )
+        picture_Release( p_sys->p_image );
+    free( p_sys->psz_modules );
+    free( p_sys );
+}
+
+static void scalebench_Run( filter_t *p_filter, const char *psz_module,
+                            picture_t *p_image )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_scale;
+
+    p_scale = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_scale )
+        return;
+
+    es_format_Init( &p_scale->fmt_in, VIDEO_ES, p_image->format.i_chroma );
+    p_scale->fmt_in.video = p_image->format;
+    es_format_Init( &p_scale->fmt_out, VIDEO_ES, p_image->format.i_chroma );
+    p_scale->fmt_out.video = p_image->format;
+    p_scale->fmt_out.video.i_width =
+    p_scale->fmt_out.video.i_visible_width = p_sys->i_width;
+    p_scale->fmt_out.video.i_height =
+    p_scale->fmt_out.video.i_visible_height = p_sys->i_height;
+    p_scale->owner.video.buffer_new = scalebench_NewPicture;
+
+    p_scale->p_module = module_need( p_scale, "video filter2", psz_module, true );
+    if( !p_scale->p_module )
+    {
+        msg_Warn( p_filter, "Unable to load %s", psz_module );
+        vlc_object_release( p_scale );
+        return;
+    }
+
+    mtime_t time = mdate();
+    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    {
+        picture_t *p_out = p_scale->pf_video_filter( p_scale,
+                                                     picture_Hold( p_image ) );
+        if( p_out )
+            picture_Release( p_out );
+    }
+    time = mdate() - time;
+
+    msg_Info( p_filter, "%s scaled %d images (%dx%d to %ux%u) in %f sec",
+              psz_module, p_sys->i_loops, p_image->format.i_width,
+              p_image->format.i_height, p_sys->i_width, p_sys->i_height,
+              time / 1000000.0f );
+    msg_Info( p_filter, "%s speed is: %f images/second, %f pixels/second",
+              psz_module, (float) p_sys->i_loops / time * 1000000,
+              (float) p_sys->i_loops / time * 1000000 *
+                  p_sys->i_width * p_sys->i_height );
+
+    module_unneed( p_scale, p_scale->p_module );
+    vlc_object_release( p_scale );
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done || !p_pic )
+        return p_pic;
+
+    picture_t *p_image = p_sys->p_image ? p_sys->p_image : p_pic;
+    char *psz_save;
+
+    for( char *psz_module = strtok_r( p_sys->psz_modules, ":", &psz_save );
+         psz_module != NULL; psz_module = strtok_r( NULL, ":", &psz_save ) )
+        scalebench_Run( p_filter, psz_module, p_image );
+
+    p_sys->b_done = true;
+    return p_pic;
+}
@@ -37,6 +37,10 @@
 #endif
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -151,6 +155,20 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Stored ahead of each block payload */
+typedef struct attribute_packed
+{
+    mtime_t  i_dts;
+    mtime_t  i_pts;
+    mtime_t  i_length;
+    uint32_t i_flags;
+    unsigned i_nb_samples;
+    size_t   i_buffer;
+} ts_block_header_t;
+
+/* Payloads from this size on are mapped rather than copied when read back */
+#define TS_STORAGE_MAP_MIN (16 * 1024)
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -164,6 +182,10 @@ struct ts_storage_t
     int64_t i_file_size;/* Current size in bytes */
     FILE    *p_filew;   /* FILE handle for data writing */
     FILE    *p_filer;   /* FILE handle for data reading */
+#ifdef HAVE_MMAP
+    int     fd;         /* Preallocated file, used instead of the FILE handles */
+    uint8_t *p_map;     /* Shared mapping of the whole file, or NULL */
+#endif
 
     /* */
     int      i_cmd_r;
@@ -179,11 +201,15 @@ typedef struct
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
     const char     *psz_tmp_path;
+    mtime_t        i_duration_max;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
 
+    /* Date of the latest command pushed */
+    mtime_t        i_last_date;
+
     /* */
     bool           b_paused;
     mtime_t        i_pause_date;
@@ -218,6 +244,7 @@ struct es_out_sys_t
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
+    mtime_t        i_duration_max;    /* Timeshift window, 0 if unbounded */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -250,6 +277,7 @@ static void         TsStop( ts_thread_t * );
 static void         TsPushCmd( ts_thread_t *, ts_cmd_t * );
 static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush );
 static bool         TsHasCmd( ts_thread_t * );
+static bool         TsIsExpiredLocked( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
@@ -261,6 +289,7 @@ static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
+static size_t       TsStorageCmdSize( const ts_cmd_t *p_cmd );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
 
@@ -334,6 +363,9 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    const int i_duration_max = var_InheritInteger( p_input, "input-timeshift-duration" );
+    p_sys->i_duration_max = __MAX( i_duration_max, 0 ) * CLOCK_FREQ;
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
     if( p_sys->psz_tmp_path == NULL )
@@ -781,6 +813,7 @@ static int TsStart( es_out_t *p_out )
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
+    p_ts->i_duration_max = p_sys->i_duration_max;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
     vlc_mutex_init( &p_ts->lock );
@@ -793,6 +826,7 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->i_last_date = -1;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
 
@@ -849,7 +883,9 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
     if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        /* A single command may be larger than the granularity */
+        const size_t i_size = __MAX( (size_t)p_ts->i_tmp_size_max, TsStorageCmdSize( p_cmd ) );
+        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, i_size );
 
         if( !p_storage )
         {
@@ -872,6 +908,7 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
     }
 
     /* TODO return error and warn the user (but only once) */
+    p_ts->i_last_date = p_cmd->i_date;
     TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
 
     vlc_cond_signal( &p_ts->wait );
@@ -909,6 +946,18 @@ static bool TsHasCmd( ts_thread_t *p_ts )
 
     return b_cmd;
 }
+/* Whether the next command fell out of the timeshift window */
+static bool TsIsExpiredLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    if( p_ts->i_duration_max <= 0 || TsStorageIsEmpty( p_ts->p_storage_r ) )
+        return false;
+
+    const ts_storage_t *p_storage = p_ts->p_storage_r;
+    const mtime_t i_date = p_storage->p_cmd[p_storage->i_cmd_r].i_date;
+    return p_ts->i_last_date - i_date > p_ts->i_duration_max;
+}
 static bool TsIsUnused( ts_thread_t *p_ts )
 {
     bool b_unused;
@@ -975,12 +1024,14 @@ static void *TsRun( void *p_data )
 {
     ts_thread_t *p_ts = p_data;
     mtime_t i_buffering_date = -1;
+    bool b_skipped = false;
 
     for( ;; )
     {
         ts_cmd_t cmd;
         mtime_t  i_deadline;
         bool b_buffering;
+        bool b_expired;
 
         /* Pop a command to execute */
         vlc_mutex_lock( &p_ts->lock );
@@ -990,8 +1041,12 @@ static void *TsRun( void *p_data )
         {
             const int canc = vlc_savecancel();
             b_buffering = es_out_GetBuffering( p_ts->p_out );
+            b_expired = TsIsExpiredLocked( p_ts );
 
-            if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
+            /* Expired commands are flushed even while paused, so that the
+             * storage stays within the timeshift window */
+            if( ( !p_ts->b_paused || b_buffering || b_expired ) &&
+                !TsPopCmdLocked( p_ts, &cmd, b_expired ) )
             {
                 vlc_restorecancel( canc );
                 break;
@@ -1001,6 +1056,20 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
+        if( b_expired )
+        {
+            b_skipped = true;
+        }
+        else if( b_skipped )
+        {
+            /* Resume right after the discarded part of the window */
+            p_ts->i_cmd_delay = mdate() - cmd.i_date;
+            p_ts->i_rate_date = -1;
+            p_ts->i_buffering_delay = 0;
+            i_buffering_date = -1;
+            b_skipped = false;
+        }
+
         if( b_buffering && i_buffering_date < 0 )
         {
             i_buffering_date = cmd.i_date;
@@ -1057,11 +1126,13 @@ static void *TsRun( void *p_data )
          * reading  */
         vlc_cleanup_push( cmd_cleanup_routine, &cmd );
 
-        mwait( i_deadline );
+        if( !b_expired )
+            mwait( i_deadline );
 
         vlc_cleanup_pop();
 
-        /* Execute the command  */
+        /* Execute the command, dropping data and clock references
+         * out of the timeshift window  */
         const int canc = vlc_savecancel();
         switch( cmd.i_type )
         {
@@ -1070,11 +1141,15 @@ static void *TsRun( void *p_data )
             CmdCleanAdd( &cmd );
             break;
         case C_SEND:
-            CmdExecuteSend( p_ts->p_out, &cmd );
+            if( !b_expired )
+                CmdExecuteSend( p_ts->p_out, &cmd );
             CmdCleanSend( &cmd );
             break;
         case C_CONTROL:
-            CmdExecuteControl( p_ts->p_out, &cmd );
+            if( !b_expired ||
+                ( cmd.u.control.i_query != ES_OUT_SET_PCR &&
+                  cmd.u.control.i_query != ES_OUT_SET_GROUP_PCR ) )
+                CmdExecuteControl( p_ts->p_out, &cmd );
             CmdCleanControl( &cmd );
             break;
         case C_DEL:
@@ -1093,6 +1168,24 @@ static void *TsRun( void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
+#ifdef HAVE_MMAP
+/* The whole file is allocated upfront, so that writing through the
+ * mapping cannot fault on a full disk */
+static uint8_t *TsStorageMap( int fd, size_t i_size )
+{
+#ifdef HAVE_POSIX_FALLOCATE
+    if( posix_fallocate( fd, 0, i_size ) )
+        return NULL;
+
+    void *p_map = mmap( NULL, i_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0 );
+    return p_map != MAP_FAILED ? p_map : NULL;
+#else
+    VLC_UNUSED(fd); VLC_UNUSED(i_size);
+    return NULL;
+#endif
+}
+#endif
+
 static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
 {
     ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
@@ -1107,20 +1200,29 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
 
-    p_storage->p_filew = fdopen( fd, "w+b" );
-    if( p_storage->p_filew == NULL )
+    p_storage->p_filew = NULL;
+    p_storage->p_filer = NULL;
+#ifdef HAVE_MMAP
+    p_storage->fd = fd;
+    p_storage->p_map = TsStorageMap( fd, i_tmp_size_max );
+    if( p_storage->p_map == NULL )
+#endif
     {
-        close( fd );
-        vlc_unlink( psz_file );
-        goto error;
-    }
+        p_storage->p_filew = fdopen( fd, "w+b" );
+        if( p_storage->p_filew == NULL )
+        {
+            close( fd );
+            vlc_unlink( psz_file );
+            goto error;
+        }
 
-    p_storage->p_filer = vlc_fopen( psz_file, "rb" );
-    if( p_storage->p_filer == NULL )
-    {
-        fclose( p_storage->p_filew );
-        vlc_unlink( psz_file );
-        goto error;
+        p_storage->p_filer = vlc_fopen( psz_file, "rb" );
+        if( p_storage->p_filer == NULL )
+        {
+            fclose( p_storage->p_filew );
+            vlc_unlink( psz_file );
+            goto error;
+        }
     }
 
 #ifndef _WIN32
@@ -1166,8 +1268,18 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+#ifdef HAVE_MMAP
+    if( p_storage->p_map != NULL )
+    {
+        munmap( p_storage->p_map, p_storage->i_file_max );
+        close( p_storage->fd );
+    }
+    else
+#endif
+    {
+        fclose( p_storage->p_filer );
+        fclose( p_storage->p_filew );
+    }
 #ifdef _WIN32
     vlc_unlink( p_storage->psz_file );
     free( p_storage->psz_file );
@@ -1187,11 +1299,17 @@ static void TsStoragePack( ts_storage_t *p_storage )
     if( p_new )
         p_storage->p_cmd = p_new;
 }
+static size_t TsStorageCmdSize( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type != C_SEND )
+        return 0;
+    return sizeof(ts_block_header_t) + p_cmd->u.send.p_block->i_buffer;
+}
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = TsStorageCmdSize( p_cmd );
 
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
@@ -1211,32 +1329,98 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
+        const ts_block_header_t header = {
+            .i_dts = p_block->i_dts,
+            .i_pts = p_block->i_pts,
+            .i_length = p_block->i_length,
+            .i_flags = p_block->i_flags,
+            .i_nb_samples = p_block->i_nb_samples,
+            .i_buffer = p_block->i_buffer,
+        };
 
         cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
-
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
+#ifdef HAVE_MMAP
+        if( p_storage->p_map != NULL )
         {
-            block_Release( p_block );
-            return;
+            /* Append into the mapping, the size was checked at allocation */
+            uint8_t *p_dst = &p_storage->p_map[p_storage->i_file_size];
+
+            assert( p_storage->i_file_size + sizeof(header) + p_block->i_buffer
+                    <= p_storage->i_file_max );
+            cmd.u.send.i_offset = p_storage->i_file_size;
+            memcpy( p_dst, &header, sizeof(header) );
+            if( p_block->i_buffer > 0 )
+                memcpy( &p_dst[sizeof(header)], p_block->p_buffer, p_block->i_buffer );
         }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
+        else
+#endif
         {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
+            cmd.u.send.i_offset = ftell( p_storage->p_filew );
+
+            if( fwrite( &header, sizeof(header), 1, p_storage->p_filew ) != 1 )
             {
                 block_Release( p_block );
                 return;
             }
+            if( p_block->i_buffer > 0 )
+            {
+                if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
+                {
+                    block_Release( p_block );
+                    return;
+                }
+            }
+            if( b_flush )
+                fflush( p_storage->p_filew );
         }
-        p_storage->i_file_size += p_block->i_buffer;
+        p_storage->i_file_size += sizeof(header) + p_block->i_buffer;
         block_Release( p_block );
-
-        if( b_flush )
-            fflush( p_storage->p_filew );
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
+#ifdef HAVE_MMAP
+static block_t *TsStorageMapBlock( ts_storage_t *p_storage, int i_offset,
+                                   ts_block_header_t *p_header )
+{
+    const size_t i_data = i_offset + sizeof(*p_header);
+
+    memcpy( p_header, &p_storage->p_map[i_offset], sizeof(*p_header) );
+
+    if( p_header->i_buffer >= TS_STORAGE_MAP_MIN )
+    {
+        /* Map the payload privately: no copy, and the block outlives
+         * the storage. Small payloads are cheaper to copy */
+        const size_t i_page = i_data & ~(size_t)(sysconf( _SC_PAGESIZE ) - 1);
+        uint8_t *p_base = mmap( NULL, i_data - i_page + p_header->i_buffer,
+                                PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                                p_storage->fd, i_page );
+        if( p_base != MAP_FAILED )
+        {
+            block_t *p_block = block_mmap_Alloc( &p_base[i_data - i_page],
+                                                 p_header->i_buffer );
+            if( p_block )
+                return p_block;
+        }
+    }
+
+    block_t *p_block = block_Alloc( p_header->i_buffer );
+    if( p_block && p_header->i_buffer > 0 )
+        memcpy( p_block->p_buffer, &p_storage->p_map[i_data], p_header->i_buffer );
+    return p_block;
+}
+#endif
+static block_t *TsStorageReadBlock( ts_storage_t *p_storage, int i_offset,
+                                    ts_block_header_t *p_header )
+{
+    if( fseek( p_storage->p_filer, i_offset, SEEK_SET ) ||
+        fread( p_header, sizeof(*p_header), 1, p_storage->p_filer ) != 1 )
+        return NULL;
+
+    block_t *p_block = block_Alloc( p_header->i_buffer );
+    if( p_block )
+        p_block->i_buffer = fread( p_block->p_buffer, 1, p_header->i_buffer, p_storage->p_filer );
+    return p_block;
+}
 static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
 {
     assert( !TsStorageIsEmpty( p_storage ) );
@@ -1244,22 +1428,26 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
     if( p_cmd->i_type == C_SEND )
     {
-        block_t block;
+        ts_block_header_t header;
+        block_t *p_block = NULL;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+        if( !b_flush )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
-            {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
-            }
+#ifdef HAVE_MMAP
+            if( p_storage->p_map != NULL )
+                p_block = TsStorageMapBlock( p_storage, p_cmd->u.send.i_offset, &header );
+            else
+#endif
+                p_block = TsStorageReadBlock( p_storage, p_cmd->u.send.i_offset, &header );
+        }
+
+        if( p_block )
+        {
+            p_block->i_dts      = header.i_dts;
+            p_block->i_pts      = header.i_pts;
+            p_block->i_flags    = header.i_flags;
+            p_block->i_length   = header.i_length;
+            p_block->i_nb_samples = header.i_nb_samples;
             p_cmd->u.send.p_block = p_block;
         }
         else
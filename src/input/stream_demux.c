@@ -88,7 +88,7 @@ stream_t *stream_DemuxNew( demux_t *p_demux, const char *psz_demux, es_out_t *ou
     p_sys->stats.time = 0;
 
     /* decoder fifo */
-    if( ( p_sys->p_fifo = block_FifoNew() ) == NULL )
+    if( ( p_sys->p_fifo = block_FifoNewSPSC() ) == NULL )
     {
         free( p_sys->psz_name );
         goto error;
@@ -363,6 +363,9 @@ dbus_out:
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
 
+    block_CacheInit( var_InheritInteger( p_libvlc, "block-cache-size" )
+                     << 10 );
+
     /*
      * Initialize hotkey handling
      */
@@ -541,6 +544,8 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
 
     vlc_DeinitActions( p_libvlc, priv->actions );
 
+    block_CacheDeinit();
+
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
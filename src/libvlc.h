@@ -77,6 +77,13 @@ int vlc_LogPreinit(libvlc_int_t *);
 int vlc_LogInit(libvlc_int_t *);
 void vlc_LogDeinit(libvlc_int_t *);
 
+/*
+ * Block cache
+ */
+void block_CacheInit(size_t limit);
+void block_CacheDeinit(void);
+void block_CacheGetStats(uint64_t *hits, uint64_t *misses);
+
 /*
  * LibVLC exit event handling
  */
@@ -31,12 +31,15 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include "libvlc.h"
 
 /**
  * @section Block handling functions.
@@ -98,14 +101,6 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
-static void block_generic_Release (block_t *block)
-{
-    /* That is always true for blocks allocated with block_Alloc(). */
-    assert (block->p_start == (unsigned char *)(block + 1));
-    block_Invalidate (block);
-    free (block);
-}
-
 static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 {
     out->p_next    = in->p_next;
@@ -124,18 +119,413 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
-block_t *block_Alloc (size_t size)
+/**
+ * @section Block cache
+ *
+ * Blocks from block_Alloc() whose payload fits one of a few size classes are
+ * not freed on release, but kept for reuse: first in a small per-thread
+ * cache, then in a global pool. The "block-cache-size" option bounds the
+ * blocks kept in both.
+ * The cache is only active while at least one LibVLC instance exists.
+ *
+ * Only the owner thread touches its cache. It unregisters and frees it when
+ * it exits, and empties it on first use after the cache was disabled.
+ */
+
+/** Payload size classes (the 1536 bytes class covers UDP/RTP datagrams). */
+static const size_t block_cache_sizes[] = {
+    256, 512, 1024, 1536, 2048, 4096, 8192, 16384, 32768, 65536,
+};
+#define BLOCK_CACHE_CLASSES ARRAY_SIZE(block_cache_sizes)
+
+/** Per-thread cache budget for each size class (bytes) */
+#define BLOCK_CACHE_THREAD_BYTES (128 << 10)
+
+typedef struct block_cache_thread
+{
+    struct block_cache_thread *next;
+    struct block_cache_thread **pprev;
+    block_t *free[BLOCK_CACHE_CLASSES];
+    unsigned count[BLOCK_CACHE_CLASSES];
+    unsigned generation;
+    atomic_uint_least64_t hits;
+    atomic_uint_least64_t misses;
+} block_cache_thread_t;
+
+static vlc_mutex_t block_cache_lock = VLC_STATIC_MUTEX;
+static unsigned block_cache_refs = 0;
+static vlc_threadvar_t block_cache_key;
+static bool block_cache_keyed = false;
+static atomic_bool block_cache_enabled = ATOMIC_VAR_INIT(false);
+/** Incremented whenever the cache is disabled, to empty the thread caches */
+static atomic_uint block_cache_generation = ATOMIC_VAR_INIT(0);
+/** Bytes kept in the global pool and in all the thread caches */
+static atomic_size_t block_cache_bytes = ATOMIC_VAR_INIT(0);
+static atomic_size_t block_cache_limit = ATOMIC_VAR_INIT(0);
+/* Following members are protected by block_cache_lock */
+static block_cache_thread_t *block_cache_threads = NULL;
+static block_t *block_cache_free[BLOCK_CACHE_CLASSES];
+static uint64_t block_cache_hits = 0;
+static uint64_t block_cache_misses = 0;
+
+static size_t BlockAllocSize (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
-    if (unlikely(alloc <= size))
+    return sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING) + size;
+}
+
+static unsigned BlockCacheDepth (unsigned c)
+{
+    size_t depth = BLOCK_CACHE_THREAD_BYTES / block_cache_sizes[c];
+    return VLC_CLIP(depth, 2, 32);
+}
+
+/**
+ * Accounts for a block entering the cache.
+ * @return false if the cache is full.
+ */
+static bool BlockCacheCharge (size_t size)
+{
+    size_t bytes = atomic_fetch_add_explicit (&block_cache_bytes, size,
+                                              memory_order_relaxed);
+    if (bytes + size > atomic_load_explicit (&block_cache_limit,
+                                             memory_order_relaxed))
+    {
+        atomic_fetch_sub_explicit (&block_cache_bytes, size,
+                                   memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/** Accounts for a block leaving the cache. */
+static void BlockCacheUncharge (size_t size)
+{
+    atomic_fetch_sub_explicit (&block_cache_bytes, size, memory_order_relaxed);
+}
+
+/** Frees a list of cached blocks of the given class. */
+static void BlockCacheFreeList (block_t *block, unsigned c)
+{
+    const size_t size = BlockAllocSize (block_cache_sizes[c]);
+
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+        free (block);
+        BlockCacheUncharge (size);
+        block = next;
+    }
+}
+
+/** Empties the cache of the calling thread. */
+static void BlockCacheThreadFlush (block_cache_thread_t *tc)
+{
+    for (unsigned c = 0; c < BLOCK_CACHE_CLASSES; c++)
+    {
+        BlockCacheFreeList (tc->free[c], c);
+        tc->free[c] = NULL;
+        tc->count[c] = 0;
+    }
+}
+
+/** Thread-specific destructor: runs in the exiting owner thread. */
+static void BlockCacheThreadDestroy (void *data)
+{
+    block_cache_thread_t *tc = data;
+
+    BlockCacheThreadFlush (tc);
+
+    vlc_mutex_lock (&block_cache_lock);
+    block_cache_hits += atomic_load_explicit (&tc->hits, memory_order_relaxed);
+    block_cache_misses += atomic_load_explicit (&tc->misses,
+                                                memory_order_relaxed);
+    *(tc->pprev) = tc->next;
+    if (tc->next != NULL)
+        tc->next->pprev = tc->pprev;
+    vlc_mutex_unlock (&block_cache_lock);
+    free (tc);
+}
+
+/**
+ * Gets the cache of the calling thread, creating it if needed.
+ * @return the thread cache or NULL on memory error.
+ */
+static block_cache_thread_t *BlockCacheThread (void)
+{
+    const unsigned generation = atomic_load_explicit (&block_cache_generation,
+                                                      memory_order_acquire);
+    block_cache_thread_t *tc = vlc_threadvar_get (block_cache_key);
+    if (likely(tc != NULL))
+    {
+        if (unlikely(tc->generation != generation))
+        {   /* The cache was disabled since this thread last used it */
+            BlockCacheThreadFlush (tc);
+            tc->generation = generation;
+        }
+        return tc;
+    }
+
+    tc = calloc (1, sizeof (*tc));
+    if (unlikely(tc == NULL))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
+    tc->generation = generation;
+    atomic_init (&tc->hits, 0);
+    atomic_init (&tc->misses, 0);
+    if (vlc_threadvar_set (block_cache_key, tc))
+    {
+        free (tc);
+        return NULL;
+    }
+
+    vlc_mutex_lock (&block_cache_lock);
+    tc->next = block_cache_threads;
+    if (tc->next != NULL)
+        tc->next->pprev = &tc->next;
+    tc->pprev = &block_cache_threads;
+    block_cache_threads = tc;
+    vlc_mutex_unlock (&block_cache_lock);
+    return tc;
+}
+
+static void BlockCacheCount (atomic_uint_least64_t *counter)
+{
+    /* Only the owner thread writes its counters: no read-modify-write */
+    uint_least64_t val = atomic_load_explicit (counter, memory_order_relaxed);
+    atomic_store_explicit (counter, val + 1, memory_order_relaxed);
+}
+
+/**
+ * Finds the size class for a given payload size.
+ * @return the class index, or -1 if the size is not cached.
+ */
+static int BlockCacheClass (size_t size)
+{
+    for (unsigned c = 0; c < BLOCK_CACHE_CLASSES; c++)
+        if (size <= block_cache_sizes[c])
+            return c;
+    return -1;
+}
+
+static block_t *BlockCacheGet (unsigned c)
+{
+    block_cache_thread_t *tc = BlockCacheThread ();
+    block_t *block;
+
+    if (likely(tc != NULL))
+    {
+        block = tc->free[c];
+        if (block != NULL)
+        {
+            tc->free[c] = block->p_next;
+            tc->count[c]--;
+            BlockCacheUncharge (BlockAllocSize (block_cache_sizes[c]));
+            BlockCacheCount (&tc->hits);
+            return block;
+        }
+    }
+
+    /* Refill the thread cache with up to half its depth from the pool.
+     * The blocks stay accounted for in the cache. */
+    unsigned refill = (tc != NULL) ? BlockCacheDepth (c) / 2 : 0;
+
+    vlc_mutex_lock (&block_cache_lock);
+    block = block_cache_free[c];
+    if (block != NULL)
+    {
+        block_cache_free[c] = block->p_next;
+
+        while (refill > 0 && block_cache_free[c] != NULL)
+        {
+            block_t *extra = block_cache_free[c];
+
+            block_cache_free[c] = extra->p_next;
+            extra->p_next = tc->free[c];
+            tc->free[c] = extra;
+            tc->count[c]++;
+            refill--;
+        }
+    }
+
+    if (tc == NULL)
+    {
+        if (block != NULL)
+            block_cache_hits++;
+        else
+            block_cache_misses++;
+    }
+    vlc_mutex_unlock (&block_cache_lock);
+
+    if (block != NULL)
+        BlockCacheUncharge (BlockAllocSize (block_cache_sizes[c]));
+    if (tc != NULL)
+        BlockCacheCount ((block != NULL) ? &tc->hits : &tc->misses);
+    return block;
+}
+
+/**
+ * Puts a released block back into the cache.
+ * @return false if the block was not cached and must be freed.
+ */
+static bool BlockCachePut (block_t *block)
+{
+    if (!atomic_load_explicit (&block_cache_enabled, memory_order_relaxed))
+        return false;
+
+    const size_t capacity = block->i_size - (BLOCK_ALIGN + 2 * BLOCK_PADDING);
+    int c = BlockCacheClass (capacity);
+    if (c < 0 || block_cache_sizes[c] != capacity)
+        return false; /* not one of the class sizes */
+
+    /* The thread caches count against the same limit as the pool */
+    if (!BlockCacheCharge (BlockAllocSize (block_cache_sizes[c])))
+        return false;
+
+    block_cache_thread_t *tc = BlockCacheThread ();
+    const unsigned depth = BlockCacheDepth (c);
+
+    if (likely(tc != NULL))
+    {
+        if (tc->count[c] >= depth)
+        {   /* Move half of the thread cache to the global pool */
+            vlc_mutex_lock (&block_cache_lock);
+            while (tc->count[c] > depth / 2)
+            {
+                block_t *b = tc->free[c];
+
+                tc->free[c] = b->p_next;
+                tc->count[c]--;
+                b->p_next = block_cache_free[c];
+                block_cache_free[c] = b;
+            }
+            vlc_mutex_unlock (&block_cache_lock);
+        }
+
+        block->p_next = tc->free[c];
+        tc->free[c] = block;
+        tc->count[c]++;
+        return true;
+    }
+
+    vlc_mutex_lock (&block_cache_lock);
+    block->p_next = block_cache_free[c];
+    block_cache_free[c] = block;
+    vlc_mutex_unlock (&block_cache_lock);
+    return true;
+}
+
+/**
+ * Enables the block cache (or takes one more reference to it).
+ * @param limit global pool size limit (bytes), zero to disable the cache
+ */
+void block_CacheInit (size_t limit)
+{
+    vlc_mutex_lock (&block_cache_lock);
+    assert (block_cache_refs < UINT_MAX);
+    if (block_cache_refs++ == 0)
+    {
+        /* The key is kept for the process lifetime, so that the thread
+         * caches are always destroyed by their own thread when it exits. */
+        if (!block_cache_keyed)
+            block_cache_keyed = !vlc_threadvar_create (&block_cache_key,
+                                                       BlockCacheThreadDestroy);
+        if (!block_cache_keyed)
+            limit = 0;
+        atomic_store (&block_cache_limit, limit);
+        atomic_store (&block_cache_enabled, limit > 0);
+    }
+    vlc_mutex_unlock (&block_cache_lock);
+}
+
+/**
+ * Releases a reference to the block cache, and empties it if it was the
+ * last one.
+ */
+void block_CacheDeinit (void)
+{
+    vlc_mutex_lock (&block_cache_lock);
+    assert (block_cache_refs > 0);
+    if (--block_cache_refs == 0)
+    {
+        atomic_store (&block_cache_enabled, false);
+        /* Other threads may still be running: they empty their own cache
+         * on their next block allocation or release, or when exiting. */
+        atomic_fetch_add_explicit (&block_cache_generation, 1,
+                                   memory_order_release);
+        if (block_cache_keyed)
+        {
+            block_cache_thread_t *tc = vlc_threadvar_get (block_cache_key);
+            if (tc != NULL)
+                BlockCacheThreadFlush (tc);
+        }
+        for (unsigned c = 0; c < BLOCK_CACHE_CLASSES; c++)
+        {
+            BlockCacheFreeList (block_cache_free[c], c);
+            block_cache_free[c] = NULL;
+        }
+        /* Blocks still in the other thread caches remain accounted for,
+         * until these threads empty their cache. */
+        atomic_store (&block_cache_limit, 0);
+    }
+    vlc_mutex_unlock (&block_cache_lock);
+}
+
+/**
+ * Gets the process-wide block cache counters.
+ * @param hits number of block_Alloc() calls served from the cache [OUT]
+ * @param misses number of cacheable block_Alloc() calls that had to allocate
+ * memory [OUT]
+ */
+void block_CacheGetStats (uint64_t *hits, uint64_t *misses)
+{
+    vlc_mutex_lock (&block_cache_lock);
+    *hits = block_cache_hits;
+    *misses = block_cache_misses;
+    for (block_cache_thread_t *tc = block_cache_threads; tc != NULL;
+         tc = tc->next)
+    {
+        *hits += atomic_load_explicit (&tc->hits, memory_order_relaxed);
+        *misses += atomic_load_explicit (&tc->misses, memory_order_relaxed);
+    }
+    vlc_mutex_unlock (&block_cache_lock);
+}
+
+static void block_generic_Release (block_t *block)
+{
+    /* That is always true for blocks allocated with block_Alloc(). */
+    assert (block->p_start == (unsigned char *)(block + 1));
+    block_Invalidate (block);
+    if (!BlockCachePut (block))
+        free (block);
+}
+
+block_t *block_Alloc (size_t size)
+{
+    size_t capacity = size;
+    block_t *b = NULL;
+
+    if (atomic_load_explicit (&block_cache_enabled, memory_order_relaxed))
+    {
+        int c = BlockCacheClass (size);
+        if (c >= 0)
+        {
+            capacity = block_cache_sizes[c];
+            b = BlockCacheGet (c);
+        }
+    }
+
+    const size_t alloc = BlockAllocSize (capacity);
+    if (unlikely(alloc <= capacity))
         return NULL;
 
+    if (b == NULL)
+    {
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+    }
+
     block_Init (b, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
@@ -305,7 +695,7 @@ block_t *block_mmap_Alloc (void *addr, size_t length)
 
     long page_mask = sysconf(_SC_PAGESIZE) - 1;
     size_t left = ((uintptr_t)addr) & page_mask;
-    size_t right = (-length) & page_mask;
+    size_t right = (-(left + length)) & page_mask;
 
     block_t *block = malloc (sizeof (*block));
     if (block == NULL)
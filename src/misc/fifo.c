@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
@@ -48,8 +49,116 @@ struct block_fifo_t
     block_t             **pp_last;
     size_t              i_depth;
     size_t              i_size;
+
+    /* Single producer, single consumer mode: the producer pushes onto a
+     * lock-free stack, which the consumer takes whole and reverses into
+     * p_first. The lock is only used to sleep while the FIFO is empty. */
+    bool                b_spsc;
+    atomic_uintptr_t    spsc_head; /**< Last queued block */
+    atomic_size_t       spsc_depth;
+    atomic_size_t       spsc_size;
+    atomic_bool         spsc_waiting; /**< Consumer is about to sleep */
+    vlc_cond_t         *spsc_cond; /**< Condition the consumer waits on */
 };
 
+/* Queues blocks, returns true if the consumer may need to be woken up */
+static bool vlc_fifo_SPSCPush(block_fifo_t *fifo, block_t *block)
+{
+    block_t *first = NULL, *last = block;
+    size_t depth = 0, size = 0;
+
+    /* The stack is popped in reverse order */
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = first;
+        first = block;
+        depth++;
+        size += block->i_buffer;
+        block = next;
+    }
+
+    if (first == NULL)
+        return false;
+
+    /* Account before publishing, and the consumer after dequeuing, so that
+     * the counts are never lower than what is queued. */
+    atomic_fetch_add(&fifo->spsc_depth, depth);
+    atomic_fetch_add(&fifo->spsc_size, size);
+
+    uintptr_t head = atomic_load_explicit(&fifo->spsc_head,
+                                          memory_order_relaxed);
+    do
+        last->p_next = (block_t *)head;
+    while (!atomic_compare_exchange_weak(&fifo->spsc_head, &head,
+                                         (uintptr_t)first));
+
+    return atomic_load(&fifo->spsc_waiting);
+}
+
+/* Wakes the consumer up, the FIFO must be locked */
+static void vlc_fifo_SPSCWake(block_fifo_t *fifo)
+{
+    vlc_assert_locked(&fifo->lock);
+    vlc_cond_signal(fifo->spsc_cond);
+}
+
+/* Moves the queued blocks to the consumer list, if it is empty.
+ * Returns false if the FIFO is empty, or if wait is false and the queued
+ * blocks are not published yet. Waiting requires the FIFO to be locked. */
+static bool vlc_fifo_SPSCRefill(block_fifo_t *fifo, bool wait)
+{
+    if (fifo->p_first != NULL)
+        return true;
+    if (atomic_load(&fifo->spsc_depth) == 0)
+        return false;
+
+    block_t *block;
+    /* Blocks are accounted for: the producer is about to publish them. It
+     * may have been preempted in between, so sleep rather than spin until
+     * it sees the flag and wakes us up. */
+    while ((block = (block_t *)atomic_exchange(&fifo->spsc_head, 0)) == NULL)
+    {
+        if (!wait)
+            return false;
+        vlc_assert_locked(&fifo->lock);
+
+        int canc = vlc_savecancel();
+
+        atomic_store(&fifo->spsc_waiting, true);
+        if (atomic_load(&fifo->spsc_head) == 0)
+            vlc_cond_wait(fifo->spsc_cond, &fifo->lock);
+        atomic_store(&fifo->spsc_waiting, false);
+        vlc_restorecancel(canc);
+    }
+
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = fifo->p_first;
+        fifo->p_first = block;
+        block = next;
+    }
+    return true;
+}
+
+static block_t *vlc_fifo_SPSCPop(block_fifo_t *fifo, bool wait)
+{
+    if (!vlc_fifo_SPSCRefill(fifo, wait))
+        return NULL;
+
+    block_t *block = fifo->p_first;
+
+    fifo->p_first = block->p_next;
+    block->p_next = NULL;
+
+    atomic_fetch_sub(&fifo->spsc_size, block->i_buffer);
+    atomic_fetch_sub(&fifo->spsc_depth, 1);
+    return block;
+}
+
 /**
  * Locks a block FIFO. No more than one thread can lock the FIFO at any given
  * time, and no other thread can modify the FIFO while it is locked.
@@ -107,7 +216,26 @@ void vlc_fifo_Wait(vlc_fifo_t *fifo)
 
 void vlc_fifo_WaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar)
 {
+    if (fifo->b_spsc)
+    {   /* The producer does not lock the FIFO unless it sees the flag,
+         * then it wakes the consumer up on its own condition variable. */
+        fifo->spsc_cond = condvar;
+        atomic_store(&fifo->spsc_waiting, true);
+        if (atomic_load(&fifo->spsc_depth) > 0)
+        {
+            atomic_store(&fifo->spsc_waiting, false);
+            fifo->spsc_cond = &fifo->wait;
+            return;
+        }
+    }
+
     vlc_cond_wait(condvar, &fifo->lock);
+
+    if (fifo->b_spsc)
+    {
+        atomic_store(&fifo->spsc_waiting, false);
+        fifo->spsc_cond = &fifo->wait;
+    }
 }
 
 /**
@@ -116,7 +244,26 @@ void vlc_fifo_WaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar)
  */
 int vlc_fifo_TimedWaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar, mtime_t deadline)
 {
-    return vlc_cond_timedwait(condvar, &fifo->lock, deadline);
+    if (fifo->b_spsc)
+    {
+        fifo->spsc_cond = condvar;
+        atomic_store(&fifo->spsc_waiting, true);
+        if (atomic_load(&fifo->spsc_depth) > 0)
+        {
+            atomic_store(&fifo->spsc_waiting, false);
+            fifo->spsc_cond = &fifo->wait;
+            return 0;
+        }
+    }
+
+    int ret = vlc_cond_timedwait(condvar, &fifo->lock, deadline);
+
+    if (fifo->b_spsc)
+    {
+        atomic_store(&fifo->spsc_waiting, false);
+        fifo->spsc_cond = &fifo->wait;
+    }
+    return ret;
 }
 
 /**
@@ -131,6 +278,8 @@ int vlc_fifo_TimedWaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar, mtime_t deadli
  */
 size_t vlc_fifo_GetCount(const vlc_fifo_t *fifo)
 {
+    if (fifo->b_spsc)
+        return atomic_load((atomic_size_t *)&fifo->spsc_depth);
     return fifo->i_depth;
 }
 
@@ -150,6 +299,8 @@ size_t vlc_fifo_GetCount(const vlc_fifo_t *fifo)
  */
 size_t vlc_fifo_GetBytes(const vlc_fifo_t *fifo)
 {
+    if (fifo->b_spsc)
+        return atomic_load((atomic_size_t *)&fifo->spsc_size);
     return fifo->i_size;
 }
 
@@ -167,6 +318,14 @@ size_t vlc_fifo_GetBytes(const vlc_fifo_t *fifo)
 void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
 {
     vlc_assert_locked(&fifo->lock);
+
+    if (fifo->b_spsc)
+    {
+        vlc_fifo_SPSCPush(fifo, block);
+        vlc_fifo_SPSCWake(fifo);
+        return;
+    }
+
     assert(*(fifo->pp_last) == NULL);
 
     *(fifo->pp_last) = block;
@@ -197,6 +356,9 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
 
+    if (fifo->b_spsc)
+        return vlc_fifo_SPSCPop(fifo, true);
+
     block_t *block = fifo->p_first;
 
     if (block == NULL)
@@ -231,6 +393,18 @@ block_t *vlc_fifo_DequeueAllUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
 
+    if (fifo->b_spsc)
+    {
+        block_t *block = NULL, **pp = &block, *next;
+
+        while ((next = vlc_fifo_SPSCPop(fifo, true)) != NULL)
+        {
+            *pp = next;
+            pp = &next->p_next;
+        }
+        return block;
+    }
+
     block_t *block = fifo->p_first;
 
     fifo->p_first = NULL;
@@ -258,10 +432,36 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->p_first = NULL;
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
+    p_fifo->b_spsc = false;
+    atomic_init(&p_fifo->spsc_head, 0);
+    atomic_init(&p_fifo->spsc_depth, 0);
+    atomic_init(&p_fifo->spsc_size, 0);
+    atomic_init(&p_fifo->spsc_waiting, false);
+    p_fifo->spsc_cond = &p_fifo->wait;
 
     return p_fifo;
 }
 
+/**
+ * Creates a FIFO queue of blocks for exactly one producer thread and one
+ * consumer thread. block_FifoPut(), block_FifoGet() and block_FifoShow()
+ * do not lock the FIFO, except to sleep while it is empty.
+ *
+ * The vlc_fifo_*() functions keep working, but vlc_fifo_QueueUnlocked() must
+ * only be called by the producer, while vlc_fifo_DequeueUnlocked(),
+ * vlc_fifo_DequeueAllUnlocked(), vlc_fifo_Wait(), block_FifoShow() and
+ * block_FifoEmpty() must only be called by the consumer.
+ *
+ * @return the FIFO or NULL on memory error
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( p_fifo )
+        p_fifo->b_spsc = true;
+    return p_fifo;
+}
+
 /**
  * Destroys a FIFO created by block_FifoNew().
  * Any queued blocks are also destroyed.
@@ -269,6 +469,7 @@ block_fifo_t *block_FifoNew( void )
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
     block_ChainRelease( p_fifo->p_first );
+    block_ChainRelease( (block_t *)atomic_load( &p_fifo->spsc_head ) );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
     free( p_fifo );
@@ -294,6 +495,17 @@ void block_FifoEmpty(block_fifo_t *fifo)
  */
 void block_FifoPut(block_fifo_t *fifo, block_t *block)
 {
+    if (fifo->b_spsc)
+    {
+        if (vlc_fifo_SPSCPush(fifo, block))
+        {   /* Serialize with the consumer going to sleep */
+            vlc_fifo_Lock(fifo);
+            vlc_fifo_SPSCWake(fifo);
+            vlc_fifo_Unlock(fifo);
+        }
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     vlc_fifo_QueueUnlocked(fifo, block);
     vlc_fifo_Unlock(fifo);
@@ -311,6 +523,13 @@ block_t *block_FifoGet(block_fifo_t *fifo)
 
     vlc_testcancel();
 
+    if (fifo->b_spsc)
+    {   /* Lock-free unless the producer is in the middle of queueing */
+        block = vlc_fifo_SPSCPop(fifo, false);
+        if (block != NULL)
+            return block;
+    }
+
     vlc_fifo_Lock(fifo);
     while (vlc_fifo_IsEmpty(fifo))
     {
@@ -339,6 +558,17 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 {
     block_t *b;
 
+    if( p_fifo->b_spsc )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        bool b_queued = vlc_fifo_SPSCRefill( p_fifo, true );
+        assert( b_queued );
+        (void) b_queued;
+        b = p_fifo->p_first;
+        vlc_mutex_unlock( &p_fifo->lock );
+        return b;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     assert(p_fifo->p_first != NULL);
     b = p_fifo->p_first;
@@ -352,6 +582,9 @@ size_t block_FifoSize (block_fifo_t *fifo)
 {
     size_t size;
 
+    if (fifo->b_spsc)
+        return vlc_fifo_GetBytes (fifo);
+
     vlc_mutex_lock (&fifo->lock);
     size = fifo->i_size;
     vlc_mutex_unlock (&fifo->lock);
@@ -363,6 +596,9 @@ size_t block_FifoCount (block_fifo_t *fifo)
 {
     size_t depth;
 
+    if (fifo->b_spsc)
+        return vlc_fifo_GetCount (fifo);
+
     vlc_mutex_lock (&fifo->lock);
     depth = fifo->i_depth;
     vlc_mutex_unlock (&fifo->lock);
@@ -40,8 +40,10 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
+#include <limits.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -49,6 +51,10 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -63,8 +69,26 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* max stream chunks sent with a single system call */
+#define HTTPD_CL_IOVMAX 32
+
+/* Piece of stream data, shared by the stream backlog and its clients */
+typedef struct httpd_stream_chunk_t
+{
+    atomic_uint refs;
+    int64_t     i_pos;      /* absolute position of the first byte */
+    bool        b_keyframe;
+    block_t     *p_block;
+} httpd_stream_chunk_t;
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_HostClientRemove(httpd_host_t *host, httpd_client_t *cl);
+
+/* epoll data of the listening sockets and of the wakeup event, client
+ * sockets use their fd */
+#define HTTPD_EPOLL_LISTENER (UINT64_C(1) << 63)
+#define HTTPD_EPOLL_WAKEUP   (UINT64_C(1) << 62)
+static void httpd_StreamChunkRelease(httpd_stream_chunk_t *chunk);
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -79,6 +103,16 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
+    /* persistent, edge-triggered, sockets registration, or -1 to poll */
+    int          epfd;
+    int          evfd;          /* wakes the epoll loop up on stream data */
+    httpd_client_t **fdmap;     /* clients by socket, for epoll events */
+    size_t       i_fdmap;
+    httpd_client_t **timers;    /* clients by deadline, binary min-heap */
+    size_t       i_timers;
+    size_t       i_timers_alloc;
+    httpd_client_t *ready;      /* clients to process without waiting */
+
     vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
@@ -165,14 +199,42 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* stream data being sent, straight from the stream backlog */
+    httpd_stream_chunk_t *stream_chunks[HTTPD_CL_IOVMAX];
+    struct iovec stream_iov[HTTPD_CL_IOVMAX];
+    unsigned i_stream_chunk;    /* first chunk not completely sent */
+    unsigned i_stream_chunks;
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
 
     /* TLS data */
     vlc_tls_t *p_tls;
+
+    /* edge-triggered readiness, until an operation would block */
+    bool    b_readable;
+    bool    b_writable;
+
+    /* epoll loop scheduling */
+    mtime_t i_deadline;         /* next timer, or INT64_MAX if none */
+    size_t  i_timer;            /* index in host->timers */
+    httpd_client_t *ready_next;
+    httpd_client_t **ready_pprev; /* NULL if not in host->ready */
 };
 
+/* Wakes the epoll loop up, for the clients waiting for stream data */
+static void httpd_HostWake(httpd_host_t *host)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    uint64_t value = 1;
+
+    if (host->evfd != -1)
+        write(host->evfd, &value, sizeof (value));
+#else
+    VLC_UNUSED(host);
+#endif
+}
 
 /*****************************************************************************
  * Various functions
@@ -611,9 +673,13 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* backlog of sent blocks, oldest first, in a circular array */
+    httpd_stream_chunk_t **pp_chunks;
+    size_t      i_chunks_alloc;     /* power of 2 */
+    size_t      i_chunks_first;
+    size_t      i_chunks;
+    size_t      i_buffer_size;      /* backlog size limit */
+    size_t      i_buffer;           /* backlog size */
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -622,6 +688,40 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
+static void httpd_StreamChunkRelease(httpd_stream_chunk_t *chunk)
+{
+    if (atomic_fetch_sub(&chunk->refs, 1) == 1) {
+        block_Release(chunk->p_block);
+        free(chunk);
+    }
+}
+
+static httpd_stream_chunk_t *httpd_StreamChunkAt(const httpd_stream_t *stream,
+                                                 size_t i)
+{
+    assert(i < stream->i_chunks);
+    return stream->pp_chunks[(stream->i_chunks_first + i)
+                             & (stream->i_chunks_alloc - 1)];
+}
+
+/* Returns the index of the backlog chunk holding the byte at i_pos,
+ * or the number of chunks if that byte is not in the backlog anymore. */
+static size_t httpd_StreamChunkFind(const httpd_stream_t *stream, int64_t i_pos)
+{
+    if (stream->i_chunks == 0 || i_pos < httpd_StreamChunkAt(stream, 0)->i_pos)
+        return stream->i_chunks;
+
+    size_t lo = 0, hi = stream->i_chunks;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (httpd_StreamChunkAt(stream, mid)->i_pos <= i_pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -632,44 +732,62 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
+        vlc_mutex_lock(&stream->lock);
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        if (answer->i_body_offset >= stream->i_buffer_pos) {
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
+        }
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass) {
                 /* still waiting for the next keyframe */
+                vlc_mutex_unlock(&stream->lock);
                 return VLC_EGENERIC;
+            }
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+        size_t i_chunk = httpd_StreamChunkFind(stream, answer->i_body_offset);
+        if (i_chunk == stream->i_chunks) {
+            /* this client isn't fast enough */
+            i_chunk = httpd_StreamChunkFind(stream, stream->i_buffer_last_pos);
+            if (stream->b_has_keyframes) {
+                /* restart from the last keyframe still available */
+                for (size_t i = stream->i_chunks; i-- > 0;)
+                    if (httpd_StreamChunkAt(stream, i)->b_keyframe) {
+                        i_chunk = i;
+                        break;
+                    }
+            }
+            answer->i_body_offset = httpd_StreamChunkAt(stream, i_chunk)->i_pos;
+        }
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        /* Reference the chunks to send, no copy */
+        int64_t i_write = 0;
+        assert(cl->i_stream_chunks == 0);
+        while (i_chunk < stream->i_chunks && i_write < HTTPD_CL_BUFSIZE
+            && cl->i_stream_chunks < HTTPD_CL_IOVMAX) {
+            httpd_stream_chunk_t *chunk = httpd_StreamChunkAt(stream, i_chunk++);
+            size_t i_skip = answer->i_body_offset + i_write - chunk->i_pos;
+            struct iovec *iov = &cl->stream_iov[cl->i_stream_chunks];
+
+            atomic_fetch_add(&chunk->refs, 1);
+            cl->stream_chunks[cl->i_stream_chunks++] = chunk;
+            iov->iov_base = chunk->p_block->p_buffer + i_skip;
+            iov->iov_len = chunk->p_block->i_buffer - i_skip;
+            i_write += iov->iov_len;
+        }
+        vlc_mutex_unlock(&stream->lock);
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
         answer->i_body_offset += i_write;
 
         return VLC_SUCCESS;
@@ -766,7 +884,11 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->i_buffer = 0;
+    stream->pp_chunks = NULL;
+    stream->i_chunks_alloc = 0;
+    stream->i_chunks_first = 0;
+    stream->i_chunks = 0;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -802,42 +924,82 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
-    }
+    if (!p_block || !p_block->p_buffer || !p_block->i_buffer)
+        return VLC_SUCCESS;
 
-    stream->i_buffer_pos += i_data;
+    block_t *p_copy = block_Alloc(p_block->i_buffer);
+    if (unlikely(p_copy == NULL))
+        return VLC_ENOMEM;
+    memcpy(p_copy->p_buffer, p_block->p_buffer, p_block->i_buffer);
+    p_copy->i_flags = p_block->i_flags;
+    return httpd_StreamSendBlock(stream, p_copy);
 }
 
-int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
+int httpd_StreamSendBlock(httpd_stream_t *stream, block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block->p_buffer || !p_block->i_buffer) {
+        block_Release(p_block);
         return VLC_SUCCESS;
+    }
+
+    /* Clients send from the backlog blocks directly */
+    httpd_stream_chunk_t *chunk = malloc(sizeof (*chunk));
+    if (unlikely(chunk == NULL)) {
+        block_Release(p_block);
+        return VLC_ENOMEM;
+    }
+    chunk->p_block = p_block;
+    atomic_init(&chunk->refs, 1);
+    chunk->b_keyframe = (p_block->i_flags & BLOCK_FLAG_TYPE_I) != 0;
 
     vlc_mutex_lock(&stream->lock);
 
+    if (stream->i_chunks == stream->i_chunks_alloc) {
+        size_t i_alloc = stream->i_chunks_alloc ? 2 * stream->i_chunks_alloc : 64;
+        httpd_stream_chunk_t **pp_chunks = malloc(i_alloc * sizeof (*pp_chunks));
+        if (unlikely(pp_chunks == NULL)) {
+            vlc_mutex_unlock(&stream->lock);
+            httpd_StreamChunkRelease(chunk);
+            return VLC_ENOMEM;
+        }
+        for (size_t i = 0; i < stream->i_chunks; i++)
+            pp_chunks[i] = httpd_StreamChunkAt(stream, i);
+        free(stream->pp_chunks);
+        stream->pp_chunks = pp_chunks;
+        stream->i_chunks_alloc = i_alloc;
+        stream->i_chunks_first = 0;
+    }
+
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
 
-    if (p_block->i_flags & BLOCK_FLAG_TYPE_I) {
+    if (chunk->b_keyframe) {
         stream->b_has_keyframes = true;
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    chunk->i_pos = stream->i_buffer_pos;
+    stream->pp_chunks[(stream->i_chunks_first + stream->i_chunks)
+                      & (stream->i_chunks_alloc - 1)] = chunk;
+    stream->i_chunks++;
+    stream->i_buffer += chunk->p_block->i_buffer;
+    stream->i_buffer_pos += chunk->p_block->i_buffer;
+
+    /* Drop the oldest blocks, clients still sending them keep a reference */
+    while (stream->i_buffer > stream->i_buffer_size && stream->i_chunks > 1) {
+        httpd_stream_chunk_t *old = httpd_StreamChunkAt(stream, 0);
+
+        stream->i_chunks_first = (stream->i_chunks_first + 1)
+                               & (stream->i_chunks_alloc - 1);
+        stream->i_chunks--;
+        stream->i_buffer -= old->p_block->i_buffer;
+        httpd_StreamChunkRelease(old);
+    }
 
     vlc_mutex_unlock(&stream->lock);
+    httpd_HostWake(stream->url->host);
     return VLC_SUCCESS;
 }
 
@@ -852,7 +1014,9 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    for (size_t i = 0; i < stream->i_chunks; i++)
+        httpd_StreamChunkRelease(httpd_StreamChunkAt(stream, i));
+    free(stream->pp_chunks);
     free(stream);
 }
 
@@ -959,6 +1123,8 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     host->i_ref = 1;
+    host->epfd = -1;
+    host->evfd = -1;
 
     host->fds = net_ListenTCP(p_this, url.psz_host, port);
     if (!host->fds) {
@@ -967,7 +1133,46 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     }
     for (host->nfd = 0; host->fds[host->nfd] != -1; host->nfd++);
 
+#ifdef HAVE_SYS_EPOLL_H
+    host->epfd = epoll_create1(EPOLL_CLOEXEC);
+    for (unsigned i = 0; i < host->nfd && host->epfd != -1; i++) {
+        struct epoll_event ev = {
+            .events = EPOLLIN | EPOLLET,
+            .data.u64 = HTTPD_EPOLL_LISTENER | i,
+        };
+
+        if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->fds[i], &ev)) {
+            close(host->epfd);
+            host->epfd = -1;
+        }
+    }
+    if (host->epfd != -1) {
+        struct epoll_event ev = {
+            .events = EPOLLIN,
+            .data.u64 = HTTPD_EPOLL_WAKEUP,
+        };
+
+        host->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (host->evfd == -1
+         || epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->evfd, &ev)) {
+            if (host->evfd != -1)
+                close(host->evfd);
+            close(host->epfd);
+            host->evfd = host->epfd = -1;
+        }
+    }
+    if (host->epfd == -1)
+        msg_Warn(p_this, "cannot use epoll, falling back to poll: %s",
+                 vlc_strerror_c(errno));
+#endif
+
     host->port     = port;
+    host->fdmap    = NULL;
+    host->i_fdmap  = 0;
+    host->timers   = NULL;
+    host->i_timers = 0;
+    host->i_timers_alloc = 0;
+    host->ready    = NULL;
     host->i_url    = 0;
     host->url      = NULL;
     host->i_client = 0;
@@ -993,6 +1198,10 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        if (host->evfd != -1)
+            close(host->evfd);
+        if (host->epfd != -1)
+            close(host->epfd);
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1037,8 +1246,14 @@ void httpd_HostDelete(httpd_host_t *host)
         httpd_ClientDestroy(host->client[i]);
     }
     TAB_CLEAN(host->i_client, host->client);
+    free(host->fdmap);
+    free(host->timers);
 
     vlc_tls_Delete(host->p_tls);
+    if (host->evfd != -1)
+        close(host->evfd);
+    if (host->epfd != -1)
+        close(host->epfd);
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
     vlc_mutex_destroy(&host->lock);
@@ -1114,8 +1329,7 @@ void httpd_UrlDelete(httpd_url_t *url)
 
         /* TODO complete it */
         msg_Warn(host, "force closing connections");
-        TAB_REMOVE(host->i_client, host->client, client);
-        httpd_ClientDestroy(client);
+        httpd_HostClientRemove(host, client);
         i--;
     }
     free(url);
@@ -1200,6 +1414,8 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
+    cl->i_stream_chunk = 0;
+    cl->i_stream_chunks = 0;
     cl->b_stream_mode = false;
 
     httpd_MsgInit(&cl->query);
@@ -1226,6 +1442,8 @@ static void httpd_ClientDestroy(httpd_client_t *cl)
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
+    for (unsigned i = cl->i_stream_chunk; i < cl->i_stream_chunks; i++)
+        httpd_StreamChunkRelease(cl->stream_chunks[i]);
     free(cl->p_buffer);
     free(cl);
 }
@@ -1240,6 +1458,12 @@ static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
     cl->fd      = fd;
     cl->url     = NULL;
     cl->p_tls = p_tls;
+    cl->b_readable = true;
+    cl->b_writable = true;
+    cl->i_deadline = INT64_MAX;
+    cl->i_timer = 0;
+    cl->ready_next = NULL;
+    cl->ready_pprev = NULL;
 
     httpd_ClientInit(cl, now);
     if (p_tls)
@@ -1259,6 +1483,8 @@ ssize_t httpd_NetRecv (httpd_client_t *cl, uint8_t *p, size_t i_len)
         val = p_tls ? tls_Recv (p_tls, p, i_len)
                     : recv (cl->fd, p, i_len, 0);
     while (val == -1 && errno == EINTR);
+    if (val == -1 && errno == EAGAIN)
+        cl->b_readable = false;
     return val;
 }
 
@@ -1273,6 +1499,52 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
         val = p_tls ? tls_Send(p_tls, p, i_len)
                     : send (cl->fd, p, i_len, MSG_NOSIGNAL);
     while (val == -1 && errno == EINTR);
+    if (val == -1 && errno == EAGAIN)
+        cl->b_writable = false;
+    return val;
+}
+
+/* Sends as much as possible of the referenced stream chunks at once */
+static
+ssize_t httpd_NetSendChunks (httpd_client_t *cl)
+{
+    struct iovec *iov = &cl->stream_iov[cl->i_stream_chunk];
+    unsigned count = cl->i_stream_chunks - cl->i_stream_chunk;
+    vlc_tls_t *p_tls;
+    ssize_t val;
+
+    p_tls = cl->p_tls;
+    do
+        if (p_tls)
+            val = p_tls->writev (p_tls, iov, count);
+        else
+        {
+            const struct msghdr msg = {
+                .msg_iov = iov,
+                .msg_iovlen = count,
+            };
+            val = sendmsg (cl->fd, &msg, MSG_NOSIGNAL);
+        }
+    while (val == -1 && errno == EINTR);
+    if (val == -1 && errno == EAGAIN)
+        cl->b_writable = false;
+
+    /* Release the completely sent chunks */
+    for (size_t len = (val > 0) ? val : 0; len > 0;)
+    {
+        if (len < iov->iov_len)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + len;
+            iov->iov_len -= len;
+            break;
+        }
+        len -= iov->iov_len;
+        httpd_StreamChunkRelease (cl->stream_chunks[cl->i_stream_chunk++]);
+        iov++;
+    }
+
+    if (cl->i_stream_chunk == cl->i_stream_chunks)
+        cl->i_stream_chunk = cl->i_stream_chunks = 0;
     return val;
 }
 
@@ -1582,7 +1854,7 @@ static void httpd_ClientRecv(httpd_client_t *cl)
 
 static void httpd_ClientSend(httpd_client_t *cl)
 {
-    int i_len;
+    ssize_t i_len;
 
     if (cl->i_buffer < 0) {
         /* We need to create the header */
@@ -1615,11 +1887,18 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
-    if (i_len >= 0) {
-        cl->i_buffer += i_len;
+    if (cl->i_stream_chunks > 0) {
+        i_len = httpd_NetSendChunks(cl);
+        if (i_len >= 0 && cl->i_stream_chunks > 0)
+            return; /* more stream data to send */
+    } else {
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
+        if (i_len >= 0)
+            cl->i_buffer += i_len;
+    }
 
+    if (i_len >= 0) {
         if (cl->i_buffer >= cl->i_buffer_size) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
@@ -1642,7 +1921,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
-            } else /* send finished */
+            } else if (cl->i_stream_chunks == 0) /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
     } else {
@@ -1664,8 +1943,14 @@ static void httpd_ClientTlsHandshake(httpd_host_t *host, httpd_client_t *cl)
     {
         case -1: cl->i_state = HTTPD_CLIENT_DEAD;       break;
         case 0:  cl->i_state = HTTPD_CLIENT_RECEIVING;  break;
-        case 1:  cl->i_state = HTTPD_CLIENT_TLS_HS_IN;  break;
-        case 2:  cl->i_state = HTTPD_CLIENT_TLS_HS_OUT; break;
+        case 1:
+            cl->i_state = HTTPD_CLIENT_TLS_HS_IN;
+            cl->b_readable = false;
+            break;
+        case 2:
+            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+            cl->b_writable = false;
+            break;
     }
 }
 
@@ -1709,263 +1994,437 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Runs the client state machine, and returns the events it waits for */
+static short httpd_ClientProcess(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-    }
+    int64_t i_offset;
+    short events = 0;
 
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
-    }
-
-    mtime_t now = mdate();
-    bool b_low_delay = false;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            events = POLLIN;
+            break;
 
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
-        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
-                    (cl->i_state == HTTPD_CLIENT_DEAD ||
-                      (cl->i_activity_timeout > 0 &&
-                        cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            TAB_REMOVE(host->i_client, host->client, cl);
-            i_client--;
-            httpd_ClientDestroy(cl);
-            continue;
-        }
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            events = POLLOUT;
+            break;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                        break;
 
-        pufd->fd = cl->fd;
-        pufd->events = pufd->revents = 0;
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-                httpd_MsgInit(answer);
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
                         cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
-
-                    case HTTPD_MSG_OPTIONS:
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
                         answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    }
+                    break;
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                default: {
+                    int i_msg = query->i_type;
+                    bool b_auth_failed = false;
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                    /* Search the url and trigger callbacks */
+                    for (int i = 0; i < host->i_url; i++) {
+                        httpd_url_t *url = host->url[i];
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
+                        if (!url->catch[i_msg].cb)
+                            continue;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
+                        if (answer) {
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
                         }
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
-
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                        if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                            continue;
 
-                    default: {
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        for (int i = 0; i < host->i_url; i++) {
-                            httpd_url_t *url = host->url[i];
-
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
 
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                        }
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
+                    }
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
                     }
+
+                    cl->i_state = HTTPD_CLIENT_SENDING;
                 }
-                break;
             }
+            break;
+        }
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
-                    const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if (psz_connection) {
-                        b_connection = (strcasecmp(psz_connection, "Close") == 0);
-                        b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
-                    }
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
+                const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
+                bool b_connection = false;
+                bool b_keepalive = false;
+                bool b_query = false;
+
+                cl->url = NULL;
+                if (psz_connection) {
+                    b_connection = (strcasecmp(psz_connection, "Close") == 0);
+                    b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
+                }
 
-                    if (psz_query)
-                        b_query = (strcasecmp(psz_query, "Close") == 0);
-
-                    if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
-                                ((cl->query.i_version == 0 && b_keepalive) ||
-                                  (cl->query.i_version == 1 && !b_connection))) ||
-                            ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
-                              !b_query && !b_connection)) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        cl->p_buffer = xmalloc(cl->i_buffer_size);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+                if (psz_query)
+                    b_query = (strcasecmp(psz_query, "Close") == 0);
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+                if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
+                            ((cl->query.i_version == 0 && b_keepalive) ||
+                              (cl->query.i_version == 1 && !b_connection))) ||
+                        ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
+                          !b_query && !b_connection)) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                break;
-
-            case HTTPD_CLIENT_WAITING:
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    cl->p_buffer = xmalloc(cl->i_buffer_size);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
                 i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+                httpd_MsgClean(&cl->answer);
 
-                httpd_MsgInit(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+                cl->i_state = HTTPD_CLIENT_WAITING;
+            }
+            break;
+
+        case HTTPD_CLIENT_WAITING:
+            i_offset = cl->answer.i_body_offset;
+            int i_msg = cl->query.i_type;
+
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
+
+            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                    &cl->answer, &cl->query);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+    }
+
+    return events;
+}
+
+static void httpd_ClientHandle(httpd_host_t *host, httpd_client_t *cl)
+{
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Clients timers: a binary min-heap of the clients by deadline */
+static void httpd_TimerPlace(httpd_host_t *host, httpd_client_t *cl, size_t i)
+{
+    host->timers[i] = cl;
+    cl->i_timer = i;
+}
+
+static void httpd_TimerSiftUp(httpd_host_t *host, size_t i)
+{
+    httpd_client_t *cl = host->timers[i];
+
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (host->timers[parent]->i_deadline <= cl->i_deadline)
+            break;
+        httpd_TimerPlace(host, host->timers[parent], i);
+        i = parent;
+    }
+    httpd_TimerPlace(host, cl, i);
+}
+
+static void httpd_TimerSiftDown(httpd_host_t *host, size_t i)
+{
+    httpd_client_t *cl = host->timers[i];
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= host->i_timers)
+            break;
+        if (child + 1 < host->i_timers &&
+            host->timers[child + 1]->i_deadline < host->timers[child]->i_deadline)
+            child++;
+        if (cl->i_deadline <= host->timers[child]->i_deadline)
+            break;
+        httpd_TimerPlace(host, host->timers[child], i);
+        i = child;
+    }
+    httpd_TimerPlace(host, cl, i);
+}
+
+static void httpd_TimerRemove(httpd_host_t *host, httpd_client_t *cl)
+{
+    if (cl->i_deadline == INT64_MAX)
+        return;
+
+    size_t i = cl->i_timer;
+    httpd_client_t *last = host->timers[--host->i_timers];
+
+    cl->i_deadline = INT64_MAX;
+    if (last == cl)
+        return;
+    httpd_TimerPlace(host, last, i);
+    httpd_TimerSiftDown(host, i);
+    httpd_TimerSiftUp(host, last->i_timer);
+}
+
+/* Sets, moves or cancels (INT64_MAX) the timer of a client */
+static void httpd_TimerSet(httpd_host_t *host, httpd_client_t *cl,
+                           mtime_t deadline)
+{
+    if (deadline == cl->i_deadline)
+        return;
+    httpd_TimerRemove(host, cl);
+    if (deadline == INT64_MAX)
+        return;
+
+    if (host->i_timers == host->i_timers_alloc) {
+        size_t alloc = host->i_timers_alloc ? 2 * host->i_timers_alloc : 16;
+        httpd_client_t **timers = realloc(host->timers,
+                                          alloc * sizeof (*timers));
+        if (unlikely(timers == NULL))
+            return; /* the client only gets served on socket events */
+        host->timers = timers;
+        host->i_timers_alloc = alloc;
+    }
+    cl->i_deadline = deadline;
+    httpd_TimerPlace(host, cl, host->i_timers++);
+    httpd_TimerSiftUp(host, cl->i_timer);
+}
+
+static void httpd_ReadyAdd(httpd_host_t *host, httpd_client_t *cl)
+{
+    if (cl->ready_pprev != NULL)
+        return;
+    cl->ready_next = host->ready;
+    if (cl->ready_next != NULL)
+        cl->ready_next->ready_pprev = &cl->ready_next;
+    cl->ready_pprev = &host->ready;
+    host->ready = cl;
+}
+
+static void httpd_ReadyRemove(httpd_client_t *cl)
+{
+    if (cl->ready_pprev == NULL)
+        return;
+    *(cl->ready_pprev) = cl->ready_next;
+    if (cl->ready_next != NULL)
+        cl->ready_next->ready_pprev = cl->ready_pprev;
+    cl->ready_pprev = NULL;
+}
+#endif
+
+/* Unregisters and destroys a client */
+static void httpd_HostClientRemove(httpd_host_t *host, httpd_client_t *cl)
+{
+    TAB_REMOVE(host->i_client, host->client, cl);
+#ifdef HAVE_SYS_EPOLL_H
+    if (host->epfd != -1) {
+        if ((size_t)cl->fd < host->i_fdmap && host->fdmap[cl->fd] == cl)
+            host->fdmap[cl->fd] = NULL;
+        httpd_TimerRemove(host, cl);
+        httpd_ReadyRemove(cl);
+    }
+#endif
+    httpd_ClientDestroy(cl);
+}
+
+/* Destroys the dead clients, returns false if this one was */
+static bool httpd_ClientCheck(httpd_host_t *host, httpd_client_t *cl, mtime_t now)
+{
+    if (cl->i_ref < 0 || (cl->i_ref == 0 &&
+                (cl->i_state == HTTPD_CLIENT_DEAD ||
+                  (cl->i_activity_timeout > 0 &&
+                    cl->i_activity_date+cl->i_activity_timeout < now)))) {
+        httpd_HostClientRemove(host, cl);
+        return false;
+    }
+    return true;
+}
+
+static httpd_client_t *httpd_HostAccept(httpd_host_t *host, int fd, mtime_t now)
+{
+    httpd_client_t *cl;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return NULL;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *p_tls;
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+
+        p_tls = vlc_tls_ServerSessionCreate(host->p_tls, fd, alpn);
+    }
+    else
+        p_tls = NULL;
+
+    cl = httpd_ClientNew(fd, p_tls, now);
+
+    TAB_APPEND(host->i_client, host->client, cl);
+    return cl;
+}
+
+static void httpdLoop(httpd_host_t *host)
+{
+    struct pollfd ufd[host->nfd + host->i_client];
+    unsigned nfd;
+    for (nfd = 0; nfd < host->nfd; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
+
+    /* add all socket that should be read/write and close dead connection */
+    while (host->i_url <= 0) {
+        mutex_cleanup_push(&host->lock);
+        vlc_cond_wait(&host->wait, &host->lock);
+        vlc_cleanup_pop();
+    }
+
+    mtime_t now = mdate();
+    bool b_low_delay = false;
+
+    int canc = vlc_savecancel();
+    for (int i_client = 0; i_client < host->i_client; i_client++) {
+        httpd_client_t *cl = host->client[i_client];
+        if (!httpd_ClientCheck(host, cl, now)) {
+            i_client--;
+            continue;
         }
 
+        struct pollfd *pufd = ufd + nfd;
+        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+
+        pufd->fd = cl->fd;
+        pufd->events = httpd_ClientProcess(host, cl);
+        pufd->revents = 0;
+
         if (pufd->events != 0)
             nfd++;
         else
@@ -2008,52 +2467,212 @@ static void httpdLoop(httpd_host_t *host)
             continue; // no event received
 
         cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+        httpd_ClientHandle(host, cl);
     }
 
     /* Handle server sockets (accept new connections) */
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
-
-        assert (fd == host->fds[nfd]);
+        assert (ufd[nfd].fd == host->fds[nfd]);
 
         if (ufd[nfd].revents == 0)
             continue;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+        httpd_HostAccept(host, ufd[nfd].fd, now);
+    }
 
-        vlc_tls_t *p_tls;
+    vlc_restorecancel(canc);
+}
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
+#ifdef HAVE_SYS_EPOLL_H
+#define HTTPD_EPOLL_EVENTS 64
 
-            p_tls = vlc_tls_ServerSessionCreate(host->p_tls, fd, alpn);
+/* Registers a new client socket with epoll */
+static void httpd_HostAcceptEpoll(httpd_host_t *host, httpd_client_t *cl)
+{
+    struct epoll_event ev = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+        .data.u64 = (unsigned)cl->fd,
+    };
+
+    if ((size_t)cl->fd >= host->i_fdmap) {
+        size_t i_fdmap = ((size_t)cl->fd + 64) & ~(size_t)63;
+        httpd_client_t **fdmap = realloc(host->fdmap,
+                                         i_fdmap * sizeof (*fdmap));
+        if (unlikely(fdmap == NULL)) {
+            cl->i_state = HTTPD_CLIENT_DEAD;
+            goto ready;
         }
+        for (size_t i = host->i_fdmap; i < i_fdmap; i++)
+            fdmap[i] = NULL;
+        host->fdmap = fdmap;
+        host->i_fdmap = i_fdmap;
+    }
+
+    host->fdmap[cl->fd] = cl;
+    if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, cl->fd, &ev))
+        cl->i_state = HTTPD_CLIENT_DEAD;
+ready:
+    /* the request may already be there */
+    httpd_ReadyAdd(host, cl);
+}
+
+/* Runs one step of a client, then schedules it again: immediately if it can
+ * proceed, on its socket events, or on its timer. */
+static void httpd_ClientServe(httpd_host_t *host, httpd_client_t *cl,
+                              mtime_t now)
+{
+    if (!httpd_ClientCheck(host, cl, now))
+        return;
+
+    short i_events = httpd_ClientProcess(host, cl);
+    if (((i_events & POLLIN) && cl->b_readable)
+     || ((i_events & POLLOUT) && cl->b_writable)) {
+        cl->i_activity_date = now;
+        httpd_ClientHandle(host, cl);
+    }
+
+    mtime_t deadline = INT64_MAX;
+    bool b_ready;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            b_ready = cl->b_readable;
+            break;
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            b_ready = cl->b_writable;
+            break;
+        case HTTPD_CLIENT_WAITING:
+            /* woken up by the stream when it gets new data */
+            b_ready = false;
+            break;
+        default:
+            b_ready = true;
+            break;
+    }
+
+    if (b_ready)
+        httpd_ReadyAdd(host, cl);
+    if (cl->i_activity_timeout > 0 &&
+        cl->i_activity_date + cl->i_activity_timeout < deadline)
+        deadline = cl->i_activity_date + cl->i_activity_timeout + 1;
+    httpd_TimerSet(host, cl, deadline);
+}
+
+/* Queues the clients waiting for stream data, after a wakeup */
+static void httpd_HostWakeup(httpd_host_t *host)
+{
+    uint64_t dummy;
+
+    /* consumed first, so that data sent from now on wakes the loop again */
+    read(host->evfd, &dummy, sizeof (dummy));
+
+    for (int i = 0; i < host->i_client; i++)
+        if (host->client[i]->i_state == HTTPD_CLIENT_WAITING)
+            httpd_ReadyAdd(host, host->client[i]);
+}
+
+/* Same as httpdLoop(), but the sockets stay registered with edge-triggered
+ * notifications, and timeouts are kept in a heap: each wakeup only costs
+ * for the clients that have something to do. */
+static void httpdLoopEpoll(httpd_host_t *host)
+{
+    struct epoll_event events[HTTPD_EPOLL_EVENTS];
+
+    while (host->i_url <= 0) {
+        mutex_cleanup_push(&host->lock);
+        vlc_cond_wait(&host->wait, &host->lock);
+        vlc_cleanup_pop();
+    }
+
+    int timeout = -1;
+    if (host->ready != NULL)
+        timeout = 0;
+    else if (host->i_timers > 0) {
+        mtime_t delay = host->timers[0]->i_deadline - mdate();
+        if (delay <= 0)
+            timeout = 0;
+        else if (delay / 1000 < INT_MAX)
+            timeout = (delay + 999) / 1000;
         else
-            p_tls = NULL;
+            timeout = INT_MAX;
+    }
+    vlc_mutex_unlock(&host->lock);
+
+    int ret = epoll_wait(host->epfd, events, HTTPD_EPOLL_EVENTS, timeout);
+    if (ret == -1 && errno != EINTR) {
+        /* Kernel on low memory or a bug: pace, unless stream data comes */
+        msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+        poll(&(struct pollfd){ .fd = host->evfd, .events = POLLIN }, 1, 100);
+    }
+
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&host->lock);
+    if (ret == -1) {
+        /* wakeups may have been missed */
+        httpd_HostWakeup(host);
+        vlc_restorecancel(canc);
+        return;
+    }
+
+    mtime_t now = mdate();
+
+    for (int i = 0; i < ret; i++) {
+        uint64_t data = events[i].data.u64;
+
+        if (data & HTTPD_EPOLL_LISTENER) {
+            /* Handle server sockets (accept all new connections) */
+            int fd = host->fds[data & ~HTTPD_EPOLL_LISTENER];
+            httpd_client_t *cl;
+
+            while ((cl = httpd_HostAccept(host, fd, now)) != NULL)
+                httpd_HostAcceptEpoll(host, cl);
+            continue;
+        }
+
+        if (data == HTTPD_EPOLL_WAKEUP) {
+            httpd_HostWakeup(host);
+            continue;
+        }
 
-        cl = httpd_ClientNew(fd, p_tls, now);
+        /* The client may have been destroyed while waiting */
+        if (data >= host->i_fdmap || host->fdmap[data] == NULL)
+            continue;
+
+        httpd_client_t *cl = host->fdmap[data];
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            cl->b_readable = true;
+        if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+            cl->b_writable = true;
+        httpd_ReadyAdd(host, cl);
+    }
 
-        TAB_APPEND(host->i_client, host->client, cl);
+    /* Expired timers */
+    while (host->i_timers > 0 && host->timers[0]->i_deadline <= now) {
+        httpd_client_t *cl = host->timers[0];
+
+        httpd_TimerRemove(host, cl);
+        httpd_ReadyAdd(host, cl);
+    }
+
+    /* Handle the client sockets. Clients that can proceed further are
+     * queued again, and handled on the next iteration. */
+    httpd_client_t *batch = host->ready;
+    host->ready = NULL;
+    if (batch != NULL)
+        batch->ready_pprev = &batch;
+
+    while (batch != NULL) {
+        httpd_client_t *cl = batch;
+
+        httpd_ReadyRemove(cl);
+        httpd_ClientServe(host, cl, now);
     }
 
     vlc_restorecancel(canc);
 }
+#endif
 
 static void* httpd_HostThread(void *data)
 {
@@ -2061,7 +2680,12 @@ static void* httpd_HostThread(void *data)
 
     vlc_mutex_lock(&host->lock);
     while (host->i_ref > 0)
-        httpdLoop(host);
+#ifdef HAVE_SYS_EPOLL_H
+        if (host->epfd != -1)
+            httpdLoopEpoll(host);
+        else
+#endif
+            httpdLoop(host);
     vlc_mutex_unlock(&host->lock);
     return NULL;
 }
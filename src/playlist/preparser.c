@@ -38,21 +38,28 @@ typedef struct preparser_entry_t preparser_entry_t;
 
 struct preparser_entry_t
 {
+    playlist_preparser_t *owner;
     input_item_t    *p_item;
     input_item_meta_request_option_t i_options;
+    bool            b_done; /**< Preparser input has ended */
+    bool            b_cancel; /**< Request is stale */
 };
 
 struct playlist_preparser_t
 {
     vlc_object_t        *object;
     playlist_fetcher_t  *p_fetcher;
+    unsigned            i_threads_max;
+    mtime_t             i_timeout;
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    vlc_sem_t       item_done;
-    bool            b_live;
+    vlc_cond_t      item_done;
+    unsigned        i_live;
     preparser_entry_t  **pp_waiting;
     int             i_waiting;
+    preparser_entry_t  **pp_running;
+    int             i_running;
 };
 
 static void *Thread( void * );
@@ -71,12 +78,20 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
     if( unlikely(p_preparser->p_fetcher == NULL) )
         msg_Err( parent, "cannot create fetcher" );
 
+    int i_threads = var_InheritInteger( parent, "preparse-threads" );
+    p_preparser->i_threads_max = i_threads > 0 ? (unsigned)i_threads
+                                               : vlc_GetCPUCount();
+    p_preparser->i_timeout = INT64_C(1000)
+                           * var_InheritInteger( parent, "preparse-timeout" );
+
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    vlc_sem_init( &p_preparser->item_done, 0 );
-    p_preparser->b_live = false;
+    vlc_cond_init( &p_preparser->item_done );
+    p_preparser->i_live = 0;
     p_preparser->i_waiting = 0;
     p_preparser->pp_waiting = NULL;
+    p_preparser->i_running = 0;
+    p_preparser->pp_running = NULL;
 
     return p_preparser;
 }
@@ -84,24 +99,50 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
 void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item,
                               input_item_meta_request_option_t i_options )
 {
+    vlc_mutex_lock( &p_preparser->lock );
+    /* Requested again: the item is likely visible, serve it first */
+    for( int i = 0; i < p_preparser->i_waiting; i++ )
+    {
+        preparser_entry_t *p_entry = p_preparser->pp_waiting[i];
+
+        if( p_entry->p_item != p_item )
+            continue;
+
+        p_entry->i_options |= i_options;
+        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i );
+        INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
+                     0, p_entry );
+        vlc_mutex_unlock( &p_preparser->lock );
+        return;
+    }
+
     preparser_entry_t *p_entry = malloc( sizeof(preparser_entry_t) );
 
     if ( !p_entry )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
         return;
+    }
+    p_entry->owner = p_preparser;
     p_entry->p_item = p_item;
     p_entry->i_options = i_options;
+    p_entry->b_done = false;
+    p_entry->b_cancel = false;
     vlc_gc_incref( p_entry->p_item );
 
-    vlc_mutex_lock( &p_preparser->lock );
     INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
                  p_preparser->i_waiting, p_entry );
-    if( !p_preparser->b_live )
+
+    /* Spawn a worker unless enough of them are idle or about to pick up */
+    unsigned i_idle = p_preparser->i_live - p_preparser->i_running;
+    if( p_preparser->i_live < p_preparser->i_threads_max
+     && (unsigned)p_preparser->i_waiting > i_idle )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
         else
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
@@ -113,26 +154,47 @@ void playlist_preparser_fetcher_Push( playlist_preparser_t *p_preparser,
         playlist_fetcher_Push( p_preparser->p_fetcher, p_item, i_options );
 }
 
-void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
+void playlist_preparser_Cancel( playlist_preparser_t *p_preparser,
+                                input_item_t *p_item )
 {
     vlc_mutex_lock( &p_preparser->lock );
-    /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
+    for( int i = 0; i < p_preparser->i_waiting; i++ )
     {
-        preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
+        preparser_entry_t *p_entry = p_preparser->pp_waiting[i];
+
+        if( p_item != NULL && p_entry->p_item != p_item )
+            continue;
+
         vlc_gc_decref( p_entry->p_item );
         free( p_entry );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i );
+        i--;
+    }
+
+    for( int i = 0; i < p_preparser->i_running; i++ )
+    {
+        preparser_entry_t *p_entry = p_preparser->pp_running[i];
+
+        if( p_item == NULL || p_entry->p_item == p_item )
+            p_entry->b_cancel = true;
     }
+    vlc_cond_broadcast( &p_preparser->item_done );
+    vlc_mutex_unlock( &p_preparser->lock );
+}
 
-    vlc_sem_post( &p_preparser->item_done );
+void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
+{
+    /* Remove pending items and interrupt the running ones,
+     * to speed up preparser threads exit */
+    playlist_preparser_Cancel( p_preparser, NULL );
 
-    while( p_preparser->b_live )
+    vlc_mutex_lock( &p_preparser->lock );
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
     /* Destroy the item preparser */
-    vlc_sem_destroy( &p_preparser->item_done );
+    vlc_cond_destroy( &p_preparser->item_done );
     vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
 
@@ -148,11 +210,17 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 static int InputEvent( vlc_object_t *obj, const char *varname,
                        vlc_value_t old, vlc_value_t cur, void *data )
 {
-    vlc_sem_t *done = data;
+    preparser_entry_t *p_entry = data;
+    playlist_preparser_t *p_preparser = p_entry->owner;
     int event = cur.i_int;
 
     if( event == INPUT_EVENT_DEAD )
-        vlc_sem_post( done );
+    {
+        vlc_mutex_lock( &p_preparser->lock );
+        p_entry->b_done = true;
+        vlc_cond_broadcast( &p_preparser->item_done );
+        vlc_mutex_unlock( &p_preparser->lock );
+    }
 
     (void) obj; (void) varname; (void) old;
     return VLC_SUCCESS;
@@ -161,9 +229,12 @@ static int InputEvent( vlc_object_t *obj, const char *varname,
 /**
  * This function preparses an item when needed.
  */
-static void Preparse( playlist_preparser_t *preparser, input_item_t *p_item,
-                      input_item_meta_request_option_t i_options )
+static void Preparse( playlist_preparser_t *preparser,
+                      preparser_entry_t *p_entry )
 {
+    input_item_t *p_item = p_entry->p_item;
+    input_item_meta_request_option_t i_options = p_entry->i_options;
+
     vlc_mutex_lock( &p_item->lock );
     int i_type = p_item->i_type;
     bool b_net = p_item->b_net;
@@ -188,15 +259,30 @@ static void Preparse( playlist_preparser_t *preparser, input_item_t *p_item,
         if( input == NULL )
             return;
 
-        var_AddCallback( input, "intf-event", InputEvent,
-                         &preparser->item_done );
+        var_AddCallback( input, "intf-event", InputEvent, p_entry );
         if( input_Start( input ) == VLC_SUCCESS )
-            vlc_sem_wait( &preparser->item_done );
-        var_DelCallback( input, "intf-event", InputEvent,
-                         &preparser->item_done );
+        {
+            mtime_t deadline = preparser->i_timeout > 0
+                             ? mdate() + preparser->i_timeout : 0;
+
+            vlc_mutex_lock( &preparser->lock );
+            while( !p_entry->b_done && !p_entry->b_cancel )
+            {
+                if( deadline == 0 )
+                    vlc_cond_wait( &preparser->item_done, &preparser->lock );
+                else if( vlc_cond_timedwait( &preparser->item_done,
+                                             &preparser->lock, deadline ) )
+                {
+                    msg_Dbg( preparser->object, "preparsing timed out" );
+                    break;
+                }
+            }
+            vlc_mutex_unlock( &preparser->lock );
+        }
+        var_DelCallback( input, "intf-event", InputEvent, p_entry );
         /* Normally, the input is already stopped since we waited for it. But
-         * if the playlist preparser is being deleted, then the input might
-         * still be running. Force it to stop. */
+         * if it timed out, or if the request was cancelled, then the input
+         * might still be running. Force it to stop. */
         input_Stop( input );
         input_Close( input );
 
@@ -255,37 +341,33 @@ static void *Thread( void *data )
 {
     playlist_preparser_t *p_preparser = data;
 
-    for( ;; )
+    vlc_mutex_lock( &p_preparser->lock );
+    while( p_preparser->i_waiting > 0 )
     {
-        input_item_t *p_current;
-        input_item_meta_request_option_t i_options;
+        preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
 
-        /* */
-        vlc_mutex_lock( &p_preparser->lock );
-        if( p_preparser->i_waiting > 0 )
-        {
-            preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
-            p_current = p_entry->p_item;
-            i_options = p_entry->i_options;
-            free( p_entry );
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
-        }
-        else
-        {
-            p_current = NULL;
-            p_preparser->b_live = false;
-            vlc_cond_signal( &p_preparser->wait );
-        }
+        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        INSERT_ELEM( p_preparser->pp_running, p_preparser->i_running,
+                     p_preparser->i_running, p_entry );
         vlc_mutex_unlock( &p_preparser->lock );
 
-        if( !p_current )
-            break;
+        Preparse( p_preparser, p_entry );
+
+        Art( p_preparser, p_entry->p_item );
+
+        vlc_mutex_lock( &p_preparser->lock );
+        TAB_REMOVE( p_preparser->i_running, p_preparser->pp_running,
+                    p_entry );
+        vlc_mutex_unlock( &p_preparser->lock );
 
-        Preparse( p_preparser, p_current, i_options );
+        vlc_gc_decref( p_entry->p_item );
+        free( p_entry );
 
-        Art( p_preparser, p_current );
-        vlc_gc_decref(p_current);
+        vlc_mutex_lock( &p_preparser->lock );
     }
+
+    p_preparser->i_live--;
+    vlc_cond_signal( &p_preparser->wait );
+    vlc_mutex_unlock( &p_preparser->lock );
     return NULL;
 }
-
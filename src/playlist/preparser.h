@@ -36,7 +36,8 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object. Up to "preparse-threads"
+ * worker threads are spawned when items are queued.
  */
 playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
 
@@ -54,6 +55,14 @@ void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
 void playlist_preparser_fetcher_Push( playlist_preparser_t *, input_item_t *,
                                       input_item_meta_request_option_t );
 
+/**
+ * This function cancels pending and running requests for an item, for
+ * instance if it is going to be played anyway.
+ *
+ * If the item is NULL, all requests are cancelled.
+ */
+void playlist_preparser_Cancel( playlist_preparser_t *, input_item_t * );
+
 /**
  * This function destroys the preparser object and thread.
  *
@@ -205,6 +205,10 @@ static bool PlayItem( playlist_t *p_playlist, playlist_item_t *p_item )
     assert( p_sys->p_input == NULL );
     PL_UNLOCK;
 
+    /* The input will fetch the meta anyway */
+    if( p_sys->p_preparser != NULL )
+        playlist_preparser_Cancel( p_sys->p_preparser, p_input );
+
     input_thread_t *p_input_thread = input_Create( p_playlist, p_input, NULL,
                                                    p_sys->p_input_resource );
     if( likely(p_input_thread != NULL) )
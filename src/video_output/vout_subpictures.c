@@ -93,6 +93,10 @@ struct spu_private_t {
 
     /* */
     mtime_t last_sort_date;
+
+    /* Statistics */
+    unsigned region_rendered;   /**< regions rendered or scaled */
+    unsigned region_reused;     /**< regions reusing a previous render */
 };
 
 /*****************************************************************************
@@ -280,6 +284,36 @@ static void SpuRenderText(spu_t *spu, bool *rerender_text,
     *rerender_text = var_GetBool(text, "text-rerender");
 }
 
+/**
+ * Create an output region showing an already rendered picture.
+ *
+ * Unlike subpicture_region_New(), no picture is allocated only to be
+ * replaced right away, as this is done for every region of every frame.
+ */
+static subpicture_region_t *SpuRegionWrap(const video_format_t *fmt,
+                                          picture_t *picture)
+{
+    video_format_t fmt_empty = *fmt;
+    fmt_empty.i_chroma = VLC_CODEC_TEXT;
+
+    subpicture_region_t *region = subpicture_region_New(&fmt_empty);
+    if (!region)
+        return NULL;
+
+    region->fmt.i_chroma = fmt->i_chroma;
+    if (fmt->i_chroma == VLC_CODEC_YUVP) {
+        region->fmt.p_palette = calloc(1, sizeof(*region->fmt.p_palette));
+        if (!region->fmt.p_palette) {
+            subpicture_region_Delete(region);
+            return NULL;
+        }
+        if (fmt->p_palette)
+            *region->fmt.p_palette = *fmt->p_palette;
+    }
+    region->p_picture = picture_Hold(picture);
+    return region;
+}
+
 /**
  * A few scale functions helpers.
  */
@@ -663,6 +697,7 @@ static void SpuRenderRegion(spu_t *spu,
 
     video_format_t fmt_original = region->fmt;
     bool restore_text = false;
+    bool rendered = false;
     int x_offset;
     int y_offset;
 
@@ -678,6 +713,7 @@ static void SpuRenderRegion(spu_t *spu,
         SpuRenderText(spu, &restore_text, region,
                       chroma_list,
                       render_date - subpic->i_start);
+        rendered = true;
 
         /* Check if the rendering has failed ... */
         if (region->fmt.i_chroma == VLC_CODEC_TEXT)
@@ -800,6 +836,7 @@ static void SpuRenderRegion(spu_t *spu,
         /* Scale if needed into cache */
         if (!region->p_private && dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
+            rendered = true;
 
             picture_t *picture = region->p_picture;
             picture_Hold(picture);
@@ -905,14 +942,17 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    subpicture_region_t *dst = *dst_ptr = SpuRegionWrap(&region_fmt,
+                                                        region_picture);
     if (dst) {
+        if (rendered)
+            sys->region_rendered++;
+        else
+            sys->region_reused++;
+
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
         int fade_alpha = 255;
         if (subpic->b_fade) {
             mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
@@ -1230,6 +1270,8 @@ spu_t *spu_Create(vlc_object_t *object)
 
     /* */
     sys->last_sort_date = -1;
+    sys->region_rendered = 0;
+    sys->region_reused = 0;
 
     return spu;
 }
@@ -1243,6 +1285,9 @@ void spu_Destroy(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    msg_Dbg(spu, "%u regions rendered, %u reused without rendering",
+            sys->region_rendered, sys->region_reused);
+
     if (sys->text)
         FilterRelease(sys->text);
 
@@ -0,0 +1,211 @@
+/*****************************************************************************
+ * adaptive_logic.cpp: buffer based adaptation offline simulator
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../modules/demux/adaptive/logic/BolaRule.cpp"
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+
+using namespace adaptive::logic;
+
+/* Synthetic presentation: a single adaptation set with a common
+ * bitrate ladder, and fixed duration segments */
+#define SEGMENT_DURATION 4.0 /* s */
+#define SEGMENTS         150
+
+/* On demand streams are demuxed ahead of playback up to the maximum
+ * buffering, and the next segment is fetched once the previous one is
+ * read. So the level reported to the logic stays under that maximum. */
+#define BUFFER_MAX       30.0 /* s, adaptive-maxbuffer default */
+
+static const uint64_t ladder[] = {  235000,  375000,  560000,  750000, 1050000,
+                                   1750000, 2350000, 3000000, 4300000, 5800000 };
+
+/* Bandwidth trace, replayed in a loop */
+struct bwtrace
+{
+    const char *name;
+    double step; /* s */
+    std::vector<uint64_t> bps;
+};
+
+enum policy
+{
+    THROUGHPUT,
+    BOLA,
+    HYBRID,
+};
+static const char *const policies[] = { "throughput", "bola", "hybrid" };
+
+struct result
+{
+    double rebuffer; /* s, stalled after playback started */
+    uint64_t bitrate; /* average */
+    unsigned switches;
+};
+
+/* Time to get that many bits from the trace, starting at now */
+static double Download(const bwtrace &trace, double now, double bits)
+{
+    const double start = now;
+    while(bits > 0)
+    {
+        const size_t slot = now / trace.step;
+        const double end = (slot + 1) * trace.step;
+        const uint64_t bps = trace.bps[slot % trace.bps.size()];
+        if((end - now) * bps >= bits)
+        {
+            now += bits / bps;
+            break;
+        }
+        bits -= (end - now) * bps;
+        now = end;
+    }
+    return now - start;
+}
+
+static result Simulate(const bwtrace &trace, enum policy policy)
+{
+    const std::vector<uint64_t> bitrates(ladder, ladder + ARRAY_SIZE(ladder));
+    BolaRule rule(BUFFER_MAX * CLOCK_FREQ);
+    result res = { 0.0, 0, 0 };
+    double now = 0.0, buffer = 0.0;
+    uint64_t total = 0;
+    unsigned current = 0;
+
+    for(unsigned i = 0; i < SEGMENTS; i++)
+    {
+        /* Idle until demuxing ahead needs another segment */
+        if(buffer > BUFFER_MAX)
+        {
+            now += buffer - BUFFER_MAX;
+            buffer = BUFFER_MAX;
+        }
+
+        /* As reported by the stream: downloaded and not played yet */
+        const mtime_t level = buffer * CLOCK_FREQ;
+        unsigned index;
+        switch(policy)
+        {
+            case BOLA:
+                index = rule.select(bitrates, level, current, rule.getThroughput());
+                break;
+            case HYBRID:
+                index = rule.selectHybrid(bitrates, level, current, rule.getThroughput());
+                break;
+            default: /* an empty buffer leaves only the throughput rule */
+                index = rule.selectHybrid(bitrates, 0, current, rule.getThroughput());
+                break;
+        }
+
+        const double bits = bitrates[index] * SEGMENT_DURATION;
+        const double duration = Download(trace, now, bits);
+        now += duration;
+        rule.addSample(bits / 8, duration * CLOCK_FREQ);
+
+        /* Playback starts with the first segment */
+        if(i > 0)
+        {
+            if(duration > buffer)
+            {
+                res.rebuffer += duration - buffer;
+                buffer = 0.0;
+            }
+            else buffer -= duration;
+        }
+        buffer += SEGMENT_DURATION;
+
+        if(i > 0 && index != current)
+            res.switches++;
+        current = index;
+        total += bitrates[index];
+    }
+
+    res.bitrate = total / SEGMENTS;
+    printf("%-10s %-10s rebuffer %6.1f s, bitrate %5" PRIu64 " kbps, %3u switches\n",
+           trace.name, policies[policy], res.rebuffer, res.bitrate / 1000, res.switches);
+    return res;
+}
+
+static bwtrace Trace(const char *name, double step, const uint64_t *bps, size_t count)
+{
+    bwtrace trace;
+    trace.name = name;
+    trace.step = step;
+    trace.bps.assign(bps, bps + count);
+    return trace;
+}
+
+int main(void)
+{
+    static const uint64_t fast[] = { 10000000 };
+    static const uint64_t slow[] = { 800000 };
+    static const uint64_t drops[] = { 6000000, 6000000, 6000000, 400000 };
+
+    std::vector<bwtrace> traces;
+    traces.push_back(Trace("fast", 10.0, fast, ARRAY_SIZE(fast)));
+    traces.push_back(Trace("slow", 10.0, slow, ARRAY_SIZE(slow)));
+    traces.push_back(Trace("drops", 20.0, drops, ARRAY_SIZE(drops)));
+
+    /* Congested last mile, from a fixed seed */
+    bwtrace congested;
+    congested.name = "congested";
+    congested.step = 2.0;
+    uint32_t seed = 0x2545F491;
+    for(unsigned i = 0; i < 300; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        congested.bps.push_back(300000 + (seed >> 8) % 4700000);
+    }
+    traces.push_back(congested);
+
+    std::vector<result> rate, bola, hybrid;
+    for(size_t i = 0; i < traces.size(); i++)
+    {
+        rate.push_back(Simulate(traces[i], THROUGHPUT));
+        bola.push_back(Simulate(traces[i], BOLA));
+        hybrid.push_back(Simulate(traces[i], HYBRID));
+
+        /* Buffer occupancy must never make things worse than
+         * the throughput alone, and must settle the selection */
+        assert(bola[i].rebuffer <= rate[i].rebuffer);
+        assert(hybrid[i].rebuffer <= rate[i].rebuffer);
+        assert(hybrid[i].switches <= rate[i].switches);
+        assert(hybrid[i].bitrate >= rate[i].bitrate);
+    }
+
+    /* Steady bandwidth */
+    for(size_t i = 0; i < 2; i++)
+    {
+        assert(rate[i].rebuffer == 0.0);
+        assert(bola[i].rebuffer == 0.0);
+        assert(hybrid[i].rebuffer == 0.0);
+    }
+    /* Enough bandwidth for the whole ladder */
+    assert(bola[0].bitrate >= ladder[ARRAY_SIZE(ladder) - 2]);
+    assert(hybrid[0].bitrate >= ladder[ARRAY_SIZE(ladder) - 2]);
+
+    /* Bandwidth drops on a congested link: the buffer is shallow, but
+     * enough for the hybrid logic to hold its selection above the
+     * throughput estimate */
+    assert(hybrid[3].bitrate > rate[3].bitrate);
+
+    return 0;
+}
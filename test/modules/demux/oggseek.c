@@ -0,0 +1,210 @@
+/*****************************************************************************
+ * oggseek.c: Ogg demuxer page index test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include "../modules/demux/index_cache.c"
+#include "../modules/demux/oggseek.c"
+/* config.h was included again along the module source */
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+
+/* Skeleton indexes are never set up here */
+bool Ogg_GetBoundsUsingSkeletonIndex( logical_stream_t *p_stream, int64_t i_time,
+                                      int64_t *pi_lower, int64_t *pi_upper )
+{
+    (void) p_stream; (void) i_time; (void) pi_lower; (void) pi_upper;
+    return false;
+}
+
+#define PAGE_SIZE     4096
+#define PAGE_GRANULES 8820 /* 200 ms at 44.1 kHz */
+#define PAGES         1000
+#define SERIAL        7
+
+static int64_t page_Timestamp( logical_stream_t *p_stream, unsigned i_page )
+{
+    return Oggseek_GranuleToAbsTimestamp( p_stream,
+                                          (int64_t)( i_page + 1 ) * PAGE_GRANULES,
+                                          false );
+}
+
+/* Feeds the pages [i_first, i_last[ to the indexer, as the demuxer reads
+ * them one after the other. The first page holds the headers. */
+static void demux_Pages( demux_t *p_demux, unsigned i_first, unsigned i_last )
+{
+    for( unsigned i = i_first; i < i_last; i++ )
+    {
+        unsigned char header[27] = { 'O', 'g', 'g', 'S' };
+        SetQWLE( &header[6], (int64_t)( i + 1 ) * PAGE_GRANULES );
+        SetDWLE( &header[14], SERIAL );
+
+        ogg_page page = {
+            .header = header, .header_len = sizeof(header),
+            .body = NULL, .body_len = PAGE_SIZE - sizeof(header),
+        };
+        assert( !stream_Seek( p_demux->s, (uint64_t)( i + 2 ) * PAGE_SIZE ) );
+        Oggseek_IndexPage( p_demux, &page );
+    }
+}
+
+/* Checks that seeking within [i_first, i_last[ needs no search */
+static void test_Find( logical_stream_t *p_stream,
+                       unsigned i_first, unsigned i_last )
+{
+    for( unsigned i = 0; i < 4 * PAGES; i++ )
+    {
+        const int64_t i_time = (int64_t)i * page_Timestamp( p_stream, PAGES )
+                               / ( 4 * PAGES );
+        int64_t i_lower = -1, i_upper = -1;
+
+        const demux_index_entry_t *p_entry =
+            OggSeekIndexFind( p_stream, i_time, &i_lower, &i_upper );
+        if( p_entry )
+        {
+            assert( p_entry->i_timestamp <= i_time );
+            assert( i_time - p_entry->i_timestamp
+                    <= OGGSEEK_INDEX_INTERVAL + page_Timestamp( p_stream, 0 ) );
+            assert( p_entry->i_pagepos % PAGE_SIZE == 0 );
+        }
+        else
+            /* the last entry of a run is not followed by a contiguous one */
+            assert( i_time < page_Timestamp( p_stream, i_first )
+                 || i_time >= page_Timestamp( p_stream, i_last - 1 )
+                              - 2 * OGGSEEK_INDEX_INTERVAL );
+        assert( i_lower < 0 || i_upper < 0 || i_lower < i_upper );
+    }
+}
+
+static void test_Cache( demux_t *p_demux, logical_stream_t *p_stream )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    demux_index_t *idx = &p_stream->idx;
+
+    /* nothing saved yet */
+    Oggseek_IndexCacheLoad( p_demux );
+    assert( p_sys->psz_index_cache != NULL );
+    assert( idx->i_entries == 0 );
+
+    demux_Pages( p_demux, 0, PAGES / 2 );
+    const size_t i_entries = idx->i_entries;
+    assert( i_entries > 0 );
+    demux_index_entry_t *p_entries = malloc( i_entries * sizeof(*p_entries) );
+    assert( p_entries != NULL );
+    memcpy( p_entries, idx->p_entries, i_entries * sizeof(*p_entries) );
+
+    Oggseek_IndexCacheSave( p_demux );
+    assert( !idx->b_dirty );
+    oggseek_index_entries_free( idx );
+
+    Oggseek_IndexCacheLoad( p_demux );
+    assert( idx->i_entries == i_entries );
+    assert( !idx->b_dirty );
+    for( size_t i = 0; i < i_entries; i++ )
+    {
+        assert( idx->p_entries[i].i_pagepos == p_entries[i].i_pagepos );
+        assert( idx->p_entries[i].i_granule == p_entries[i].i_granule );
+        assert( idx->p_entries[i].i_timestamp == p_entries[i].i_timestamp );
+        assert( idx->p_entries[i].b_contiguous == p_entries[i].b_contiguous );
+    }
+    free( p_entries );
+    oggseek_index_entries_free( idx );
+
+    /* the index of another logical stream is not used */
+    p_stream->i_serial_no = SERIAL + 1;
+    Oggseek_IndexCacheLoad( p_demux );
+    assert( idx->i_entries == 0 );
+    p_stream->i_serial_no = SERIAL;
+
+    vlc_unlink( p_sys->psz_index_cache );
+    FREENULL( p_sys->psz_index_cache );
+}
+
+int main( void )
+{
+    char dir[] = "/tmp/vlc-oggseek-XXXXXX";
+
+    test_init();
+    if( mkdtemp( dir ) == NULL )
+        return 77;
+    setenv( "XDG_CACHE_HOME", dir, 1 );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    demux_t *p_demux = vlc_object_create( p_vlc->p_libvlc_int,
+                                          sizeof(*p_demux) );
+    assert( p_demux != NULL );
+    var_Create( p_demux, "ogg-index-cache", VLC_VAR_BOOL );
+    var_SetBool( p_demux, "ogg-index-cache", true );
+
+    uint8_t *p_data = calloc( PAGES + 1, PAGE_SIZE );
+    assert( p_data != NULL );
+    p_demux->s = stream_MemoryNew( p_demux, p_data,
+                                   (uint64_t)( PAGES + 1 ) * PAGE_SIZE, true );
+    assert( p_demux->s != NULL );
+    p_demux->s->psz_url = strdup( "file:///nonexistent.ogg" );
+
+    demux_sys_t sys = { .i_index_nextpos = -1 };
+    logical_stream_t stream = { .i_serial_no = SERIAL, .f_rate = 44100 };
+    logical_stream_t *p_stream = &stream;
+
+    es_format_Init( &stream.fmt, AUDIO_ES, VLC_CODEC_VORBIS );
+    stream.idx.i_runpos = -1;
+    sys.i_streams = 1;
+    sys.pp_stream = &p_stream;
+    p_demux->p_sys = &sys;
+
+    /* playing in sequence covers everything that was played */
+    demux_Pages( p_demux, 0, PAGES );
+    test_Find( p_stream, 0, PAGES );
+    oggseek_index_entries_free( &stream.idx );
+
+    /* overlapping runs, as when seeking back and forth */
+    demux_Pages( p_demux, 200, 300 );
+    demux_Pages( p_demux, 600, 640 );
+    demux_Pages( p_demux, 280, 620 );
+    test_Find( p_stream, 200, 640 );
+    oggseek_index_entries_free( &stream.idx );
+
+    test_Cache( p_demux, p_stream );
+
+    char *psz_cache = config_GetUserDir( VLC_CACHE_DIR ), *psz_dir;
+    assert( psz_cache != NULL );
+    if( asprintf( &psz_dir, "%s" DIR_SEP "ogg-index", psz_cache ) >= 0 )
+    {
+        rmdir( psz_dir );
+        free( psz_dir );
+    }
+    rmdir( psz_cache );
+    free( psz_cache );
+    rmdir( dir );
+
+    stream_Delete( p_demux->s );
+    free( p_data );
+    vlc_object_release( p_demux );
+    libvlc_release( p_vlc );
+    return 0;
+}
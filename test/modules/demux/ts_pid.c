@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * ts_pid.c: TS demuxer PID lookup benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include "../modules/demux/mpeg/ts_pid.c"
+/* config.h was included again along the module source */
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+
+/* PID payloads are never set up here */
+ts_pat_t *ts_pat_New( demux_t *d ) { (void) d; return NULL; }
+void ts_pat_Del( demux_t *d, ts_pat_t *p ) { (void) d; (void) p; }
+ts_pmt_t *ts_pmt_New( demux_t *d ) { (void) d; return NULL; }
+void ts_pmt_Del( demux_t *d, ts_pmt_t *p ) { (void) d; (void) p; }
+ts_pes_t *ts_pes_New( demux_t *d, ts_pmt_t *p ) { (void) d; (void) p; return NULL; }
+void ts_pes_Del( demux_t *d, ts_pes_t *p ) { (void) d; (void) p; }
+ts_si_t *ts_si_New( demux_t *d ) { (void) d; return NULL; }
+void ts_si_Del( demux_t *d, ts_si_t *p ) { (void) d; (void) p; }
+ts_psip_t *ts_psip_New( demux_t *d ) { (void) d; return NULL; }
+void ts_psip_Del( demux_t *d, ts_psip_t *p ) { (void) d; (void) p; }
+
+#define MUX_PIDS     60
+#define MUX_PACKETS  (1 << 16)
+#define MUX_LOOPS    64
+
+/* Synthetic full transponder capture: a few services, each with
+ * PMT, video, audio and subtitles PIDs, plus DVB SI, sharing the bandwidth
+ * mostly to the video PIDs. */
+static void mux_Generate( uint16_t *pids, uint16_t *sequence )
+{
+    unsigned i_pid = 0;
+
+    pids[i_pid++] = 0x0000; /* PAT */
+    pids[i_pid++] = 0x0010; /* NIT */
+    pids[i_pid++] = 0x0011; /* SDT */
+    pids[i_pid++] = 0x0012; /* EIT */
+    pids[i_pid++] = 0x0014; /* TDT */
+    pids[i_pid++] = 0x1FFF; /* stuffing */
+    for( unsigned i = 0; i_pid < MUX_PIDS; i++ )
+        pids[i_pid++] = 0x100 + i * 0x65; /* scatter over the PID range */
+
+    uint32_t seed = 0x1234567;
+    for( unsigned i = 0; i < MUX_PACKETS; i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        unsigned r = (seed >> 16) % 100;
+        if( r < 80 ) /* video and audio, the last third of the PIDs */
+            sequence[i] = pids[MUX_PIDS - 1 - (seed >> 8) % (MUX_PIDS / 3)];
+        else
+            sequence[i] = pids[(seed >> 8) % MUX_PIDS];
+    }
+}
+
+int main( void )
+{
+    static uint16_t sequence[MUX_PACKETS];
+    uint16_t pids[MUX_PIDS];
+    ts_pid_list_t list = { 0 }; /* the demuxer allocates it zeroed */
+
+    test_init();
+
+    mux_Generate( pids, sequence );
+    ts_pid_list_Init( &list );
+
+    /* Lookup creates missing PIDs, and always returns the same one */
+    for( unsigned i = 0; i < MUX_PIDS; i++ )
+    {
+        ts_pid_t *pid = ts_pid_Get( &list, pids[i] );
+        assert( pid->i_pid == pids[i] );
+        assert( pid == ts_pid_Get( &list, pids[i] ) );
+    }
+
+    /* Iteration only covers the dynamically allocated PIDs,
+     * in creation order */
+    ts_pid_next_context_t ctx = ts_pid_NextContextInitValue;
+    unsigned i_next = 0;
+    for( ts_pid_t *pid = ts_pid_Next( &list, &ctx ); pid;
+         pid = ts_pid_Next( &list, &ctx ) )
+    {
+        assert( i_next < MUX_PIDS );
+        while( pids[i_next] == 0x0000 || pids[i_next] == 0x1FFF )
+            i_next++;
+        assert( pid->i_pid == pids[i_next] );
+        i_next++;
+    }
+    assert( list.i_all == MUX_PIDS - 2 );
+
+    /* Replay the mux through the lookup */
+    mtime_t i_start = mdate();
+    unsigned i_check = 0;
+    for( unsigned j = 0; j < MUX_LOOPS; j++ )
+    {
+        for( unsigned i = 0; i < MUX_PACKETS; i++ )
+        {
+            ts_pid_t *pid = ts_pid_Get( &list, sequence[i] );
+            i_check += pid->i_pid == sequence[i];
+        }
+    }
+    mtime_t i_duration = mdate() - i_start;
+    assert( i_check == MUX_PACKETS * MUX_LOOPS );
+    assert( list.i_all == MUX_PIDS - 2 );
+
+    printf( "%u PIDs, %u lookups in %"PRId64" us (%.2f ns per lookup)\n",
+            MUX_PIDS, MUX_PACKETS * MUX_LOOPS, i_duration,
+            i_duration * 1000. / (MUX_PACKETS * MUX_LOOPS) );
+
+    ts_pid_list_Release( NULL, &list );
+    return 0;
+}
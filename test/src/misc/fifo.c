@@ -0,0 +1,126 @@
+/*****************************************************************************
+ * fifo.c: block FIFO test
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <assert.h>
+
+#define BLOCKS  200000
+#define CHAIN   4
+
+static void *Producer( void *data )
+{
+    block_fifo_t *fifo = data;
+
+    for( unsigned i = 0; i < BLOCKS; i += CHAIN )
+    {
+        block_t *chain = NULL;
+        block_t **pp = &chain;
+
+        /* Queue chains of blocks, numbered by their size */
+        for( unsigned j = 0; j < CHAIN; j++ )
+        {
+            block_t *block = block_Alloc( (i + j) % 64 );
+            assert( block != NULL );
+            block->i_dts = i + j;
+            *pp = block;
+            pp = &block->p_next;
+        }
+        block_FifoPut( fifo, chain );
+    }
+    return NULL;
+}
+
+static void test_fifo( block_fifo_t *fifo, vlc_cond_t *cond )
+{
+    vlc_thread_t th;
+
+    assert( block_FifoCount( fifo ) == 0 );
+
+    assert( vlc_clone( &th, Producer, fifo, VLC_THREAD_PRIORITY_LOW ) == 0 );
+
+    for( unsigned i = 0; i < BLOCKS; i++ )
+    {
+        block_t *block;
+
+        if( i % 3 )
+            block = block_FifoGet( fifo );
+        else
+        {   /* Locked API, as the decoders do */
+            vlc_fifo_Lock( fifo );
+            while( vlc_fifo_IsEmpty( fifo ) )
+            {
+                if( cond != NULL )
+                    vlc_fifo_WaitCond( fifo, cond );
+                else
+                    vlc_fifo_Wait( fifo );
+            }
+            block = vlc_fifo_DequeueUnlocked( fifo );
+            vlc_fifo_Unlock( fifo );
+        }
+        assert( block != NULL );
+        assert( block->p_next == NULL );
+        assert( block->i_dts == i );
+        assert( block->i_buffer == i % 64 );
+        block_Release( block );
+    }
+
+    vlc_join( th, NULL );
+
+    assert( block_FifoCount( fifo ) == 0 );
+
+    /* Accounting and peeking */
+    block_FifoPut( fifo, block_Alloc( 10 ) );
+    block_FifoPut( fifo, block_Alloc( 20 ) );
+    assert( block_FifoCount( fifo ) == 2 );
+    assert( block_FifoShow( fifo )->i_buffer == 10 );
+
+    vlc_fifo_Lock( fifo );
+    assert( vlc_fifo_GetBytes( fifo ) == 30 );
+    block_t *chain = vlc_fifo_DequeueAllUnlocked( fifo );
+    assert( vlc_fifo_GetCount( fifo ) == 0 );
+    assert( vlc_fifo_GetBytes( fifo ) == 0 );
+    vlc_fifo_Unlock( fifo );
+    assert( chain->i_buffer == 10 );
+    assert( chain->p_next->i_buffer == 20 );
+    assert( chain->p_next->p_next == NULL );
+    block_ChainRelease( chain );
+
+    /* Queued blocks are released with the FIFO */
+    block_FifoPut( fifo, block_Alloc( 1 ) );
+    block_FifoRelease( fifo );
+}
+
+int main( void )
+{
+    test_init();
+
+    test_fifo( block_FifoNew(), NULL );
+    test_fifo( block_FifoNewSPSC(), NULL );
+
+    /* The single producer wakes the consumer up on its own condition */
+    vlc_cond_t cond;
+    vlc_cond_init( &cond );
+    test_fifo( block_FifoNewSPSC(), &cond );
+    vlc_cond_destroy( &cond );
+    return 0;
+}